@@ -1,5 +1,9 @@
 #include "Blob.h"
 
+// Blobs are pooled and passed by value, so they should be no bigger than their fields
+// The narrow public fields, and the flag at the end, are each padded out to a word
+static_assert(sizeof(Blob) <= 9 * sizeof(float) + 5 * sizeof(pixel_moment) + (sizeof(pixel_index) + 6 * sizeof(pixel_coordinate) + 3) / 4 * 4 + 4, "Blob has grown past its fields");
+
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 
@@ -23,13 +27,20 @@ void Blob::clear(){
     num_pixels = 0;
     width = 0;
     height = 0;
-    num_pixels = 0;
     average_temperature = 0;
     aspect_ratio = 0;
     total_x = 0;
     total_y = 0;
+    total_xx = 0;
+    total_yy = 0;
+    total_xy = 0;
+    total_temperature = 0;
+    total_weighted_x = 0;
+    total_weighted_y = 0;
     centroid[X] = -1;
     centroid[Y] = -1;
+    weighted_centroid[X] = -1;
+    weighted_centroid[Y] = -1;
 
     clear_assigned();
 }
@@ -38,22 +49,113 @@ void Blob::add_pixel(Pixel pixel){
     /**
     * Add a new pixel to the blob
     * The blob will need to recalculate its shape and other aspects
+    * When building a blob from many pixels, use accumulate_pixel for each one and finalize once at the end instead.
     * @param pixel Pixel object to be added to the blob
     *
     * AN: There are currently no mechanisms that prevent a pixel from being added multiple times.
     *   - Probably not going to bother
     *   - Pixel objects are not actually stored. The blob just absorbs its information (as blobs do).
     */
+    accumulate_pixel(pixel.get_x(), pixel.get_y(), pixel.get_temperature());
+    finalize();
+}
+
+void Blob::accumulate_pixel(int pixel_x, int pixel_y, float pixel_temp){
+    /**
+    * Absorb a pixel into the blob's running sums and bounds without updating the derived values.
+    * The centroid, average temperature, width, height and aspect ratio are stale until finalize is called.
+    * @param pixel_x Column location of the pixel
+    * @param pixel_y Row location of the pixel
+    * @param pixel_temp Temperature of the pixel in deg C
+    */
+
+    // First pixel added to the blob; initialise the bounds
+    if (num_pixels == 0){
+        min[X] = pixel_x;
+        min[Y] = pixel_y;
+        max[X] = pixel_x;
+        max[Y] = pixel_y;
+    }
+
+    // Not the first; business as usual
+    else{
+        if (pixel_x > max[X]){
+            max[X] = pixel_x;
+        }
+
+        if (pixel_x < min[X]) {
+            min[X] = pixel_x;
+        }
+
+        if (pixel_y > max[Y]) {
+            max[Y] = pixel_y;
+        }
+
+        if (pixel_y < min[Y]) {
+            min[Y] = pixel_y;
+        }
+    }
 
-    int pixel_x = pixel.get_x();
-    int pixel_y = pixel.get_y();
-    float pixel_temp = pixel.get_temperature();
     num_pixels++;
+    total_x += pixel_x;
+    total_y += pixel_y;
+    total_xx += pixel_moment(pixel_x) * pixel_x;
+    total_yy += pixel_moment(pixel_y) * pixel_y;
+    total_xy += pixel_moment(pixel_x) * pixel_y;
+    total_temperature += pixel_temp;
+    total_weighted_x += pixel_temp * pixel_x;
+    total_weighted_y += pixel_temp * pixel_y;
+}
+
+void Blob::finalize(){
+    /**
+    * Work out the derived values of the blob from its running sums.
+    * This only needs to happen once after all of the blob's pixels have been accumulated.
+    */
+    if (num_pixels == 0) {
+        return;
+    }
+
+    float pixel_scale = 1.0 / num_pixels;
+    centroid[X] = total_x * pixel_scale;
+    centroid[Y] = total_y * pixel_scale;
+    average_temperature = total_temperature * pixel_scale;
+
+    // The weighting falls back to the plain centroid if the temperatures cancel out
+    if (total_temperature != 0) {
+        float temperature_scale = 1.0 / total_temperature;
+        weighted_centroid[X] = total_weighted_x * temperature_scale;
+        weighted_centroid[Y] = total_weighted_y * temperature_scale;
+    }
+    else{
+        weighted_centroid[X] = centroid[X];
+        weighted_centroid[Y] = centroid[Y];
+    }
+
+    width = (max[X] - min[X]) + 1;
+    height = (max[Y] - min[Y]) + 1;
+    aspect_ratio = float(width)/float(height);
+}
 
-    average_temperature = (average_temperature * (num_pixels-1) + pixel_temp) / float(num_pixels);
-    recalculate_bounds(pixel_x, pixel_y);
-    recalculate_centroid(pixel_x, pixel_y);
+void Blob::get_second_moments(float moments[3]){
+    /**
+    * Get the central second moments of the blob's pixel coordinates.
+    * These describe the spread and orientation of the blob around its centroid.
+    * @param moments Output array of the x variance, y variance, and xy covariance, in pixels squared
+    */
+    if (num_pixels == 0) {
+        moments[0] = 0;
+        moments[1] = 0;
+        moments[2] = 0;
+        return;
+    }
 
+    float pixel_scale = 1.0 / num_pixels;
+    float mean_x = total_x * pixel_scale;
+    float mean_y = total_y * pixel_scale;
+    moments[0] = total_xx * pixel_scale - mean_x * mean_x;
+    moments[1] = total_yy * pixel_scale - mean_y * mean_y;
+    moments[2] = total_xy * pixel_scale - mean_x * mean_y;
 }
 
 void Blob::copy(Blob blob){
@@ -66,6 +168,8 @@ void Blob::copy(Blob blob){
 
     centroid[X] = blob.centroid[X];
     centroid[Y] = blob.centroid[Y];
+    weighted_centroid[X] = blob.weighted_centroid[X];
+    weighted_centroid[Y] = blob.weighted_centroid[Y];
     min[X] = blob.min[X];
     min[Y] = blob.min[Y];
     max[X] = blob.max[X];
@@ -75,6 +179,14 @@ void Blob::copy(Blob blob){
     width = blob.width;
     height = blob.height;
     num_pixels = blob.num_pixels;
+    total_x = blob.total_x;
+    total_y = blob.total_y;
+    total_xx = blob.total_xx;
+    total_yy = blob.total_yy;
+    total_xy = blob.total_xy;
+    total_temperature = blob.total_temperature;
+    total_weighted_x = blob.total_weighted_x;
+    total_weighted_y = blob.total_weighted_y;
 }
 
 bool Blob::is_active(){
@@ -117,61 +229,3 @@ int Blob::get_size(){
     */
     return num_pixels;
 }
-
-////////////////////////////////////////////////////////////////////////////////
-// Private Methods
-
-void Blob::recalculate_bounds(int pixel_x, int pixel_y){
-    /**
-    * Recalculate the minimum and maximum bounds of the blob.
-    * Secondary values including the width, height, and aspect ratio of the blob are also recalculated.
-    * This occurs every time a new pixel is added to the blob because the old values are invalidated.
-    * @param pixel_x Column location of the new pixel
-    * @param pixel_y Row location of the new pixel
-    */
-
-    // First pixel added to the blob; initialise the values
-    if (num_pixels == 1){
-        min[X] = pixel_x;
-        min[Y] = pixel_y;
-        max[X] = pixel_x;
-        max[Y] = pixel_y;
-    }
-
-    // Not the first; business as usual
-    else{
-        if (pixel_x > max[X]){
-            max[X] = pixel_x;
-        }
-
-        if (pixel_x < min[X]) {
-            min[X] = pixel_x;
-        }
-
-        if (pixel_y > max[Y]) {
-            max[Y] = pixel_y;
-        }
-
-        if (pixel_y < min[Y]) {
-            max[Y] = pixel_y;
-        }
-    }
-
-    width = (max[X] - min[X]) + 1;
-    height = (max[Y] - min[Y]) + 1;
-    aspect_ratio = float(width)/float(height);
-}
-
-void Blob::recalculate_centroid(float pixel_x, float pixel_y){
-    /**
-    * Recalculate the centroid location of the blob
-    * This occurs every time a new pixel is added to the blob because the old values are invalidated.
-    * @param pixel_x Column location of the new pixel
-    * @param pixel_y Row location of the new pixel
-    */
-    total_x += pixel_x;
-    total_y += pixel_y;
-
-    centroid[X] = total_x/num_pixels;
-    centroid[Y] = total_y/num_pixels;
-}
@@ -1,5 +1,5 @@
-// #ifndef BLOB_H
-// #define BLOB_H
+#ifndef BLOB_H
+#define BLOB_H
 
 #include "Pixel.h"
 class Blob{
@@ -8,27 +8,34 @@ public:
     void copy(Blob blob);
     void clear();
     void add_pixel(Pixel);
+    void accumulate_pixel(int x, int y, float temperature);
+    void finalize();
+    void get_second_moments(float moments[3]);
     bool is_active();
     int get_size();
     void set_assigned();
     void clear_assigned();
     bool is_assigned();
 
-    int min[2]; /**< The minimum bounds for the blob*/
-    int max[2]; /**< The maximum bounds for the blob*/
     float centroid[2];  /**< The centroid location of the blob*/
+    float weighted_centroid[2]; /**< The centroid location of the blob with each pixel weighted by its temperature*/
     float aspect_ratio; /**< Ratio of the blobs width to its height*/
     float average_temperature;  /**< Average temperature of the pixels in the blob*/
-    int width;  /**< Maximum width of the blob in pixels*/
-    int height; /**< Maximum height of the blob in pixels*/
-    int num_pixels; /**< Number of pixels contained in the blob*/
+    pixel_index num_pixels; /**< Number of pixels contained in the blob*/
+    pixel_coordinate min[2];    /**< The minimum bounds for the blob*/
+    pixel_coordinate max[2];    /**< The maximum bounds for the blob*/
+    pixel_coordinate width;     /**< Maximum width of the blob in pixels*/
+    pixel_coordinate height;    /**< Maximum height of the blob in pixels*/
 
 private:
-    void recalculate_centroid(float pixel_x, float pixel_y);
-    void recalculate_bounds(int x, int y);
-
-    float total_x;  /**< Sum of all the pixel's x coordinates - used for averaging*/
-    float total_y;  /**< Sum of all the pixel's y coordinates - used for averaging*/
+    pixel_moment total_x;   /**< Sum of all the pixel's x coordinates - used for averaging*/
+    pixel_moment total_y;   /**< Sum of all the pixel's y coordinates - used for averaging*/
+    pixel_moment total_xx;  /**< Sum of the squared x coordinates - used for the second moments*/
+    pixel_moment total_yy;  /**< Sum of the squared y coordinates - used for the second moments*/
+    pixel_moment total_xy;  /**< Sum of the x and y coordinate products - used for the second moments*/
+    float total_temperature;    /**< Sum of all the pixel's temperatures*/
+    float total_weighted_x; /**< Sum of the x coordinates weighted by temperature*/
+    float total_weighted_y; /**< Sum of the y coordinates weighted by temperature*/
     bool _is_assigned;  /**< Flag indicating if a blob has been assigned to a tracked blob*/
 };
 
@@ -37,4 +44,4 @@ enum COORDINATES{
     Y = 0
 };
 
-// #endif
+#endif
@@ -0,0 +1,107 @@
+#include "CountingLines.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+CountingLines::CountingLines(){
+    /**
+    * Create an empty set of virtual tripwires.
+    * Tracks are checked against the lines every time they move, so a crossing is counted the frame it happens
+    * rather than when the track dies. Storage is fixed at MAX_COUNTING_LINES lines.
+    */
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+int CountingLines::add_line(float start_x, float start_y, float end_x, float end_y){
+    /**
+    * Add a line segment to count crossings of, in sensor pixel coordinates (x across the columns, y down the rows).
+    * Crossings from the right-hand side of the line to its left-hand side, looking along it from its start to its end on the
+    * sensor's image (y down), count as LINE_FORWARD. So a line drawn from the top of the view to the bottom counts people
+    * moving left to right as LINE_FORWARD.
+    * @param start_x Column of the start of the line
+    * @param start_y Row of the start of the line
+    * @param end_x Column of the end of the line
+    * @param end_y Row of the end of the line
+    * @return Index of the new line, or -1 if there are already MAX_COUNTING_LINES lines
+    */
+    if (num_lines >= MAX_COUNTING_LINES) {
+        return -1;
+    }
+
+    starts[num_lines][X] = start_x;
+    starts[num_lines][Y] = start_y;
+    directions[num_lines][X] = end_x - start_x;
+    directions[num_lines][Y] = end_y - start_y;
+    counts[num_lines][LINE_FORWARD] = 0;
+    counts[num_lines][LINE_BACKWARD] = 0;
+
+    return num_lines++;
+}
+
+void CountingLines::clear(){
+    /**
+    * Remove all of the lines and their counts.
+    */
+    num_lines = 0;
+}
+
+int CountingLines::check_path(const float from[2], const float to[2]){
+    /**
+    * Count any lines crossed by a track moving between two positions.
+    * The step crosses a line if its ends are on opposite sides of the line, and the ends of the line are on opposite sides of the step.
+    * A point exactly on a line counts as being on its left, so a track that stops on a line and carries on is only counted once.
+    * @param from Previous position of the track; indexed by X and Y
+    * @param to New position of the track; indexed by X and Y
+    * @return Number of lines crossed
+    */
+    float step[2];
+    step[X] = to[X] - from[X];
+    step[Y] = to[Y] - from[Y];
+    int num_crossings = 0;
+
+    for (int line = 0; line < num_lines; line++) {
+        // Which side of the line each end of the step is on (the y axis points down, so this is positive on the right)
+        float from_side = directions[line][X] * (from[Y] - starts[line][Y]) - directions[line][Y] * (from[X] - starts[line][X]);
+        float to_side = directions[line][X] * (to[Y] - starts[line][Y]) - directions[line][Y] * (to[X] - starts[line][X]);
+        if ((from_side > 0) == (to_side > 0)) {
+            continue;
+        }
+
+        // Which side of the step each end of the line is on
+        float start_side = step[X] * (starts[line][Y] - from[Y]) - step[Y] * (starts[line][X] - from[X]);
+        float end_side = step[X] * (starts[line][Y] + directions[line][Y] - from[Y]) - step[Y] * (starts[line][X] + directions[line][X] - from[X]);
+        if ((start_side > 0 && end_side > 0) || (start_side < 0 && end_side < 0)) {
+            continue;
+        }
+
+        counts[line][to_side > 0 ? LINE_BACKWARD : LINE_FORWARD]++;
+        num_crossings++;
+    }
+
+    return num_crossings;
+}
+
+long CountingLines::get_count(int line, int direction){
+    /**
+    * Get the number of times a line has been crossed.
+    * A person who crosses and turns back is counted in both directions, so the difference between them is the net flow.
+    * @param line Index of the line from add_line
+    * @param direction LINE_FORWARD or LINE_BACKWARD
+    * @return Number of crossings, or 0 if there is no such line
+    */
+    if (line < 0 || line >= num_lines || direction < LINE_FORWARD || direction > LINE_BACKWARD) {
+        return 0;
+    }
+
+    return counts[line][direction];
+}
+
+int CountingLines::get_num_lines(){
+    /**
+    * @return Number of lines in use
+    */
+    return num_lines;
+}
@@ -0,0 +1,30 @@
+#ifndef COUNTING_LINES_H
+#define COUNTING_LINES_H
+
+#include <Arduino.h>
+#include "Blob.h"
+
+const int MAX_COUNTING_LINES = 4;
+
+enum line_directions {
+    LINE_FORWARD    = 0,
+    LINE_BACKWARD   = 1
+};
+
+class CountingLines{
+public:
+    CountingLines();
+    int add_line(float start_x, float start_y, float end_x, float end_y);
+    void clear();
+    int check_path(const float from[2], const float to[2]);
+    long get_count(int line, int direction);
+    int get_num_lines();
+
+private:
+    int num_lines;  /**< Number of lines in use*/
+    float starts[MAX_COUNTING_LINES][2];    /**< Start point of each line; indexed by X and Y*/
+    float directions[MAX_COUNTING_LINES][2];    /**< Vector from the start to the end of each line; indexed by X and Y*/
+    long counts[MAX_COUNTING_LINES][2];     /**< Number of crossings of each line; indexed by line_directions*/
+};
+
+#endif
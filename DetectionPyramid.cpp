@@ -0,0 +1,253 @@
+#include "DetectionPyramid.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+DetectionPyramid::DetectionPyramid(int _width, int _height, int _factor){
+    /**
+    * Create a coarse detection level for large sensors.
+    * The frame is sampled every PYRAMID_SAMPLE_SPACING pixels along each axis, and the samples are checked against a
+    * background kept at the same resolution. A blob at least PYRAMID_SAMPLE_SPACING pixels wide and tall always covers
+    * a sample. The factor x factor cells that a standing-out sample falls in mark where full resolution detection is
+    * needed, so the rest of the frame can be skipped.
+    * Storage is allocated once here and is never resized.
+    * @param _width Width of the full resolution frames in pixels
+    * @param _height Height of the full resolution frames in pixels
+    * @param _factor Number of full resolution pixels per cell along each axis (2 - MAX_PYRAMID_FACTOR)
+    */
+    width = _width;
+    height = _height;
+    factor = constrain(_factor, 2, MAX_PYRAMID_FACTOR);
+    coarse_width = (width + factor - 1) / factor;
+    coarse_height = (height + factor - 1) / factor;
+    sample_width = (width + PYRAMID_SAMPLE_SPACING - 1) / PYRAMID_SAMPLE_SPACING;
+    sample_height = (height + PYRAMID_SAMPLE_SPACING - 1) / PYRAMID_SAMPLE_SPACING;
+    refresh_row = 0;
+
+    int num_cells = coarse_width * coarse_height;
+    int num_samples = sample_width * sample_height;
+    sample_rows = new int[sample_height];
+    sample_columns = new int[sample_width];
+    sample_cell_columns = new int[sample_width];
+    samples = new float[num_samples];
+    averages = new float[num_samples];
+    deviations = new float[num_samples];
+    candidates = new bool[num_cells];
+    regions = new bool[num_cells];
+    previous_regions = new bool[num_cells];
+
+    // Samples sit in the middle of their spacing, kept inside the frame when it doesn't divide evenly
+    for (int i = 0; i < sample_height; i++) {
+        sample_rows[i] = min(i * PYRAMID_SAMPLE_SPACING + PYRAMID_SAMPLE_SPACING / 2, height - 1);
+    }
+
+    for (int j = 0; j < sample_width; j++) {
+        sample_columns[j] = min(j * PYRAMID_SAMPLE_SPACING + PYRAMID_SAMPLE_SPACING / 2, width - 1);
+        sample_cell_columns[j] = sample_columns[j] / factor;
+    }
+
+    for (int sample = 0; sample < num_samples; sample++) {
+        samples[sample] = 0;
+        averages[sample] = 0;
+        deviations[sample] = 0;
+    }
+
+    for (int cell = 0; cell < num_cells; cell++) {
+        regions[cell] = false;
+        previous_regions[cell] = false;
+    }
+}
+
+DetectionPyramid::~DetectionPyramid(){
+    delete[] sample_rows;
+    delete[] sample_columns;
+    delete[] sample_cell_columns;
+    delete[] samples;
+    delete[] averages;
+    delete[] deviations;
+    delete[] candidates;
+    delete[] regions;
+    delete[] previous_regions;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void DetectionPyramid::set_background(const float pixel_averages[], const float pixel_deviations[]){
+    /**
+    * Start the sampled background from a full resolution one, such as when it has just been built or restored.
+    * It is downsampled the same way the frames are.
+    * @param pixel_averages Row-major background averages of the full resolution pixels
+    * @param pixel_deviations Row-major background deviations of the full resolution pixels
+    */
+    for (int i = 0; i < sample_height; i++) {
+        for (int j = 0; j < sample_width; j++) {
+            int pixel = sample_rows[i] * width + sample_columns[j];
+            averages[i * sample_width + j] = pixel_averages[pixel];
+            deviations[i * sample_width + j] = pixel_deviations[pixel];
+        }
+    }
+}
+
+void DetectionPyramid::add_to_background(int population_size){
+    /**
+    * Add the current samples to the sampled background.
+    * This is the same running average and deviation the tracker keeps at full resolution, so it follows the
+    * scene every frame while the full resolution background is only refreshed a row of cells at a time.
+    * @param population_size Number of frames in the running average
+    */
+    for (int sample = 0; sample < sample_width * sample_height; sample++) {
+        averages[sample] = ((averages[sample] * (population_size - 1)) + samples[sample]) / population_size;
+
+        float incremental_deviation = fabsf(samples[sample] - averages[sample]);
+        deviations[sample] = ((deviations[sample] * (population_size - 1)) + incremental_deviation) / population_size;
+    }
+}
+
+int DetectionPyramid::find_regions(float activation_sigma){
+    /**
+    * Find the regions of interest of the frame from the current samples.
+    * A blob can straddle a cell boundary with only a sliver in the neighbouring cell, so the regions are the
+    * candidate cells grown by one cell in every direction.
+    * @param activation_sigma Number of background deviations a sample must stray by for its cell to be a candidate
+    * @return Number of cells in the regions of interest
+    */
+    int num_regions = 0;
+
+    for (int cell = 0; cell < coarse_width * coarse_height; cell++) {
+        candidates[cell] = false;
+        previous_regions[cell] = regions[cell];
+    }
+
+    for (int i = 0; i < sample_height; i++) {
+        bool* row_candidates = &candidates[(sample_rows[i] / factor) * coarse_width];
+        for (int j = 0; j < sample_width; j++) {
+            int sample = i * sample_width + j;
+            float margin = deviations[sample] * activation_sigma;
+            row_candidates[sample_cell_columns[j]] |= (samples[sample] < averages[sample] - margin) | (samples[sample] > averages[sample] + margin);
+        }
+    }
+
+    for (int i = 0; i < coarse_height; i++) {
+        for (int j = 0; j < coarse_width; j++) {
+            bool region = false;
+            for (int row = max(i - 1, 0); row <= min(i + 1, coarse_height - 1); row++) {
+                for (int column = max(j - 1, 0); column <= min(j + 1, coarse_width - 1); column++) {
+                    region |= candidates[row * coarse_width + column];
+                }
+            }
+
+            regions[i * coarse_width + j] = region;
+            num_regions += region;
+        }
+    }
+
+    return num_regions;
+}
+
+void DetectionPyramid::fill_regions(){
+    /**
+    * Mark every cell as a region of interest, for frames that have been checked at full resolution throughout.
+    * The next set of regions then clears anything those frames left behind.
+    */
+    for (int cell = 0; cell < coarse_width * coarse_height; cell++) {
+        previous_regions[cell] = regions[cell];
+        regions[cell] = true;
+    }
+}
+
+float* DetectionPyramid::get_samples(){
+    /**
+    * Get the samples for the frame to be loaded into; sample (i, j) is pixel (get_sample_rows()[i], get_sample_columns()[j]).
+    * @return Row-major array of get_sample_height() x get_sample_width() temperatures
+    */
+    return samples;
+}
+
+const int* DetectionPyramid::get_sample_rows(){
+    /**
+    * @return Full resolution row of each row of samples
+    */
+    return sample_rows;
+}
+
+const int* DetectionPyramid::get_sample_columns(){
+    /**
+    * @return Full resolution column of each column of samples
+    */
+    return sample_columns;
+}
+
+int DetectionPyramid::get_sample_width(){
+    /**
+    * @return Number of samples across each frame
+    */
+    return sample_width;
+}
+
+int DetectionPyramid::get_sample_height(){
+    /**
+    * @return Number of samples down each frame
+    */
+    return sample_height;
+}
+
+const bool* DetectionPyramid::get_regions(){
+    /**
+    * @return Row-major flags of the cells in the regions of interest
+    */
+    return regions;
+}
+
+const bool* DetectionPyramid::get_previous_regions(){
+    /**
+    * @return Row-major flags of the cells that were in the regions of interest of the previous frame
+    */
+    return previous_regions;
+}
+
+int DetectionPyramid::get_refresh_row(){
+    /**
+    * Get the row of cells whose full resolution background is due to be refreshed.
+    * @return Row of cells, from 0 to get_height() - 1
+    */
+    return refresh_row;
+}
+
+void DetectionPyramid::advance_refresh_row(){
+    /**
+    * Move on to the next row of cells to refresh, wrapping back to the top after the last one.
+    */
+    refresh_row = (refresh_row + 1) % coarse_height;
+}
+
+int DetectionPyramid::get_width(){
+    /**
+    * @return Width of the coarse level in cells
+    */
+    return coarse_width;
+}
+
+int DetectionPyramid::get_height(){
+    /**
+    * @return Height of the coarse level in cells
+    */
+    return coarse_height;
+}
+
+int DetectionPyramid::get_factor(){
+    /**
+    * @return Number of full resolution pixels per cell along each axis
+    */
+    return factor;
+}
+
+size_t DetectionPyramid::get_memory_usage(){
+    /**
+    * Get the number of bytes used by the pyramid, including its heap storage.
+    * @return Memory usage in bytes
+    */
+    size_t num_cells = coarse_width * coarse_height;
+    size_t num_samples = sample_width * sample_height;
+    return sizeof(DetectionPyramid) + (2 * sample_width + sample_height) * sizeof(int) + num_samples * 3 * sizeof(float) + num_cells * 3 * sizeof(bool);
+}
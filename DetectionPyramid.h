@@ -0,0 +1,53 @@
+#ifndef DETECTION_PYRAMID_H
+#define DETECTION_PYRAMID_H
+
+#include <Arduino.h>
+
+const int MAX_PYRAMID_FACTOR = 8;
+const int PYRAMID_SAMPLE_SPACING = 2;
+
+class DetectionPyramid{
+public:
+    DetectionPyramid(int width, int height, int factor);
+    ~DetectionPyramid();
+    DetectionPyramid(const DetectionPyramid&) = delete;            // Owns its sample grids and regions
+    DetectionPyramid& operator=(const DetectionPyramid&) = delete;
+    void set_background(const float pixel_averages[], const float pixel_deviations[]);
+    void add_to_background(int population_size);
+    int find_regions(float activation_sigma);
+    void fill_regions();
+    float* get_samples();
+    const int* get_sample_rows();
+    const int* get_sample_columns();
+    int get_sample_width();
+    int get_sample_height();
+    const bool* get_regions();
+    const bool* get_previous_regions();
+    int get_refresh_row();
+    void advance_refresh_row();
+    int get_width();
+    int get_height();
+    int get_factor();
+    size_t get_memory_usage();
+
+private:
+    int width;          /**< Width of the full resolution frames in pixels*/
+    int height;         /**< Height of the full resolution frames in pixels*/
+    int factor;         /**< Number of full resolution pixels per coarse cell along each axis*/
+    int coarse_width;   /**< Width of the coarse level in cells*/
+    int coarse_height;  /**< Height of the coarse level in cells*/
+    int sample_width;   /**< Number of samples across each frame*/
+    int sample_height;  /**< Number of samples down each frame*/
+    int* sample_rows;   /**< Full resolution row of each row of samples*/
+    int* sample_columns;    /**< Full resolution column of each column of samples*/
+    int* sample_cell_columns;   /**< Column of cells each column of samples falls in*/
+    float* samples;     /**< Temperature of each sample in the current frame*/
+    float* averages;    /**< Background average of each sample*/
+    float* deviations;  /**< Background deviation of each sample*/
+    bool* candidates;   /**< Cells with a sample that stands out from the sampled background*/
+    bool* regions;      /**< Cells to run full resolution detection in; the candidates and their neighbours*/
+    bool* previous_regions; /**< Regions of the previous frame*/
+    int refresh_row;    /**< Row of cells whose full resolution background is refreshed next*/
+};
+
+#endif
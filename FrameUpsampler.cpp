@@ -0,0 +1,226 @@
+#include "FrameUpsampler.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+FrameUpsampler::FrameUpsampler(int _width, int _height, int _factor){
+    /**
+    * Create a bilinear upsampler that detection can run on instead of the raw sensor grid.
+    * On a 16x4 sensor a person crosses the short axis in a pixel or two; interpolating the frame and the background
+    * bounds gives the blobs finer edges and centroids to track.
+    * The tap positions and weights are worked out once here, and storage is allocated once and never resized.
+    * @param _width Width of the source frames in pixels
+    * @param _height Height of the source frames in pixels
+    * @param _factor Number of output pixels per source pixel along each axis (1 - MAX_UPSAMPLING_FACTOR)
+    */
+    width = _width;
+    height = _height;
+    factor = constrain(_factor, 1, MAX_UPSAMPLING_FACTOR);
+
+    int output_width = width * factor;
+    int output_height = height * factor;
+    column_taps = new int[output_width][2];
+    column_weights = new float[output_width];
+    row_taps = new int[output_height][2];
+    row_weights = new float[output_height];
+    row_scratch = new float[3 * height * output_width];
+    upsampled_frame = new float[output_width * output_height];
+    upsampled_mask = new bool[output_width * output_height];
+
+    build_taps(width, column_taps, column_weights);
+    build_taps(height, row_taps, row_weights);
+}
+
+FrameUpsampler::~FrameUpsampler(){
+    delete[] column_taps;
+    delete[] column_weights;
+    delete[] row_taps;
+    delete[] row_weights;
+    delete[] row_scratch;
+    delete[] upsampled_frame;
+    delete[] upsampled_mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void FrameUpsampler::upsample(const float frame[], int row_step, int column_step, const float lower_bounds[], const float upper_bounds[]){
+    /**
+    * Interpolate a frame and its activation bounds, then threshold the result.
+    * Interpolation is linear, so comparing the interpolated temperature against the interpolated bounds is the
+    * same as interpolating how far each pixel is outside of its bounds.
+    * @param frame Pixel temperatures; pixel (i, j) is at frame[i * row_step + j * column_step]
+    * @param row_step Number of floats between vertically adjacent pixels in the frame
+    * @param column_step Number of floats between horizontally adjacent pixels in the frame
+    * @param lower_bounds Row-major temperatures below which a pixel is active
+    * @param upper_bounds Row-major temperatures above which a pixel is active
+    */
+    int output_width = width * factor;
+    int block_size = height * output_width;
+    interpolate_rows(frame, row_step, column_step, &row_scratch[TEMPERATURE_CHANNEL * block_size]);
+    interpolate_rows(lower_bounds, width, 1, &row_scratch[LOWER_BOUND_CHANNEL * block_size]);
+    interpolate_rows(upper_bounds, width, 1, &row_scratch[UPPER_BOUND_CHANNEL * block_size]);
+
+    for (int i = 0; i < height * factor; i++) {
+        float weight = row_weights[i];
+        const float* temperature_upper = &row_scratch[TEMPERATURE_CHANNEL * block_size + row_taps[i][0] * output_width];
+        const float* temperature_lower = &row_scratch[TEMPERATURE_CHANNEL * block_size + row_taps[i][1] * output_width];
+        const float* lower_bound_upper = &row_scratch[LOWER_BOUND_CHANNEL * block_size + row_taps[i][0] * output_width];
+        const float* lower_bound_lower = &row_scratch[LOWER_BOUND_CHANNEL * block_size + row_taps[i][1] * output_width];
+        const float* upper_bound_upper = &row_scratch[UPPER_BOUND_CHANNEL * block_size + row_taps[i][0] * output_width];
+        const float* upper_bound_lower = &row_scratch[UPPER_BOUND_CHANNEL * block_size + row_taps[i][1] * output_width];
+        float* output = &upsampled_frame[i * output_width];
+        bool* mask = &upsampled_mask[i * output_width];
+
+        // Contiguous and branch-free so that it vectorises
+        for (int j = 0; j < output_width; j++) {
+            float temp = temperature_upper[j] + weight * (temperature_lower[j] - temperature_upper[j]);
+            float lower_bound = lower_bound_upper[j] + weight * (lower_bound_lower[j] - lower_bound_upper[j]);
+            float upper_bound = upper_bound_upper[j] + weight * (upper_bound_lower[j] - upper_bound_upper[j]);
+            output[j] = temp;
+            mask[j] = (temp < lower_bound) | (temp > upper_bound);
+        }
+    }
+}
+
+void FrameUpsampler::upsample(const float frame[], int row_step, int column_step, const bool mask[]){
+    /**
+    * Interpolate a frame that has already been classified, such as by the mixture background.
+    * The classification can't be interpolated, so each source pixel's flag covers its factor x factor block.
+    * @param frame Pixel temperatures; pixel (i, j) is at frame[i * row_step + j * column_step]
+    * @param row_step Number of floats between vertically adjacent pixels in the frame
+    * @param column_step Number of floats between horizontally adjacent pixels in the frame
+    * @param mask Row-major flags of the active source pixels
+    */
+    int output_width = width * factor;
+    interpolate_rows(frame, row_step, column_step, row_scratch);
+
+    for (int i = 0; i < height * factor; i++) {
+        float weight = row_weights[i];
+        const float* upper = &row_scratch[row_taps[i][0] * output_width];
+        const float* lower = &row_scratch[row_taps[i][1] * output_width];
+        const bool* source_mask = &mask[(i / factor) * width];
+
+        for (int j = 0; j < output_width; j++) {
+            upsampled_frame[i * output_width + j] = upper[j] + weight * (lower[j] - upper[j]);
+            upsampled_mask[i * output_width + j] = source_mask[j / factor];
+        }
+    }
+}
+
+void FrameUpsampler::mask_pixels(const bool enabled[]){
+    /**
+    * Clear the active flags of the last upsampled frame wherever the source pixel underneath is disabled.
+    * @param enabled Row-major flags of the source pixels that may be active
+    */
+    int output_width = width * factor;
+
+    for (int i = 0; i < height * factor; i++) {
+        const bool* source_enabled = &enabled[(i / factor) * width];
+        for (int j = 0; j < output_width; j++) {
+            upsampled_mask[i * output_width + j] &= source_enabled[j / factor];
+        }
+    }
+}
+
+const float* FrameUpsampler::get_frame(){
+    /**
+    * Get the interpolated temperatures of the last upsampled frame.
+    * @return Row-major array of get_height() x get_width() temperatures, in deg C
+    */
+    return upsampled_frame;
+}
+
+const bool* FrameUpsampler::get_mask(){
+    /**
+    * Get the active pixels of the last upsampled frame.
+    * @return Row-major array of get_height() x get_width() flags
+    */
+    return upsampled_mask;
+}
+
+int FrameUpsampler::get_width(){
+    /**
+    * @return Width of the upsampled frames in pixels
+    */
+    return width * factor;
+}
+
+int FrameUpsampler::get_height(){
+    /**
+    * @return Height of the upsampled frames in pixels
+    */
+    return height * factor;
+}
+
+int FrameUpsampler::get_factor(){
+    /**
+    * @return Number of output pixels per source pixel along each axis
+    */
+    return factor;
+}
+
+size_t FrameUpsampler::get_memory_usage(){
+    /**
+    * Get the number of bytes used by the upsampler, including its heap storage.
+    * @return Memory usage in bytes
+    */
+    size_t output_width = width * factor;
+    size_t output_height = height * factor;
+    return sizeof(FrameUpsampler)
+        + output_width * (sizeof(column_taps[0]) + sizeof(float))
+        + output_height * (sizeof(row_taps[0]) + sizeof(float))
+        + 3 * height * output_width * sizeof(float)
+        + output_width * output_height * (sizeof(float) + sizeof(bool));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private Methods
+
+void FrameUpsampler::build_taps(int size, int taps[][2], float weights[]){
+    /**
+    * Work out which two source pixels each output pixel along an axis sits between, and how far along it is.
+    * Output pixel centres are spread evenly over the source pixels; the ones past the outer source centres repeat the edge.
+    * @param size Number of source pixels along the axis
+    * @param taps Output pairs of source indexes for each output pixel
+    * @param weights Output weights of the second source pixel for each output pixel
+    */
+    for (int i = 0; i < size * factor; i++) {
+        float position = (i + 0.5) / factor - 0.5;
+        int first = int(floorf(position));
+        float weight = position - first;
+
+        if (first < 0) {
+            first = 0;
+            weight = 0;
+        }
+        if (first >= size - 1) {
+            first = size - 1;
+            weight = 0;
+        }
+
+        taps[i][0] = first;
+        taps[i][1] = min(first + 1, size - 1);
+        weights[i] = weight;
+    }
+}
+
+void FrameUpsampler::interpolate_rows(const float source[], int row_step, int column_step, float output[]){
+    /**
+    * Interpolate each source row out to the output width.
+    * @param source Source pixels; pixel (i, j) is at source[i * row_step + j * column_step]
+    * @param row_step Number of floats between vertically adjacent source pixels
+    * @param column_step Number of floats between horizontally adjacent source pixels
+    * @param output Row-major array of height x (width * factor) interpolated values
+    */
+    int output_width = width * factor;
+
+    for (int i = 0; i < height; i++) {
+        const float* row = &source[i * row_step];
+        for (int j = 0; j < output_width; j++) {
+            float left = row[column_taps[j][0] * column_step];
+            float right = row[column_taps[j][1] * column_step];
+            output[i * output_width + j] = left + column_weights[j] * (right - left);
+        }
+    }
+}
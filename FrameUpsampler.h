@@ -0,0 +1,46 @@
+#ifndef FRAME_UPSAMPLER_H
+#define FRAME_UPSAMPLER_H
+
+#include <Arduino.h>
+
+const int MAX_UPSAMPLING_FACTOR = 4;
+
+enum upsampling_channels {
+    TEMPERATURE_CHANNEL = 0,
+    LOWER_BOUND_CHANNEL = 1,
+    UPPER_BOUND_CHANNEL = 2
+};
+
+class FrameUpsampler{
+public:
+    FrameUpsampler(int width, int height, int factor);
+    ~FrameUpsampler();
+    FrameUpsampler(const FrameUpsampler&) = delete;            // Owns its taps and output buffers
+    FrameUpsampler& operator=(const FrameUpsampler&) = delete;
+    void upsample(const float frame[], int row_step, int column_step, const float lower_bounds[], const float upper_bounds[]);
+    void upsample(const float frame[], int row_step, int column_step, const bool mask[]);
+    void mask_pixels(const bool enabled[]);
+    const float* get_frame();
+    const bool* get_mask();
+    int get_width();
+    int get_height();
+    int get_factor();
+    size_t get_memory_usage();
+
+private:
+    void build_taps(int size, int taps[][2], float weights[]);
+    void interpolate_rows(const float source[], int row_step, int column_step, float output[]);
+
+    int width;      /**< Width of the source frames in pixels*/
+    int height;     /**< Height of the source frames in pixels*/
+    int factor;     /**< Number of output pixels per source pixel along each axis*/
+    int (*column_taps)[2];  /**< Left and right source column of each output column*/
+    float* column_weights;  /**< Weight of the right source column for each output column*/
+    int (*row_taps)[2];     /**< Upper and lower source row of each output row*/
+    float* row_weights;     /**< Weight of the lower source row for each output row*/
+    float* row_scratch;     /**< Source rows interpolated out to the output width; one block per channel*/
+    float* upsampled_frame; /**< Interpolated temperatures, row-major*/
+    bool* upsampled_mask;   /**< Active pixels of the interpolated frame, row-major*/
+};
+
+#endif
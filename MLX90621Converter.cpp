@@ -0,0 +1,167 @@
+#include "MLX90621Converter.h"
+
+static int16_t twos_8(uint8_t value){
+    return (value > 127) ? int16_t(value) - 256 : int16_t(value);
+}
+
+static int16_t twos_16(uint8_t high_byte, uint8_t low_byte){
+    return int16_t((uint16_t(high_byte) << 8) | low_byte);
+}
+
+static uint16_t unsigned_16(uint8_t high_byte, uint8_t low_byte){
+    return (uint16_t(high_byte) << 8) | low_byte;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+MLX90621Converter::MLX90621Converter(){
+    /**
+    * Create a new raw-to-temperature converter for the MLX90621.
+    * The converter turns raw IR counts into the deg C frames expected by ThermalTracker::process_frame.
+    * Per-pixel calibration constants are precomputed once using load_calibration, so each frame only needs
+    * a multiply-add and a fourth root per pixel.
+    */
+    calibrated = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void MLX90621Converter::load_calibration(const uint8_t eeprom[MLX90621_EEPROM_SIZE], int resolution){
+    /**
+    * Precompute the per-pixel calibration constants from the sensor's EEPROM dump.
+    * This only needs to be done once after the EEPROM has been read.
+    * The ambient temperature defaults to 25 deg C until set_ambient_temperature is called.
+    * @param eeprom The 256 byte EEPROM dump of the sensor
+    * @param resolution ADC resolution setting of the sensor (0-3 for 15-18 bits)
+    */
+    float resolution_comp = powf(2.0, 3 - resolution);
+
+    int a_i_scale = (eeprom[CAL_AI_BI_SCALE] & 0xF0) >> 4;
+    int b_i_scale = eeprom[CAL_AI_BI_SCALE] & 0x0F;
+    int k_t1_scale = (eeprom[CAL_KT_SCALE] & 0xF0) >> 4;
+    int k_t2_scale = (eeprom[CAL_KT_SCALE] & 0x0F) + 10;
+
+    float a_common = twos_16(eeprom[CAL_ACOMMON_H], eeprom[CAL_ACOMMON_L]);
+    float alpha_0 = unsigned_16(eeprom[CAL_A0_H], eeprom[CAL_A0_L]) / powf(2.0, eeprom[CAL_A0_SCALE]);
+    float delta_alpha_scale = powf(2.0, eeprom[CAL_DELTA_A_SCALE]);
+
+    v_th = twos_16(eeprom[CAL_VTH_H], eeprom[CAL_VTH_L]) / resolution_comp;
+    k_t1 = twos_16(eeprom[CAL_KT1_H], eeprom[CAL_KT1_L]) / (powf(2.0, k_t1_scale) * resolution_comp);
+    k_t2 = twos_16(eeprom[CAL_KT2_H], eeprom[CAL_KT2_L]) / (powf(2.0, k_t2_scale) * resolution_comp);
+
+    cp_offset_base = twos_16(eeprom[CAL_ACP_H], eeprom[CAL_ACP_L]) / resolution_comp;
+    cp_offset_slope = twos_8(eeprom[CAL_BCP]) / (powf(2.0, b_i_scale) * resolution_comp);
+    alpha_cp = unsigned_16(eeprom[CAL_ALPHA_CP_H], eeprom[CAL_ALPHA_CP_L]) / (powf(2.0, eeprom[CAL_A0_SCALE]) * resolution_comp);
+    tgc = twos_8(eeprom[CAL_TGC]) / 32.0;
+    ksta = twos_16(eeprom[CAL_KSTA_H], eeprom[CAL_KSTA_L]) / powf(2.0, 20);
+    emissivity = unsigned_16(eeprom[CAL_EMIS_H], eeprom[CAL_EMIS_L]) / 32768.0;
+
+    for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+        pixel_offset_base[i] = (a_common + eeprom[CAL_A_I_START + i] * powf(2.0, a_i_scale)) / resolution_comp;
+        pixel_offset_slope[i] = twos_8(eeprom[CAL_B_I_START + i]) / (powf(2.0, b_i_scale) * resolution_comp);
+
+        float alpha_ij = (alpha_0 + eeprom[CAL_DELTA_ALPHA_START + i] / delta_alpha_scale) / resolution_comp;
+        pixel_alpha[i] = alpha_ij - tgc * alpha_cp;
+    }
+
+    calibrated = true;
+    set_ambient_temperature(25.0);
+}
+
+bool MLX90621Converter::is_calibrated(){
+    /**
+    * Determine if the calibration constants have been loaded.
+    * @return True if load_calibration has been called.
+    */
+    return calibrated;
+}
+
+float MLX90621Converter::get_ambient_temperature(uint16_t ptat){
+    /**
+    * Calculate the ambient (die) temperature of the sensor from its PTAT reading.
+    * @param ptat Raw PTAT value read from the sensor
+    * @return Ambient temperature in deg C
+    */
+    return ((-k_t1 + sqrtf(k_t1 * k_t1 - (4 * k_t2 * (v_th - ptat)))) / (2 * k_t2)) + 25.0;
+}
+
+void MLX90621Converter::set_ambient_temperature(float ambient_temperature){
+    /**
+    * Fold the ambient temperature into the per-pixel offsets and gains.
+    * The ambient temperature drifts slowly, so this does not need to be called every frame.
+    * @param ambient_temperature Ambient temperature of the sensor in deg C
+    */
+    float ambient_delta = ambient_temperature - 25.0;
+    float ambient_kelvin = ambient_temperature + 273.15;
+    float alpha_scale = (1 + ksta * ambient_delta) * emissivity;
+
+    ambient_fourth_power = ambient_kelvin * ambient_kelvin * ambient_kelvin * ambient_kelvin;
+    cp_offset = cp_offset_base + cp_offset_slope * ambient_delta;
+
+    for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+        pixel_offset[i] = pixel_offset_base[i] + pixel_offset_slope[i] * ambient_delta;
+        pixel_gain[i] = 1.0 / (alpha_scale * pixel_alpha[i]);
+    }
+}
+
+void MLX90621Converter::convert_frame(const int16_t ir_data[MLX90621_NUM_PIXELS], int16_t compensation_pixel, float frame_buffer[MLX90621_NUM_ROWS][MLX90621_NUM_COLS]){
+    /**
+    * Convert a frame of raw IR counts into temperatures.
+    * The conversion runs over contiguous arrays with no branches so the compiler can vectorise it.
+    * @param ir_data Raw IR data in the sensor's RAM order (column-major)
+    * @param compensation_pixel Raw value of the compensation pixel for this frame
+    * @param frame_buffer A 2D array to write the pixel temperatures into, in deg C
+    */
+    float tgc_offset = tgc * (compensation_pixel - cp_offset);
+
+    for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+        float compensated = (ir_data[i] - pixel_offset[i] - tgc_offset) * pixel_gain[i] + ambient_fourth_power;
+        frame_scratch[i] = sqrtf(sqrtf(compensated)) - 273.15;
+    }
+
+    // The sensor stores its pixels column-major; transpose into the tracker's row-major layout
+    for (int col = 0; col < MLX90621_NUM_COLS; col++) {
+        for (int row = 0; row < MLX90621_NUM_ROWS; row++) {
+            frame_buffer[row][col] = frame_scratch[col * MLX90621_NUM_ROWS + row];
+        }
+    }
+}
+
+void MLX90621Converter::convert_frame_reference(const uint8_t eeprom[MLX90621_EEPROM_SIZE], int resolution, float ambient_temperature, const int16_t ir_data[MLX90621_NUM_PIXELS], int16_t compensation_pixel, float frame_buffer[MLX90621_NUM_ROWS][MLX90621_NUM_COLS]){
+    /**
+    * Convert a frame of raw IR counts into temperatures straight from the EEPROM, following the datasheet step by step.
+    * Nothing is cached, so this is slow; it is the reference that convert_frame is checked and benchmarked against.
+    * @param eeprom The 256 byte EEPROM dump of the sensor
+    * @param resolution ADC resolution setting of the sensor (0-3 for 15-18 bits)
+    * @param ambient_temperature Ambient temperature of the sensor in deg C
+    * @param ir_data Raw IR data in the sensor's RAM order (column-major)
+    * @param compensation_pixel Raw value of the compensation pixel for this frame
+    * @param frame_buffer A 2D array to write the pixel temperatures into, in deg C
+    */
+    float resolution_comp = pow(2.0, 3 - resolution);
+    int a_i_scale = (eeprom[CAL_AI_BI_SCALE] & 0xF0) >> 4;
+    int b_i_scale = eeprom[CAL_AI_BI_SCALE] & 0x0F;
+
+    float a_cp = twos_16(eeprom[CAL_ACP_H], eeprom[CAL_ACP_L]) / resolution_comp;
+    float b_cp = twos_8(eeprom[CAL_BCP]) / (pow(2.0, b_i_scale) * resolution_comp);
+    float alpha_cp = unsigned_16(eeprom[CAL_ALPHA_CP_H], eeprom[CAL_ALPHA_CP_L]) / (pow(2.0, eeprom[CAL_A0_SCALE]) * resolution_comp);
+    float tgc = twos_8(eeprom[CAL_TGC]) / 32.0;
+    float ksta = twos_16(eeprom[CAL_KSTA_H], eeprom[CAL_KSTA_L]) / pow(2.0, 20);
+    float emissivity = unsigned_16(eeprom[CAL_EMIS_H], eeprom[CAL_EMIS_L]) / 32768.0;
+    float v_cp_off_comp = compensation_pixel - (a_cp + b_cp * (ambient_temperature - 25.0));
+
+    for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+        float a_ij = (twos_16(eeprom[CAL_ACOMMON_H], eeprom[CAL_ACOMMON_L]) + eeprom[CAL_A_I_START + i] * pow(2.0, a_i_scale)) / resolution_comp;
+        float b_ij = twos_8(eeprom[CAL_B_I_START + i]) / (pow(2.0, b_i_scale) * resolution_comp);
+        float alpha_ij = (unsigned_16(eeprom[CAL_A0_H], eeprom[CAL_A0_L]) / pow(2.0, eeprom[CAL_A0_SCALE]) + eeprom[CAL_DELTA_ALPHA_START + i] / pow(2.0, eeprom[CAL_DELTA_A_SCALE])) / resolution_comp;
+
+        float v_ir_off_comp = ir_data[i] - (a_ij + b_ij * (ambient_temperature - 25.0));
+        float v_ir_tgc_comp = v_ir_off_comp - tgc * v_cp_off_comp;
+        float v_ir_comp = v_ir_tgc_comp / emissivity;
+        float alpha_comp = (1 + ksta * (ambient_temperature - 25.0)) * (alpha_ij - tgc * alpha_cp);
+
+        frame_buffer[i % MLX90621_NUM_ROWS][i / MLX90621_NUM_ROWS] = pow((v_ir_comp / alpha_comp) + pow(ambient_temperature + 273.15, 4), 0.25) - 273.15;
+    }
+}
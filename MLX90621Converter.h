@@ -0,0 +1,75 @@
+#ifndef MLX90621_CONVERTER_H
+#define MLX90621_CONVERTER_H
+
+#include <Arduino.h>
+#include "ThermalTracker.h"
+
+const int MLX90621_NUM_ROWS = 4;
+const int MLX90621_NUM_COLS = 16;
+const int MLX90621_NUM_PIXELS = MLX90621_NUM_ROWS * MLX90621_NUM_COLS;
+const int MLX90621_EEPROM_SIZE = 256;
+const int MLX90621_DEFAULT_RESOLUTION = 3;
+
+// EEPROM calibration locations
+const int CAL_A_I_START = 0x00;
+const int CAL_B_I_START = 0x40;
+const int CAL_DELTA_ALPHA_START = 0x80;
+const int CAL_ACOMMON_L = 0xD0;
+const int CAL_ACOMMON_H = 0xD1;
+const int CAL_KT_SCALE = 0xD2;
+const int CAL_ACP_L = 0xD3;
+const int CAL_ACP_H = 0xD4;
+const int CAL_BCP = 0xD5;
+const int CAL_ALPHA_CP_L = 0xD6;
+const int CAL_ALPHA_CP_H = 0xD7;
+const int CAL_TGC = 0xD8;
+const int CAL_AI_BI_SCALE = 0xD9;
+const int CAL_VTH_L = 0xDA;
+const int CAL_VTH_H = 0xDB;
+const int CAL_KT1_L = 0xDC;
+const int CAL_KT1_H = 0xDD;
+const int CAL_KT2_L = 0xDE;
+const int CAL_KT2_H = 0xDF;
+const int CAL_A0_L = 0xE0;
+const int CAL_A0_H = 0xE1;
+const int CAL_A0_SCALE = 0xE2;
+const int CAL_DELTA_A_SCALE = 0xE3;
+const int CAL_EMIS_L = 0xE4;
+const int CAL_EMIS_H = 0xE5;
+const int CAL_KSTA_L = 0xE6;
+const int CAL_KSTA_H = 0xE7;
+
+class MLX90621Converter{
+public:
+    MLX90621Converter();
+    void load_calibration(const uint8_t eeprom[MLX90621_EEPROM_SIZE], int resolution = MLX90621_DEFAULT_RESOLUTION);
+    bool is_calibrated();
+    float get_ambient_temperature(uint16_t ptat);
+    void set_ambient_temperature(float ambient_temperature);
+    void convert_frame(const int16_t ir_data[MLX90621_NUM_PIXELS], int16_t compensation_pixel, float frame_buffer[MLX90621_NUM_ROWS][MLX90621_NUM_COLS]);
+
+    static void convert_frame_reference(const uint8_t eeprom[MLX90621_EEPROM_SIZE], int resolution, float ambient_temperature, const int16_t ir_data[MLX90621_NUM_PIXELS], int16_t compensation_pixel, float frame_buffer[MLX90621_NUM_ROWS][MLX90621_NUM_COLS]);
+
+private:
+    float pixel_offset_base[MLX90621_NUM_PIXELS];   /**< Ambient-independent IR offset (a_ij) of each pixel, in RAM order*/
+    float pixel_offset_slope[MLX90621_NUM_PIXELS];  /**< IR offset change per degree of ambient (b_ij) of each pixel, in RAM order*/
+    float pixel_alpha[MLX90621_NUM_PIXELS];         /**< Pixel sensitivity with the compensation pixel sensitivity removed (alpha_ij - tgc * alpha_cp)*/
+    float pixel_offset[MLX90621_NUM_PIXELS];        /**< Total IR offset of each pixel at the current ambient temperature*/
+    float pixel_gain[MLX90621_NUM_PIXELS];          /**< Reciprocal of the emissivity-scaled, ambient-compensated pixel sensitivity*/
+    float frame_scratch[MLX90621_NUM_PIXELS];       /**< Converted temperatures in RAM order, before being transposed into the frame*/
+
+    float cp_offset;    /**< IR offset of the compensation pixel at the current ambient temperature*/
+    float cp_offset_base;   /**< Ambient-independent IR offset of the compensation pixel*/
+    float cp_offset_slope;  /**< Compensation pixel IR offset change per degree of ambient*/
+    float alpha_cp;     /**< Sensitivity of the compensation pixel*/
+    float tgc;          /**< Thermal gradient coefficient*/
+    float ksta;         /**< Sensitivity change per degree of ambient*/
+    float emissivity;   /**< Emissivity of the observed objects*/
+    float v_th;         /**< PTAT voltage at 25 deg C*/
+    float k_t1;         /**< Linear PTAT coefficient*/
+    float k_t2;         /**< Quadratic PTAT coefficient*/
+    float ambient_fourth_power; /**< (Ta + 273.15)^4 at the current ambient temperature*/
+    bool calibrated;    /**< True once calibration constants have been loaded*/
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "MixtureBackground.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+MixtureBackground::MixtureBackground(int _num_pixels, float activation_sigma){
+    /**
+    * Create a mixture-of-gaussians background model.
+    * Every pixel is modelled by several gaussians so that pixels that flick between temperatures (vents, sun patches, etc.)
+    * can have more than one background state.
+    * Storage is allocated once here and is never resized.
+    * @param _num_pixels Number of pixels in each frame
+    * @param activation_sigma Number of standard deviations a temperature can be away from a gaussian and still match it
+    */
+    num_pixels = _num_pixels;
+    activation_sigma_squared = activation_sigma * activation_sigma;
+    pixel_components = new float[num_pixels][3][MIXTURE_NUM_GAUSSIANS];
+    reset();
+}
+
+MixtureBackground::~MixtureBackground(){
+    delete[] pixel_components;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void MixtureBackground::reset(){
+    /**
+    * Forget the background model. The next processed frame seeds the mixture again.
+    */
+    initialised = false;
+}
+
+void MixtureBackground::process_frame(const float frame[], float learning_rate, bool foreground[]){
+    /**
+    * Classify the pixels of a frame against the background, then fold the frame into the mixture.
+    * A pixel is foreground if it doesn't match any gaussian, or if the gaussian it matches is not one of the
+    * heaviest gaussians making up the first MIXTURE_BACKGROUND_RATIO of the pixel's weight.
+    * @param frame Pixel temperatures, row-major
+    * @param learning_rate Rate at which the mixture adapts to the new frame (0-1)
+    * @param foreground Output flags; true for every pixel that does not belong to the background
+    */
+    if (!initialised) {
+        for (int i = 0; i < num_pixels; i++) {
+            initialise_pixel(pixel_components[i], frame[i]);
+            foreground[i] = false;
+        }
+        initialised = true;
+        return;
+    }
+
+    for (int i = 0; i < num_pixels; i++) {
+        float (*components)[MIXTURE_NUM_GAUSSIANS] = pixel_components[i];
+        float temp = frame[i];
+        bool is_background = false;
+        int match = find_match(components, temp, is_background);
+
+        foreground[i] = !is_background;
+
+        // Decay all of the weights, then reinforce the matched gaussian
+        for (int k = 0; k < MIXTURE_NUM_GAUSSIANS; k++) {
+            components[WEIGHT][k] *= (1 - learning_rate);
+        }
+
+        if (match >= 0) {
+            float difference = temp - components[MEAN][match];
+            components[WEIGHT][match] += learning_rate;
+            components[MEAN][match] += learning_rate * difference;
+            components[VARIANCE][match] += learning_rate * (difference * difference - components[VARIANCE][match]);
+            if (components[VARIANCE][match] < MIXTURE_MINIMUM_VARIANCE) {
+                components[VARIANCE][match] = MIXTURE_MINIMUM_VARIANCE;
+            }
+        }
+
+        // No match; the least likely gaussian is replaced by the new temperature
+        else{
+            match = MIXTURE_NUM_GAUSSIANS - 1;
+            float total_weight = MIXTURE_INITIAL_WEIGHT;
+            for (int k = 0; k < match; k++) {
+                total_weight += components[WEIGHT][k];
+            }
+
+            components[WEIGHT][match] = MIXTURE_INITIAL_WEIGHT;
+            components[MEAN][match] = temp;
+            components[VARIANCE][match] = MIXTURE_INITIAL_VARIANCE;
+
+            for (int k = 0; k < MIXTURE_NUM_GAUSSIANS; k++) {
+                components[WEIGHT][k] /= total_weight;
+            }
+        }
+
+        // Only the updated gaussian can change rank; bubble it up by weight/deviation
+        // w1/sqrt(v1) > w0/sqrt(v0) is compared as w1^2 * v0 > w0^2 * v1 to avoid the roots
+        while (match > 0) {
+            float w0 = components[WEIGHT][match - 1];
+            float w1 = components[WEIGHT][match];
+            if (w1 * w1 * components[VARIANCE][match - 1] <= w0 * w0 * components[VARIANCE][match]) {
+                break;
+            }
+
+            for (int p = 0; p < 3; p++) {
+                float swap = components[p][match - 1];
+                components[p][match - 1] = components[p][match];
+                components[p][match] = swap;
+            }
+            match--;
+        }
+    }
+}
+
+void MixtureBackground::classify_frame(const float frame[], bool foreground[]){
+    /**
+    * Classify the pixels of a frame against the background without folding the frame into the mixture.
+    * This is the first half of process_frame on its own, for when there isn't time to learn from every frame.
+    * @param frame Pixel temperatures, row-major
+    * @param foreground Output flags; true for every pixel that does not belong to the background
+    */
+    for (int i = 0; i < num_pixels; i++) {
+        bool is_background = false;
+        find_match(pixel_components[i], frame[i], is_background);
+        foreground[i] = !is_background;
+    }
+}
+
+void MixtureBackground::get_averages(float averages[]){
+    /**
+    * Get the mean of the most likely background gaussian of every pixel.
+    * @param averages Output array of the background temperatures, in deg C
+    */
+    for (int i = 0; i < num_pixels; i++) {
+        averages[i] = pixel_components[i][MEAN][0];
+    }
+}
+
+void MixtureBackground::get_deviations(float deviations[]){
+    /**
+    * Get the standard deviation of the most likely background gaussian of every pixel.
+    * @param deviations Output array of the background deviations, in deg C
+    */
+    for (int i = 0; i < num_pixels; i++) {
+        deviations[i] = sqrtf(pixel_components[i][VARIANCE][0]);
+    }
+}
+
+size_t MixtureBackground::get_memory_usage(){
+    /**
+    * Get the number of bytes used by the mixture, including its heap storage.
+    * @return Memory usage in bytes
+    */
+    return sizeof(MixtureBackground) + size_t(num_pixels) * sizeof(pixel_components[0]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private Methods
+
+int MixtureBackground::find_match(float components[3][MIXTURE_NUM_GAUSSIANS], float temperature, bool& is_background){
+    /**
+    * Find the first (most likely) gaussian of a pixel that a temperature falls inside of.
+    * @param components Weight, mean and variance of the pixel's gaussians
+    * @param temperature Temperature of the pixel in the current frame
+    * @param is_background Set to true if the matched gaussian is part of the background
+    * @return Index of the matched gaussian, or -1 if none match
+    */
+    float background_weight = 0;
+    for (int k = 0; k < MIXTURE_NUM_GAUSSIANS; k++) {
+        float difference = temperature - components[MEAN][k];
+        if (difference * difference < activation_sigma_squared * components[VARIANCE][k]) {
+            is_background = background_weight < MIXTURE_BACKGROUND_RATIO;
+            return k;
+        }
+        background_weight += components[WEIGHT][k];
+    }
+
+    return -1;
+}
+
+void MixtureBackground::initialise_pixel(float components[3][MIXTURE_NUM_GAUSSIANS], float temperature){
+    /**
+    * Seed a pixel's mixture with a single gaussian at the given temperature.
+    * @param components The pixel's gaussian parameters
+    * @param temperature Initial background temperature of the pixel
+    */
+    for (int k = 0; k < MIXTURE_NUM_GAUSSIANS; k++) {
+        components[WEIGHT][k] = 0;
+        components[MEAN][k] = temperature;
+        components[VARIANCE][k] = MIXTURE_INITIAL_VARIANCE;
+    }
+    components[WEIGHT][0] = 1;
+}
@@ -0,0 +1,42 @@
+#ifndef MIXTURE_BACKGROUND_H
+#define MIXTURE_BACKGROUND_H
+
+#include <Arduino.h>
+
+const int MIXTURE_NUM_GAUSSIANS = 3;
+const float MIXTURE_BACKGROUND_RATIO = 0.7;
+const float MIXTURE_INITIAL_VARIANCE = 1.0;
+const float MIXTURE_INITIAL_WEIGHT = 0.05;
+const float MIXTURE_MINIMUM_VARIANCE = 0.01;
+
+enum mixture_parameters {
+    WEIGHT      = 0,
+    MEAN        = 1,
+    VARIANCE    = 2
+};
+
+class MixtureBackground{
+public:
+    MixtureBackground(int num_pixels, float activation_sigma);
+    ~MixtureBackground();
+    MixtureBackground(const MixtureBackground&) = delete;            // Owns its gaussians
+    MixtureBackground& operator=(const MixtureBackground&) = delete;
+    void reset();
+    void process_frame(const float frame[], float learning_rate, bool foreground[]);
+    void classify_frame(const float frame[], bool foreground[]);
+    void get_averages(float averages[]);
+    void get_deviations(float deviations[]);
+    size_t get_memory_usage();
+
+private:
+    friend class ThermalTrackerTest;    // Defined by the test sketch, host tests and benchmarks to reach the internals
+    int find_match(float components[3][MIXTURE_NUM_GAUSSIANS], float temperature, bool& is_background);
+    void initialise_pixel(float components[3][MIXTURE_NUM_GAUSSIANS], float temperature);
+
+    float (*pixel_components)[3][MIXTURE_NUM_GAUSSIANS];  /**< Weight, mean and variance of every gaussian, grouped by pixel. Gaussians are kept sorted with the most likely background first*/
+    int num_pixels;     /**< Number of pixels modelled by the mixture*/
+    float activation_sigma_squared; /**< Squared number of standard deviations a temperature may differ from a gaussian and still match it*/
+    bool initialised;   /**< False until the first frame has seeded the mixture*/
+};
+
+#endif
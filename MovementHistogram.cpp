@@ -0,0 +1,198 @@
+#include "MovementHistogram.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+MovementHistogram::MovementHistogram(int _num_buckets, unsigned long _bucket_width, int _num_categories){
+    /**
+    * Create a ring of time buckets that movements are counted into, so rates can be read off the device directly
+    * instead of by polling and differencing the running totals.
+    * Each slot remembers which bucket width it was last used for. A slot left over from an older lap of the ring is
+    * treated as empty when read, and is reset when it is next added to, so nothing has to be swept as time passes.
+    * Buckets are counted by the histogram's own clock, which steps forward by the time since it was last called. It keeps
+    * counting up when millis() wraps after about 49.7 days, as long as it is called at least every 24.8 days.
+    * Storage is allocated once here and is never resized.
+    * @param _num_buckets Number of buckets to keep; the oldest is overwritten once they are full
+    * @param _bucket_width Length of time covered by each bucket, in ms
+    * @param _num_categories Number of movement directions to count in each bucket
+    */
+    num_buckets = max(_num_buckets, 1);
+    bucket_width = max(_bucket_width, 1UL);
+    num_categories = max(_num_categories, 1);
+    counts = new uint16_t[num_buckets * num_categories];
+    epochs = new unsigned long[num_buckets];
+    used = new bool[num_buckets];
+    clock_started = false;
+    clock_time = 0;
+    clock_epoch = 0;
+    clear();
+}
+
+MovementHistogram::~MovementHistogram(){
+    delete[] counts;
+    delete[] epochs;
+    delete[] used;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void MovementHistogram::advance(unsigned long now){
+    /**
+    * Move the clock up to the given time without counting anything.
+    * Call this regularly, such as every frame, so quiet spells don't leave the clock behind when millis() wraps.
+    * @param now Current time, in ms since start up
+    */
+    get_epoch(now);
+}
+
+void MovementHistogram::add(int category, unsigned long now){
+    /**
+    * Count a movement in the bucket covering the given time.
+    * @param category Direction of the movement
+    * @param now Time of the movement, in ms since start up
+    */
+    if (category < 0 || category >= num_categories) {
+        return;
+    }
+
+    unsigned long epoch = get_epoch(now);
+    int slot = epoch % num_buckets;
+
+    // Too old to still be in the ring
+    if (clock_epoch - epoch >= (unsigned long)num_buckets) {
+        return;
+    }
+
+    // Reuse a slot from an older lap of the ring
+    if (!used[slot] || epochs[slot] != epoch) {
+        for (int c = 0; c < num_categories; c++) {
+            counts[slot * num_categories + c] = 0;
+        }
+        epochs[slot] = epoch;
+        used[slot] = true;
+    }
+
+    uint16_t& count = counts[slot * num_categories + category];
+    if (count < MAX_BUCKET_COUNT) {
+        count++;
+    }
+}
+
+void MovementHistogram::get_bucket(int age, unsigned long now, long bucket_counts[]){
+    /**
+    * Get the movement counts of a single bucket.
+    * @param age Number of buckets back from the one covering now; 0 is the current, still filling, bucket
+    * @param now Current time, in ms since start up
+    * @param bucket_counts Output array of num_categories counts; all zero if nothing was counted in the bucket
+    */
+    int slot = -1;
+    unsigned long current_epoch = get_epoch(now);
+    if (age >= 0 && age < num_buckets && (unsigned long)age <= current_epoch) {
+        slot = find_bucket(current_epoch - age);
+    }
+
+    for (int c = 0; c < num_categories; c++) {
+        bucket_counts[c] = slot >= 0 ? counts[slot * num_categories + c] : 0;
+    }
+}
+
+void MovementHistogram::get_rollup(int num_recent_buckets, unsigned long now, long rollup_counts[]){
+    /**
+    * Get the total movement counts over the most recent buckets, such as the last hour of one minute buckets.
+    * @param num_recent_buckets Number of buckets to add up, including the current one; limited to the number kept
+    * @param now Current time, in ms since start up
+    * @param rollup_counts Output array of num_categories counts
+    */
+    unsigned long current_epoch = get_epoch(now);
+    for (int c = 0; c < num_categories; c++) {
+        rollup_counts[c] = 0;
+    }
+
+    for (int age = 0; age < min(num_recent_buckets, num_buckets) && (unsigned long)age <= current_epoch; age++) {
+        int slot = find_bucket(current_epoch - age);
+        if (slot < 0) {
+            continue;
+        }
+
+        for (int c = 0; c < num_categories; c++) {
+            rollup_counts[c] += counts[slot * num_categories + c];
+        }
+    }
+}
+
+void MovementHistogram::clear(){
+    /**
+    * Empty every bucket.
+    */
+    for (int i = 0; i < num_buckets; i++) {
+        epochs[i] = 0;
+        used[i] = false;
+    }
+}
+
+int MovementHistogram::get_num_buckets(){
+    /**
+    * @return Number of buckets kept
+    */
+    return num_buckets;
+}
+
+unsigned long MovementHistogram::get_bucket_width(){
+    /**
+    * @return Length of time covered by each bucket, in ms
+    */
+    return bucket_width;
+}
+
+size_t MovementHistogram::get_memory_usage(){
+    /**
+    * Get the number of bytes used by the histogram, including its heap storage.
+    * @return Memory usage in bytes
+    */
+    return sizeof(MovementHistogram) + num_buckets * (num_categories * sizeof(uint16_t) + sizeof(unsigned long) + sizeof(bool));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private Methods
+
+int MovementHistogram::find_bucket(unsigned long epoch){
+    /**
+    * Find the slot holding a bucket.
+    * @param epoch Which bucket width since start up the bucket covers
+    * @return Slot of the bucket, or -1 if nothing has been counted in it
+    */
+    int slot = epoch % num_buckets;
+    if (!used[slot] || epochs[slot] != epoch) {
+        return -1;
+    }
+
+    return slot;
+}
+
+unsigned long MovementHistogram::get_epoch(unsigned long now){
+    /**
+    * Find which bucket a time falls in, moving the clock forward if the time is past the current bucket.
+    * Differences are taken between unsigned times, so they come out right across a millis() wrap. Times up to about
+    * 24.8 days behind the clock are taken as being in the past rather than far in the future.
+    * Until millis() first wraps, buckets start at multiples of the bucket width, the same as now / bucket_width.
+    * @param now Time, in ms since start up
+    * @return Number of the bucket covering the time
+    */
+    if (!clock_started) {
+        clock_started = true;
+        clock_epoch = now / bucket_width;
+        clock_time = now - now % bucket_width;
+    }
+
+    unsigned long elapsed = now - clock_time;
+    if (long(elapsed) >= 0) {
+        unsigned long steps = elapsed / bucket_width;
+        clock_epoch += steps;
+        clock_time += steps * bucket_width;
+        return clock_epoch;
+    }
+
+    unsigned long behind = clock_time - now;
+    return clock_epoch - (behind + bucket_width - 1) / bucket_width;
+}
@@ -0,0 +1,39 @@
+#ifndef MOVEMENT_HISTOGRAM_H
+#define MOVEMENT_HISTOGRAM_H
+
+#include <Arduino.h>
+
+const uint16_t MAX_BUCKET_COUNT = 0xFFFF;
+
+class MovementHistogram{
+public:
+    MovementHistogram(int num_buckets, unsigned long bucket_width, int num_categories);
+    ~MovementHistogram();
+    MovementHistogram(const MovementHistogram&) = delete;           // Owns its buckets
+    MovementHistogram& operator=(const MovementHistogram&) = delete;
+    void advance(unsigned long now);
+    void add(int category, unsigned long now);
+    void get_bucket(int age, unsigned long now, long counts[]);
+    void get_rollup(int num_recent_buckets, unsigned long now, long counts[]);
+    void clear();
+    int get_num_buckets();
+    unsigned long get_bucket_width();
+    size_t get_memory_usage();
+
+private:
+    friend class ThermalTrackerTest;    // Defined by the test sketch, host tests and benchmarks to reach the internals
+    int find_bucket(unsigned long epoch);
+    unsigned long get_epoch(unsigned long now);
+
+    int num_buckets;        /**< Number of buckets in the ring*/
+    unsigned long bucket_width; /**< Length of time covered by each bucket, in ms*/
+    int num_categories;     /**< Number of movement directions counted in each bucket*/
+    uint16_t* counts;       /**< Movement counts; num_buckets rows of num_categories, saturating at MAX_BUCKET_COUNT*/
+    unsigned long* epochs;  /**< Which bucket, counted by the histogram's clock, each slot of the ring was last used for*/
+    bool* used;             /**< Whether each slot of the ring has been used since it was cleared*/
+    bool clock_started;     /**< Whether the clock has been set from a first time yet*/
+    unsigned long clock_time;   /**< Start of the current bucket, in the caller's ms; wraps along with millis()*/
+    unsigned long clock_epoch;  /**< Number of the current bucket; keeps counting up when millis() wraps*/
+};
+
+#endif
@@ -0,0 +1,421 @@
+#include "PipelinedTracker.h"
+
+// Host builds only; the ESP8266 has a single core and no threads
+#ifndef ARDUINO
+
+#include <chrono>
+
+////////////////////////////////////////////////////////////////////////////////
+// Slot queue
+
+SlotQueue::SlotQueue(int _capacity){
+    /**
+    * Create a fixed size single producer, single consumer queue of slot indexes.
+    * Only one thread may push and only one other thread may pop; neither ever blocks or locks.
+    * @param _capacity Most values the queue can hold
+    */
+    capacity = _capacity;
+    values = new int[capacity];
+    head = 0;
+    tail = 0;
+}
+
+SlotQueue::~SlotQueue(){
+    delete[] values;
+}
+
+bool SlotQueue::push(int value){
+    /**
+    * Add a value to the back of the queue.
+    * @param value Value to add
+    * @return True if it was added, false if the queue was full
+    */
+    unsigned long position = tail.load(std::memory_order_relaxed);
+    if (position - head.load(std::memory_order_acquire) >= (unsigned long)capacity) {
+        return false;
+    }
+
+    values[position % capacity] = value;
+    tail.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool SlotQueue::pop(int& value){
+    /**
+    * Take the value from the front of the queue.
+    * @param value Output for the value
+    * @return True if a value was taken, false if the queue was empty
+    */
+    unsigned long position = head.load(std::memory_order_relaxed);
+    if (position == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    value = values[position % capacity];
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+int SlotQueue::size(){
+    /**
+    * @return Number of values in the queue; only a snapshot if the other thread is active
+    */
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+PipelinedTracker::PipelinedTracker(ThermalTracker& _tracker, int _feedback_delay):
+    tracker(_tracker),
+    free_slots(PIPELINE_DEPTH),
+    ingest_queue(PIPELINE_DEPTH + 1),
+    labelling_queue(PIPELINE_DEPTH + 1),
+    association_queue(PIPELINE_DEPTH + 1),
+    decision_queue(PIPELINE_DEPTH + max(_feedback_delay, 0) + 1){
+    /**
+    * Split a tracker's per-frame work over three threads, for high frame rate sensors on a multi-core host.
+    * The ingest stage loads and classifies each frame and keeps the background, the labelling stage finds the blobs,
+    * and the association stage tracks them and does the counting.
+    * Whether a frame goes into the background depends on its blobs, so the ingest stage has to wait for that decision
+    * before it can classify later frames. With a feedback delay of 0 it waits for the previous frame and the results are
+    * identical to ThermalTracker::process_frame; with a delay of n it may run n tracked frames ahead, so it overlaps
+    * with the labelling stage and the background update lags by n frames. The results are deterministic either way.
+    * The tracker must not be used directly while the pipeline is running, and must not have upsampling or the pyramid on.
+    * @param _tracker Tracker to run; its settings, background and counts are used and updated in place
+    * @param _feedback_delay Number of tracked frames the ingest stage may run ahead of the background decisions
+    */
+    feedback_delay = max(_feedback_delay, 0);
+    history = new float[feedback_delay + 1][FRAME_HEIGHT][FRAME_WIDTH];
+    num_sent_frames = 0;
+    num_decided_frames = 0;
+    running = false;
+    num_drains = 0;
+    start_time = 0;
+
+    for (int slot = 0; slot < PIPELINE_DEPTH; slot++) {
+        slots[slot].blobs = new Blob[tracker.max_blobs];
+        slots[slot].track = false;
+        free_slots.push(slot);
+    }
+
+    for (int stage = 0; stage < NUM_PIPELINE_STAGES; stage++) {
+        busy_time[stage] = 0;
+        num_frames[stage] = 0;
+        total_queue_depth[stage] = 0;
+        max_queue_depth[stage] = 0;
+    }
+}
+
+PipelinedTracker::~PipelinedTracker(){
+    stop();
+
+    for (int slot = 0; slot < PIPELINE_DEPTH; slot++) {
+        delete[] slots[slot].blobs;
+    }
+
+    delete[] history;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+bool PipelinedTracker::start(){
+    /**
+    * Start the stage threads.
+    * @return True if the pipeline is running, false if the tracker has upsampling or the pyramid on
+    */
+    if (running) {
+        return true;
+    }
+
+    // Those detect on their own grids, which aren't staged through the slots
+    if (tracker.upsampler != NULL || tracker.pyramid != NULL) {
+        return false;
+    }
+
+    start_time = get_time();
+    running = true;
+    threads[INGEST_STAGE] = std::thread(&PipelinedTracker::ingest_stage, this);
+    threads[LABELLING_STAGE] = std::thread(&PipelinedTracker::labelling_stage, this);
+    threads[ASSOCIATION_STAGE] = std::thread(&PipelinedTracker::association_stage, this);
+    return true;
+}
+
+void PipelinedTracker::stop(){
+    /**
+    * Stop the stage threads. Frames still in flight are dropped; flush() first to keep them.
+    */
+    if (!running) {
+        return;
+    }
+
+    running = false;
+    for (int stage = 0; stage < NUM_PIPELINE_STAGES; stage++) {
+        threads[stage].join();
+    }
+}
+
+void PipelinedTracker::process_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Queue an input thermal frame.
+    * @param frame_buffer A 2D array containing the pixel temperatures from the thermopile sensor.
+    */
+    process_frame(&frame_buffer[0][0], FRAME_WIDTH);
+}
+
+void PipelinedTracker::process_frame(const float frame_buffer[], int stride, bool column_major){
+    /**
+    * Queue an input thermal frame. It is copied, so the buffer can be reused as soon as this returns.
+    * Waits for a free slot if every slot is in flight. Frames are dropped unless the pipeline has been started,
+    * since nothing would ever free a slot for them.
+    * @param frame_buffer Pixel temperatures in deg C
+    * @param stride Number of floats between the start of each row, or of each column if column_major
+    * @param column_major True if the pixels are stored column by column, like the MLX90621's RAM
+    */
+    if (!running) {
+        return;
+    }
+
+    int row_step = column_major ? 1 : stride;
+    int column_step = column_major ? stride : 1;
+    int slot;
+    while (!free_slots.pop(slot)) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            slots[slot].frame[i][j] = frame_buffer[i * row_step + j * column_step];
+        }
+    }
+
+    wait_push(ingest_queue, slot);
+}
+
+void PipelinedTracker::flush(){
+    /**
+    * Wait until every queued frame has been tracked and its background decision applied.
+    * The tracker's counts, movements and stats can then be read, until the next frame is queued.
+    */
+    if (!running) {
+        return;
+    }
+
+    long target = num_drains + 1;
+    wait_push(ingest_queue, PIPELINE_DRAIN);
+    while (num_drains < target) {
+        std::this_thread::yield();
+    }
+}
+
+PipelineStageStats PipelinedTracker::get_stage_stats(int stage){
+    /**
+    * Get how busy a stage has been and how far frames have backed up in front of it, to find the bottleneck.
+    * Only read this after flush() or stop().
+    * @param stage Stage to get the stats of (INGEST_STAGE, LABELLING_STAGE or ASSOCIATION_STAGE)
+    * @return Stats of the stage since the pipeline started
+    */
+    PipelineStageStats stats;
+    stage = constrain(stage, 0, NUM_PIPELINE_STAGES - 1);
+    double elapsed = get_time() - start_time;
+
+    stats.num_frames = num_frames[stage];
+    stats.occupancy = elapsed > 0 ? busy_time[stage] / elapsed : 0;
+    stats.mean_queue_depth = num_frames[stage] > 0 ? double(total_queue_depth[stage]) / num_frames[stage] : 0;
+    stats.max_queue_depth = max_queue_depth[stage];
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stages
+
+void PipelinedTracker::ingest_stage(){
+    /**
+    * Load, calibrate and classify each frame, and keep the background.
+    * Mirrors the first half of ThermalTracker::process_frame.
+    */
+    int slot;
+    while (wait_pop(ingest_queue, INGEST_STAGE, slot)) {
+        double begin = get_time();
+
+        // Flushing; catch up on every outstanding decision so the background matches the serial tracker
+        if (slot == PIPELINE_DRAIN) {
+            while (running && num_decided_frames < num_sent_frames) {
+                apply_background_decision();
+            }
+
+            busy_time[INGEST_STAGE] += get_time() - begin;
+            wait_push(labelling_queue, PIPELINE_DRAIN);
+            continue;
+        }
+
+        while (running && num_sent_frames - num_decided_frames > feedback_delay) {
+            apply_background_decision();
+        }
+
+        PipelineSlot& frame_slot = slots[slot];
+        tracker.load_frame(frame_slot.frame);
+        frame_slot.track = false;
+
+        if (tracker.background_model == MIXTURE_BACKGROUND) {
+            tracker.add_frame_to_mixture_background();
+        }
+
+        // Frames that go into checking a restored background aren't tracked, same as in process_frame
+        bool validating = tracker.num_validation_frames > 0 && tracker.validate_restored_background();
+        if (!validating && !tracker.finished_building_background()) {
+            tracker.build_background();
+        }
+        else if (!validating) {
+            // Calibrated frames are staged in the tracker, so they're copied back into the slot for the later stages
+            const float* loaded = tracker.get_row_major_frame();
+            const bool* mask = &tracker.active_mask[0][0];
+            if (tracker.background_model == MIXTURE_BACKGROUND) {
+                mask = &tracker.foreground[0][0];
+            }
+
+            float* frame = &frame_slot.frame[0][0];
+            float* frame_history = &history[num_sent_frames % (feedback_delay + 1)][0][0];
+            for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+                frame[i] = loaded[i];
+                frame_history[i] = loaded[i];
+                (&frame_slot.mask[0][0])[i] = mask[i];
+            }
+
+            frame_slot.track = true;
+            num_sent_frames++;
+        }
+
+        busy_time[INGEST_STAGE] += get_time() - begin;
+        wait_push(labelling_queue, slot);
+    }
+}
+
+void PipelinedTracker::labelling_stage(){
+    /**
+    * Find the blobs in each tracked frame and decide whether it goes into the background.
+    */
+    bool unlabelled[FRAME_WIDTH * FRAME_HEIGHT];
+    pixel_index fill_queue[FRAME_WIDTH * FRAME_HEIGHT];
+
+    int slot;
+    while (wait_pop(labelling_queue, LABELLING_STAGE, slot)) {
+        double begin = get_time();
+
+        if (slot != PIPELINE_DRAIN && slots[slot].track) {
+            PipelineSlot& frame_slot = slots[slot];
+            tracker.clear_blobs(frame_slot.blobs);
+            tracker.label_blobs(frame_slot.blobs, &frame_slot.mask[0][0], FRAME_WIDTH, FRAME_HEIGHT, &frame_slot.frame[0][0], FRAME_WIDTH, 1, unlabelled, fill_queue);
+            tracker.remove_small_blobs(frame_slot.blobs);
+            bool add_frame_to_average = tracker.check_background_activity(tracker.get_num_blobs(frame_slot.blobs));
+            wait_push(decision_queue, add_frame_to_average);
+        }
+
+        busy_time[LABELLING_STAGE] += get_time() - begin;
+        wait_push(association_queue, slot);
+    }
+}
+
+void PipelinedTracker::association_stage(){
+    /**
+    * Match each tracked frame's blobs to the tracked blobs and count the movements.
+    * Exclusion learning isn't run in the pipeline.
+    * The movement histogram is advanced here rather than in the ingest stage, since this is the stage that adds to it.
+    */
+    int slot;
+    while (wait_pop(association_queue, ASSOCIATION_STAGE, slot)) {
+        double begin = get_time();
+
+        if (slot == PIPELINE_DRAIN) {
+            busy_time[ASSOCIATION_STAGE] += get_time() - begin;
+            num_drains++;
+            continue;
+        }
+
+        // Keep the histogram's clock close behind millis() on every frame, same as in process_frame
+        if (tracker.movement_histogram != NULL) {
+            tracker.movement_histogram->advance(millis());
+        }
+
+        if (slots[slot].track) {
+            tracker.track_blobs(slots[slot].blobs, tracker.tracked_blobs);
+            tracker.count_people_in_view();
+        }
+
+        busy_time[ASSOCIATION_STAGE] += get_time() - begin;
+        wait_push(free_slots, slot);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private Methods
+
+void PipelinedTracker::apply_background_decision(){
+    /**
+    * Wait for the labelling stage's decision on the oldest undecided frame, and add that frame to the background if it was quiet.
+    * Only called from the ingest stage.
+    */
+    int add_frame_to_average;
+    while (!decision_queue.pop(add_frame_to_average)) {
+        if (!running) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    if (add_frame_to_average) {
+        // The history is already calibrated, so it is pointed at rather than loaded again
+        tracker.frame_data = &history[num_decided_frames % (feedback_delay + 1)][0][0];
+        tracker.frame_row_step = FRAME_WIDTH;
+        tracker.frame_column_step = 1;
+        tracker.add_frame_to_background();
+    }
+
+    num_decided_frames++;
+}
+
+bool PipelinedTracker::wait_pop(SlotQueue& queue, int stage, int& value){
+    /**
+    * Wait for the next value in a stage's input queue, and note how far the queue had backed up.
+    * @param queue Input queue of the stage
+    * @param stage Stage taking the value
+    * @param value Output for the value
+    * @return True if a value was taken, false if the pipeline was stopped first
+    */
+    while (running) {
+        int depth = queue.size();
+        if (queue.pop(value)) {
+            if (value != PIPELINE_DRAIN) {
+                num_frames[stage]++;
+                total_queue_depth[stage] += depth;
+                max_queue_depth[stage] = max(max_queue_depth[stage], depth);
+            }
+            return true;
+        }
+
+        std::this_thread::yield();
+    }
+
+    return false;
+}
+
+void PipelinedTracker::wait_push(SlotQueue& queue, int value){
+    /**
+    * Add a value to a queue, waiting for room if it is full.
+    * @param queue Queue to add to
+    * @param value Value to add
+    */
+    while (!queue.push(value) && running) {
+        std::this_thread::yield();
+    }
+}
+
+double PipelinedTracker::get_time(){
+    /**
+    * @return Time on the host's monotonic clock, in s
+    */
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
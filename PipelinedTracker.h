@@ -0,0 +1,93 @@
+#ifndef PIPELINED_TRACKER_H
+#define PIPELINED_TRACKER_H
+
+// Host builds only; the ESP8266 has a single core and no threads
+#ifndef ARDUINO
+
+#include "ThermalTracker.h"
+#include <atomic>
+#include <thread>
+
+const int PIPELINE_DEPTH = 4;
+const int PIPELINE_FEEDBACK_DELAY = 1;
+const int PIPELINE_DRAIN = -1;
+
+enum pipeline_stages {
+    INGEST_STAGE        = 0,
+    LABELLING_STAGE     = 1,
+    ASSOCIATION_STAGE   = 2,
+    NUM_PIPELINE_STAGES = 3
+};
+
+struct PipelineStageStats {
+    long num_frames;        /**< Number of frames the stage has processed*/
+    double occupancy;       /**< Fraction of the time since the pipeline started that the stage was busy*/
+    double mean_queue_depth;    /**< Average number of frames waiting for the stage each time it took one, including that one*/
+    int max_queue_depth;    /**< Most frames ever waiting for the stage*/
+};
+
+struct PipelineSlot {
+    float frame[FRAME_HEIGHT][FRAME_WIDTH]; /**< Frame as submitted, then as loaded (calibrated) by the ingest stage*/
+    bool mask[FRAME_HEIGHT][FRAME_WIDTH];   /**< Active pixels found by the ingest stage*/
+    Blob* blobs;        /**< Blobs found by the labelling stage; max_blobs long*/
+    bool track;         /**< False for frames that only went into the background*/
+};
+
+class SlotQueue{
+public:
+    SlotQueue(int capacity);
+    ~SlotQueue();
+    bool push(int value);
+    bool pop(int& value);
+    int size();
+
+private:
+    int capacity;   /**< Most values the queue can hold*/
+    int* values;    /**< Ring of queued values*/
+    std::atomic<unsigned long> head;    /**< Number of values ever popped; only written by the consumer*/
+    std::atomic<unsigned long> tail;    /**< Number of values ever pushed; only written by the producer*/
+};
+
+class PipelinedTracker{
+public:
+    PipelinedTracker(ThermalTracker& _tracker, int _feedback_delay = PIPELINE_FEEDBACK_DELAY);
+    ~PipelinedTracker();
+    bool start();
+    void stop();
+    void process_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]);
+    void process_frame(const float frame_buffer[], int stride, bool column_major = false);
+    void flush();
+    PipelineStageStats get_stage_stats(int stage);
+
+private:
+    void ingest_stage();
+    void labelling_stage();
+    void association_stage();
+    void apply_background_decision();
+    bool wait_pop(SlotQueue& queue, int stage, int& value);
+    void wait_push(SlotQueue& queue, int value);
+    double get_time();
+
+    ThermalTracker& tracker;    /**< Tracker whose work is split over the stages*/
+    int feedback_delay;     /**< Number of tracked frames the ingest stage may run ahead of the background decisions*/
+    PipelineSlot slots[PIPELINE_DEPTH];     /**< Frames in flight*/
+    SlotQueue free_slots;   /**< Slots waiting for a new frame; association stage to the caller*/
+    SlotQueue ingest_queue; /**< Submitted frames; caller to the ingest stage*/
+    SlotQueue labelling_queue;  /**< Classified frames; ingest stage to the labelling stage*/
+    SlotQueue association_queue;    /**< Labelled frames; labelling stage to the association stage*/
+    SlotQueue decision_queue;   /**< Whether each tracked frame goes into the background; labelling stage to the ingest stage*/
+    float (*history)[FRAME_HEIGHT][FRAME_WIDTH];    /**< Tracked frames still waiting on their background decision; feedback_delay + 1 of them*/
+    long num_sent_frames;   /**< Number of tracked frames the ingest stage has passed on*/
+    long num_decided_frames;    /**< Number of background decisions the ingest stage has applied*/
+    std::atomic<bool> running;  /**< Cleared to stop the stage threads*/
+    std::atomic<long> num_drains;   /**< Number of flushes that have made it through every stage*/
+    std::thread threads[NUM_PIPELINE_STAGES];   /**< One thread per stage*/
+    double start_time;      /**< When the pipeline started, in s*/
+    double busy_time[NUM_PIPELINE_STAGES];  /**< Time each stage has spent working, in s*/
+    long num_frames[NUM_PIPELINE_STAGES];   /**< Frames each stage has processed*/
+    long total_queue_depth[NUM_PIPELINE_STAGES];    /**< Sum of the queue depths each stage saw when it took a frame*/
+    int max_queue_depth[NUM_PIPELINE_STAGES];   /**< Deepest queue each stage has seen*/
+};
+
+#endif
+#endif
@@ -1,4 +1,8 @@
 #include "Pixel.h"
+#include <Arduino.h>
+
+// Rounded up to a whole word, the fields are all a Pixel may take
+static_assert(sizeof(Pixel) <= (sizeof(pixel_temperature) + 2 * sizeof(pixel_coordinate) + 3) / 4 * 4, "Pixel has grown past its fields");
 
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
@@ -35,14 +39,19 @@ void Pixel::set(int x, int y, float temperature){
     * Set the pixels' values
     * @param x The column location of the pixel (should be positive)
     * @param y The row location of the pixel (should be positive)
-    * @param temperature Recorded temperature of the pixel (in °C)
+    * @param temperature Recorded temperature of the pixel (in °C); rounded to 0.01 °C with THERMAL_TRACKER_COMPACT_TEMPERATURES
     *
     * AN: The temperature field could probably be changed to a standard value field for use with normal camera pixels
     *   - (As long as they're greyscale)
     */
     _x = x;
     _y = y;
+#ifdef THERMAL_TRACKER_COMPACT_TEMPERATURES
+    temperature = constrain(temperature, -PIXEL_MAX_TEMPERATURE, PIXEL_MAX_TEMPERATURE);
+    _temperature = lroundf(temperature * PIXEL_STEPS_PER_DEGREE);
+#else
     _temperature = temperature;
+#endif
 }
 
 int Pixel::get_x(){
@@ -66,7 +75,11 @@ float Pixel::get_temperature(){
     * Get the recorded temperature of the pixel
     * @return Pixel temperature in deg C
     */
+#ifdef THERMAL_TRACKER_COMPACT_TEMPERATURES
+    return float(_temperature) / PIXEL_STEPS_PER_DEGREE;
+#else
     return _temperature;
+#endif
 }
 
 bool Pixel::is_adjacent(Pixel other_pixel){
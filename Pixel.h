@@ -1,5 +1,5 @@
-// #ifndef PIXEL_H
-// #define PIXEL_H
+#ifndef PIXEL_H
+#define PIXEL_H
 
 // #if defined(ARDUINO) && ARDUINO >= 100
 	// #include "Arduino.h"
@@ -7,6 +7,49 @@
 	// #include "WProgram.h"
 // #endif
 
+#include <stdint.h>
+
+// The frame size defaults to the MLX90621. For a larger sensor, define these as build flags so every file in the library sees the same size
+#ifndef THERMAL_TRACKER_FRAME_WIDTH
+#define THERMAL_TRACKER_FRAME_WIDTH 16
+#endif
+
+#ifndef THERMAL_TRACKER_FRAME_HEIGHT
+#define THERMAL_TRACKER_FRAME_HEIGHT 4
+#endif
+
+// Coordinates on the detection grid, which can be upsampled to 4x the sensor; a byte is plenty for small sensors
+#if THERMAL_TRACKER_FRAME_WIDTH * 4 <= 127 && THERMAL_TRACKER_FRAME_HEIGHT * 4 <= 127
+typedef int8_t pixel_coordinate;
+#else
+typedef int16_t pixel_coordinate;
+#endif
+
+// Indexes and counts of the pixels on the detection grid
+#if THERMAL_TRACKER_FRAME_WIDTH * THERMAL_TRACKER_FRAME_HEIGHT * 16 <= 65535
+typedef uint16_t pixel_index;
+#else
+typedef int32_t pixel_index;
+#endif
+
+// Sums of coordinates and their squares over a blob; at worst a blob covers the whole upsampled frame at its furthest edge
+#if THERMAL_TRACKER_FRAME_WIDTH * 4 * THERMAL_TRACKER_FRAME_HEIGHT * 4 * THERMAL_TRACKER_FRAME_WIDTH * 4 * THERMAL_TRACKER_FRAME_WIDTH * 4 <= 2147483647 \
+    && THERMAL_TRACKER_FRAME_WIDTH * 4 * THERMAL_TRACKER_FRAME_HEIGHT * 4 * THERMAL_TRACKER_FRAME_HEIGHT * 4 * THERMAL_TRACKER_FRAME_HEIGHT * 4 <= 2147483647
+typedef int32_t pixel_moment;
+#else
+typedef int64_t pixel_moment;
+#endif
+
+// Define THERMAL_TRACKER_COMPACT_TEMPERATURES as a build flag to store pixel temperatures in hundredths of a degree
+#ifdef THERMAL_TRACKER_COMPACT_TEMPERATURES
+typedef int16_t pixel_temperature;
+#else
+typedef float pixel_temperature;
+#endif
+
+const int PIXEL_STEPS_PER_DEGREE = 100;
+const float PIXEL_MAX_TEMPERATURE = 32767.0 / PIXEL_STEPS_PER_DEGREE;
+
 class Pixel{
 public:
 	Pixel();
@@ -19,10 +62,10 @@ public:
     float get_temperature();
 
 private:
-    int _x;
-    int _y;
-    float _temperature;
+    pixel_temperature _temperature;
+    pixel_coordinate _x;
+    pixel_coordinate _y;
 
 };
 
-// #endif
+#endif
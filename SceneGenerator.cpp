@@ -0,0 +1,460 @@
+#include "SceneGenerator.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+SceneGenerator::SceneGenerator(int _width, int _height, float _frame_rate, uint32_t seed){
+    /**
+    * Create a synthetic thermal scene for benchmarks and accuracy tests.
+    * People are warm ellipses that walk straight paths across a room with sensor noise, a drifting ambient temperature
+    * and stationary hot spots. Every random choice comes from the seed, so a seed always renders the same frames.
+    * The people who walk all the way across are counted as they leave, giving the ground truth to check the tracker against.
+    * Storage is allocated once here and is never resized.
+    * @param _width Width of the frames in pixels; must be FRAME_WIDTH to feed a ThermalTracker
+    * @param _height Height of the frames in pixels; must be FRAME_HEIGHT to feed a ThermalTracker
+    * @param _frame_rate Frames per second; sets how far people walk each frame
+    * @param seed Seed for the random traffic and noise
+    */
+    width = max(_width, 1);
+    height = max(_height, 1);
+    frame_rate = _frame_rate > 0 ? _frame_rate : REFRESH_RATE;
+    frame_buffer = new float[width * height];
+
+    ambient_temperature = SCENE_AMBIENT_TEMPERATURE;
+    ambient_drift = 0;
+    noise = SCENE_NOISE;
+    person_radius[X] = SCENE_PERSON_RADIUS;
+    person_radius[Y] = SCENE_PERSON_RADIUS;
+    person_temperature = SCENE_PERSON_TEMPERATURE;
+    traffic_rate = 0;
+    min_speed = SCENE_PERSON_SPEED;
+    max_speed = SCENE_PERSON_SPEED;
+    vertical_traffic = false;
+    num_hot_spots = 0;
+
+    reset(seed);
+}
+
+SceneGenerator::~SceneGenerator(){
+    delete[] frame_buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void SceneGenerator::reset(uint32_t seed){
+    /**
+    * Start the scene again from frame 0 with a new seed.
+    * The settings and hot spots are kept; the people and the ground truth counts are cleared.
+    * @param seed Seed for the random traffic and noise
+    */
+    random_state = seed * 2654435761u + 1;
+    if (random_state == 0) {
+        random_state = 1;
+    }
+
+    frame_number = 0;
+    num_people_in_view = 0;
+    for (int p = 0; p < MAX_SCENE_PEOPLE; p++) {
+        people[p].active = false;
+    }
+
+    for (int direction = 0; direction < NUM_DIRECTION_CATEGORIES; direction++) {
+        crossings[direction] = 0;
+    }
+}
+
+void SceneGenerator::set_ambient(float temperature, float drift_per_minute){
+    /**
+    * Set the room temperature, which the background model has to follow as it drifts.
+    * @param temperature Room temperature at frame 0, in deg C
+    * @param drift_per_minute Steady change in room temperature, in deg C per minute
+    */
+    ambient_temperature = temperature;
+    ambient_drift = drift_per_minute / (60 * frame_rate);
+}
+
+void SceneGenerator::set_noise(float sigma){
+    /**
+    * @param sigma Standard deviation of the Gaussian noise added to every pixel, in deg C
+    */
+    noise = max(sigma, 0.0f);
+}
+
+void SceneGenerator::set_person_shape(float radius_x, float radius_y, float temperature){
+    /**
+    * Set the typical size and temperature of a person.
+    * Random people vary by SCENE_SIZE_VARIATION in size and SCENE_TEMPERATURE_VARIATION in temperature either side of this.
+    * @param radius_x Horizontal semi-axis of a person, in pixels
+    * @param radius_y Vertical semi-axis of a person, in pixels
+    * @param temperature Temperature of a person, in deg C
+    */
+    person_radius[X] = max(radius_x, 0.1f);
+    person_radius[Y] = max(radius_y, 0.1f);
+    person_temperature = temperature;
+}
+
+void SceneGenerator::set_traffic(float people_per_minute, float _min_speed, float _max_speed, bool vertical){
+    /**
+    * Send random people across the view.
+    * Each one crosses the whole frame in a straight line at a random speed, position and direction.
+    * New people are skipped while MAX_SCENE_PEOPLE are already walking, so they never show up in the ground truth.
+    * @param people_per_minute Average number of people to send across each minute; 0 to stop
+    * @param _min_speed Slowest walking speed, in pixels per second
+    * @param _max_speed Fastest walking speed, in pixels per second
+    * @param vertical True to also send people top to bottom and bottom to top; false for left to right and right to left only
+    */
+    traffic_rate = max(people_per_minute, 0.0f) / (60 * frame_rate);
+    min_speed = max(min(_min_speed, _max_speed), 0.01f);
+    max_speed = max(_max_speed, min_speed);
+    vertical_traffic = vertical;
+}
+
+int SceneGenerator::add_person(float start_x, float start_y, float end_x, float end_y, float speed, long start_frame){
+    /**
+    * Send one person along a set path, using the typical size and temperature.
+    * A person only counts towards the ground truth if both ends of the path are outside of the frame, on opposite sides.
+    * @param start_x Column where the path starts; can be outside of the frame
+    * @param start_y Row where the path starts; can be outside of the frame
+    * @param end_x Column where the path ends; can be outside of the frame
+    * @param end_y Row where the path ends; can be outside of the frame
+    * @param speed Walking speed, in pixels per second
+    * @param start_frame Frame the person appears in
+    * @return Index of the person, or -1 if MAX_SCENE_PEOPLE are already walking
+    */
+    for (int p = 0; p < MAX_SCENE_PEOPLE; p++) {
+        ScenePerson& person = people[p];
+        if (person.active) {
+            continue;
+        }
+
+        float length = sqrtf((end_x - start_x) * (end_x - start_x) + (end_y - start_y) * (end_y - start_y));
+        person.start[X] = start_x;
+        person.start[Y] = start_y;
+        person.end[X] = end_x;
+        person.end[Y] = end_y;
+        person.radius[X] = person_radius[X];
+        person.radius[Y] = person_radius[Y];
+        person.temperature = person_temperature;
+        person.step = length > 0 ? max(speed, 0.01f) / frame_rate / length : 1;
+        person.progress = -(start_frame - frame_number) * person.step;
+        person.active = true;
+        return p;
+    }
+
+    return -1;
+}
+
+int SceneGenerator::add_hot_spot(float x, float y, float radius_x, float radius_y, float temperature){
+    /**
+    * Add a stationary heat source, such as a heater, lamp or monitor.
+    * @param x Column of the centre
+    * @param y Row of the centre
+    * @param radius_x Horizontal semi-axis, in pixels
+    * @param radius_y Vertical semi-axis, in pixels
+    * @param temperature Temperature of the hot spot, in deg C
+    * @return Index of the hot spot, or -1 if there are already MAX_SCENE_HOT_SPOTS
+    */
+    if (num_hot_spots >= MAX_SCENE_HOT_SPOTS) {
+        return -1;
+    }
+
+    SceneHotSpot& hot_spot = hot_spots[num_hot_spots];
+    hot_spot.centre[X] = x;
+    hot_spot.centre[Y] = y;
+    hot_spot.radius[X] = max(radius_x, 0.1f);
+    hot_spot.radius[Y] = max(radius_y, 0.1f);
+    hot_spot.temperature = temperature;
+    return num_hot_spots++;
+}
+
+void SceneGenerator::render(float frame[]){
+    /**
+    * Render the next frame, then move everyone on.
+    * @param frame Output row-major array of get_height() x get_width() temperatures, in deg C
+    */
+    float ambient = ambient_temperature + ambient_drift * frame_number;
+    for (int i = 0; i < width * height; i++) {
+        frame[i] = ambient;
+    }
+
+    for (int h = 0; h < num_hot_spots; h++) {
+        draw_ellipse(frame, hot_spots[h].centre, hot_spots[h].radius, hot_spots[h].temperature, ambient);
+    }
+
+    num_people_in_view = 0;
+    for (int p = 0; p < MAX_SCENE_PEOPLE; p++) {
+        ScenePerson& person = people[p];
+        if (!person.active || person.progress < 0) {
+            continue;
+        }
+
+        float centre[2];
+        centre[X] = person.start[X] + (person.end[X] - person.start[X]) * person.progress;
+        centre[Y] = person.start[Y] + (person.end[Y] - person.start[Y]) * person.progress;
+        draw_ellipse(frame, centre, person.radius, person.temperature, ambient);
+
+        bool in_view = centre[X] >= -0.5 && centre[X] <= width - 0.5 && centre[Y] >= -0.5 && centre[Y] <= height - 0.5;
+        num_people_in_view += in_view;
+    }
+
+    if (noise > 0) {
+        for (int i = 0; i < width * height; i++) {
+            frame[i] += noise * get_gaussian();
+        }
+    }
+
+    move_people();
+    spawn_traffic();
+    frame_number++;
+}
+
+bool SceneGenerator::process_frames(ThermalTracker& tracker, long num_frames){
+    /**
+    * Render frames straight into a tracker.
+    * @param tracker Tracker to feed
+    * @param num_frames Number of frames to render
+    * @return False if the scene isn't the tracker's frame size
+    */
+    if (width != FRAME_WIDTH || height != FRAME_HEIGHT) {
+        return false;
+    }
+
+    for (long f = 0; f < num_frames; f++) {
+        render(frame_buffer);
+        tracker.process_frame(frame_buffer, FRAME_WIDTH);
+    }
+
+    return true;
+}
+
+void SceneGenerator::get_crossings(long _crossings[NUM_DIRECTION_CATEGORIES]){
+    /**
+    * Get the ground truth: how many people have walked all the way across the view, in the tracker's directions.
+    * Moving towards higher columns is RIGHT, and towards higher rows is UP, the same as ThermalTracker::get_movements.
+    * Paths are counted along whichever axis they cover most; NO_DIRECTION is always 0.
+    * @param _crossings Output array of counts, indexed by directions
+    */
+    for (int direction = 0; direction < NUM_DIRECTION_CATEGORIES; direction++) {
+        _crossings[direction] = crossings[direction];
+    }
+}
+
+int SceneGenerator::get_num_people_in_view(){
+    /**
+    * @return Number of people whose centre was inside the last rendered frame
+    */
+    return num_people_in_view;
+}
+
+long SceneGenerator::get_frame_number(){
+    /**
+    * @return Number of frames rendered since the last reset
+    */
+    return frame_number;
+}
+
+int SceneGenerator::get_width(){
+    /**
+    * @return Width of the frames in pixels
+    */
+    return width;
+}
+
+int SceneGenerator::get_height(){
+    /**
+    * @return Height of the frames in pixels
+    */
+    return height;
+}
+
+#ifndef ARDUINO
+bool SceneGenerator::write_recording(const char* path, long num_frames){
+    /**
+    * Render frames into a text recording, with the ground truth alongside each one.
+    * The first line is "# width height frame_rate". Each frame is then a line of comma separated values:
+    * frame number, LEFT, RIGHT, UP and DOWN crossings so far, people in view, then the row-major temperatures.
+    * @param path File to write; it is overwritten
+    * @param num_frames Number of frames to render
+    * @return False if the file couldn't be written
+    */
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "# %d %d %g\n", width, height, frame_rate);
+    for (long f = 0; f < num_frames; f++) {
+        long frame = frame_number;
+        render(frame_buffer);
+        fprintf(file, "%ld,%ld,%ld,%ld,%ld,%d", frame, crossings[LEFT], crossings[RIGHT], crossings[UP], crossings[DOWN], num_people_in_view);
+        for (int i = 0; i < width * height; i++) {
+            fprintf(file, ",%.3f", frame_buffer[i]);
+        }
+        fprintf(file, "\n");
+    }
+
+    return fclose(file) == 0;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Private Methods
+
+void SceneGenerator::spawn_traffic(){
+    /**
+    * Maybe send a random person across the view, entering fully outside of the frame and leaving fully outside of the opposite side.
+    */
+    if (traffic_rate <= 0 || get_uniform(0, 1) >= traffic_rate) {
+        return;
+    }
+
+    bool vertical = vertical_traffic && get_uniform(0, 1) < 0.5;
+    bool reverse = get_uniform(0, 1) < 0.5;
+    float radius_x = person_radius[X] * get_uniform(1 - SCENE_SIZE_VARIATION, 1 + SCENE_SIZE_VARIATION);
+    float radius_y = person_radius[Y] * get_uniform(1 - SCENE_SIZE_VARIATION, 1 + SCENE_SIZE_VARIATION);
+    float temperature = person_temperature + get_uniform(-SCENE_TEMPERATURE_VARIATION, SCENE_TEMPERATURE_VARIATION);
+    float speed = get_uniform(min_speed, max_speed);
+
+    float start[2];
+    float end[2];
+    if (vertical) {
+        start[X] = get_uniform(0, width - 1);
+        end[X] = start[X];
+        start[Y] = -radius_y - 1;
+        end[Y] = height - 1 + radius_y + 1;
+    }
+    else{
+        start[Y] = get_uniform(0, height - 1);
+        end[Y] = start[Y];
+        start[X] = -radius_x - 1;
+        end[X] = width - 1 + radius_x + 1;
+    }
+
+    if (reverse) {
+        float swap_x = start[X];
+        float swap_y = start[Y];
+        start[X] = end[X];
+        start[Y] = end[Y];
+        end[X] = swap_x;
+        end[Y] = swap_y;
+    }
+
+    // Appears in the next frame
+    int p = add_person(start[X], start[Y], end[X], end[Y], speed, frame_number + 1);
+    if (p >= 0) {
+        people[p].radius[X] = radius_x;
+        people[p].radius[Y] = radius_y;
+        people[p].temperature = temperature;
+    }
+}
+
+void SceneGenerator::move_people(){
+    /**
+    * Walk everyone a frame further along their path; the ones that reach the end leave.
+    */
+    for (int p = 0; p < MAX_SCENE_PEOPLE; p++) {
+        ScenePerson& person = people[p];
+        if (!person.active) {
+            continue;
+        }
+
+        person.progress += person.step;
+        if (person.progress > 1) {
+            add_crossing(person);
+            person.active = false;
+        }
+    }
+}
+
+void SceneGenerator::add_crossing(ScenePerson& person){
+    /**
+    * Add a person who has finished their path to the ground truth, if they walked from one side of the view to the other.
+    * @param person Person who has just left
+    */
+    float travel_x = person.end[X] - person.start[X];
+    float travel_y = person.end[Y] - person.start[Y];
+
+    if (absolute(travel_x) >= absolute(travel_y)) {
+        bool crossed = min(person.start[X], person.end[X]) < 0 && max(person.start[X], person.end[X]) > width - 1;
+        if (crossed) {
+            crossings[travel_x > 0 ? RIGHT : LEFT]++;
+        }
+    }
+    else{
+        bool crossed = min(person.start[Y], person.end[Y]) < 0 && max(person.start[Y], person.end[Y]) > height - 1;
+        if (crossed) {
+            crossings[travel_y > 0 ? UP : DOWN]++;
+        }
+    }
+}
+
+float SceneGenerator::get_coverage(float x, float y, const float centre[2], const float radius[2]){
+    /**
+    * Work out how much of a pixel an ellipse covers, from a 2x2 grid of samples.
+    * @param x Column of the pixel
+    * @param y Row of the pixel
+    * @param centre Centre of the ellipse; indexed by X and Y
+    * @param radius Semi-axes of the ellipse; indexed by X and Y
+    * @return Fraction of the pixel covered (0 - 1)
+    */
+    int num_inside = 0;
+    for (int sample = 0; sample < 4; sample++) {
+        float dx = (x + (sample % 2 == 0 ? -0.25 : 0.25) - centre[X]) / radius[X];
+        float dy = (y + (sample / 2 == 0 ? -0.25 : 0.25) - centre[Y]) / radius[Y];
+        num_inside += dx * dx + dy * dy <= 1;
+    }
+
+    return num_inside * 0.25;
+}
+
+void SceneGenerator::draw_ellipse(float frame[], const float centre[2], const float radius[2], float temperature, float ambient){
+    /**
+    * Draw a warm ellipse over the frame. Partly covered pixels are blended with the ambient temperature,
+    * and overlapping shapes keep the warmest value.
+    * @param frame Row-major frame to draw on
+    * @param centre Centre of the ellipse; indexed by X and Y
+    * @param radius Semi-axes of the ellipse; indexed by X and Y
+    * @param temperature Temperature of the ellipse, in deg C
+    * @param ambient Room temperature, in deg C
+    */
+    int first_column = max(int(floorf(centre[X] - radius[X])), 0);
+    int last_column = min(int(ceilf(centre[X] + radius[X])), width - 1);
+    int first_row = max(int(floorf(centre[Y] - radius[Y])), 0);
+    int last_row = min(int(ceilf(centre[Y] + radius[Y])), height - 1);
+
+    for (int i = first_row; i <= last_row; i++) {
+        for (int j = first_column; j <= last_column; j++) {
+            float coverage = get_coverage(j, i, centre, radius);
+            if (coverage > 0) {
+                frame[i * width + j] = max(frame[i * width + j], ambient + (temperature - ambient) * coverage);
+            }
+        }
+    }
+}
+
+uint32_t SceneGenerator::get_random(){
+    /**
+    * @return Next value of the xorshift generator
+    */
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+float SceneGenerator::get_uniform(float low, float high){
+    /**
+    * @return Random value between low and high
+    */
+    return low + (high - low) * ((get_random() >> 8) * (1.0f / 16777216.0f));
+}
+
+float SceneGenerator::get_gaussian(){
+    /**
+    * @return Random value from the standard normal distribution, by the Box-Muller transform
+    */
+    float u1 = get_uniform(1.0f / 16777216.0f, 1);
+    float u2 = get_uniform(0, 1);
+    return sqrtf(-2 * logf(u1)) * cosf(2 * PI * u2);
+}
@@ -0,0 +1,89 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <Arduino.h>
+#include "ThermalTracker.h"
+
+const int MAX_SCENE_PEOPLE = 32;
+const int MAX_SCENE_HOT_SPOTS = 8;
+const float SCENE_AMBIENT_TEMPERATURE = 20.0;
+const float SCENE_NOISE = 0.1;
+const float SCENE_PERSON_TEMPERATURE = 30.0;
+const float SCENE_PERSON_RADIUS = 1.5;
+const float SCENE_PERSON_SPEED = 8.0;
+const float SCENE_SIZE_VARIATION = 0.2;
+const float SCENE_TEMPERATURE_VARIATION = 1.0;
+
+struct ScenePerson {
+    float start[2];     /**< Where the path starts, in pixels; indexed by X and Y*/
+    float end[2];       /**< Where the path ends, in pixels; indexed by X and Y*/
+    float radius[2];    /**< Semi-axes of the ellipse, in pixels; indexed by X and Y*/
+    float temperature;  /**< Temperature of the ellipse, in deg C*/
+    float step;         /**< Fraction of the path covered each frame*/
+    float progress;     /**< Fraction of the path covered so far; negative until the person appears*/
+    bool active;        /**< True while the person is waiting to appear or walking*/
+};
+
+struct SceneHotSpot {
+    float centre[2];    /**< Centre of the hot spot, in pixels; indexed by X and Y*/
+    float radius[2];    /**< Semi-axes of the hot spot, in pixels; indexed by X and Y*/
+    float temperature;  /**< Temperature of the hot spot, in deg C*/
+};
+
+class SceneGenerator{
+public:
+    SceneGenerator(int _width = FRAME_WIDTH, int _height = FRAME_HEIGHT, float _frame_rate = REFRESH_RATE, uint32_t seed = 1);
+    ~SceneGenerator();
+    SceneGenerator(const SceneGenerator&) = delete;            // Owns its frame buffer
+    SceneGenerator& operator=(const SceneGenerator&) = delete;
+    void reset(uint32_t seed);
+    void set_ambient(float temperature, float drift_per_minute = 0);
+    void set_noise(float sigma);
+    void set_person_shape(float radius_x, float radius_y, float temperature);
+    void set_traffic(float people_per_minute, float min_speed = SCENE_PERSON_SPEED, float max_speed = SCENE_PERSON_SPEED, bool vertical = false);
+    int add_person(float start_x, float start_y, float end_x, float end_y, float speed, long start_frame = 0);
+    int add_hot_spot(float x, float y, float radius_x, float radius_y, float temperature);
+    void render(float frame[]);
+    bool process_frames(ThermalTracker& tracker, long num_frames);
+    void get_crossings(long crossings[NUM_DIRECTION_CATEGORIES]);
+    int get_num_people_in_view();
+    long get_frame_number();
+    int get_width();
+    int get_height();
+#ifndef ARDUINO
+    bool write_recording(const char* path, long num_frames);
+#endif
+
+private:
+    void spawn_traffic();
+    void move_people();
+    void add_crossing(ScenePerson& person);
+    float get_coverage(float x, float y, const float centre[2], const float radius[2]);
+    void draw_ellipse(float frame[], const float centre[2], const float radius[2], float temperature, float ambient);
+    uint32_t get_random();
+    float get_uniform(float low, float high);
+    float get_gaussian();
+
+    int width;          /**< Width of the frames in pixels*/
+    int height;         /**< Height of the frames in pixels*/
+    float frame_rate;   /**< Frames per second*/
+    uint32_t random_state;  /**< State of the xorshift generator; every random choice comes from here*/
+    long frame_number;  /**< Number of frames rendered since the last reset*/
+    float ambient_temperature;  /**< Room temperature at frame 0, in deg C*/
+    float ambient_drift;    /**< Change in room temperature per frame, in deg C*/
+    float noise;        /**< Standard deviation of the sensor noise, in deg C*/
+    float person_radius[2]; /**< Typical semi-axes of a person, in pixels; indexed by X and Y*/
+    float person_temperature;   /**< Typical temperature of a person, in deg C*/
+    float traffic_rate; /**< Chance of a random person appearing each frame*/
+    float min_speed;    /**< Slowest random person, in pixels per second*/
+    float max_speed;    /**< Fastest random person, in pixels per second*/
+    bool vertical_traffic;  /**< True if random people also cross top to bottom and bottom to top*/
+    ScenePerson people[MAX_SCENE_PEOPLE];   /**< People waiting to appear or walking*/
+    SceneHotSpot hot_spots[MAX_SCENE_HOT_SPOTS];    /**< Stationary heat sources*/
+    int num_hot_spots;  /**< Number of hot spots in use*/
+    int num_people_in_view; /**< People whose centre was inside the last rendered frame*/
+    long crossings[NUM_DIRECTION_CATEGORIES];   /**< Ground truth; people who have walked all the way across, by direction*/
+    float* frame_buffer;    /**< Frame rendered for process_frames and write_recording; width x height*/
+};
+
+#endif
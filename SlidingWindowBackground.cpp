@@ -0,0 +1,127 @@
+#include "SlidingWindowBackground.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+
+SlidingWindowBackground::SlidingWindowBackground(int _num_pixels, int _window_length){
+    /**
+    * Create an exact sliding-window background.
+    * The last window_length frames are kept in a ring, quantised to 1/SLIDING_WINDOW_STEPS_PER_DEGREE deg C.
+    * Integer running sums let the mean and deviation be updated in constant time, no matter how long the window is,
+    * and without the drift of floating point running sums.
+    * Storage is allocated once here; see get_memory_usage for the size.
+    * @param _num_pixels Number of pixels in each frame
+    * @param _window_length Number of frames the statistics are calculated over
+    */
+    num_pixels = _num_pixels;
+    window_length = _window_length;
+    window = new int16_t[num_pixels * window_length];
+    sums = new int32_t[num_pixels];
+    sums_of_squares = new int64_t[num_pixels];
+    reset();
+}
+
+SlidingWindowBackground::~SlidingWindowBackground(){
+    delete[] window;
+    delete[] sums;
+    delete[] sums_of_squares;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Public Methods
+
+void SlidingWindowBackground::reset(){
+    /**
+    * Empty the window.
+    */
+    num_frames = 0;
+    oldest_frame = 0;
+
+    for (int i = 0; i < num_pixels; i++) {
+        sums[i] = 0;
+        sums_of_squares[i] = 0;
+    }
+}
+
+void SlidingWindowBackground::add_frame(const float frame[]){
+    /**
+    * Add a frame to the window, pushing out the oldest frame if the window is full.
+    * @param frame Pixel temperatures in deg C
+    */
+    int16_t* slot = &window[oldest_frame * num_pixels];
+    bool window_full = num_frames == window_length;
+
+    for (int i = 0; i < num_pixels; i++) {
+        float temp = constrain(frame[i], -SLIDING_WINDOW_MAX_TEMPERATURE, SLIDING_WINDOW_MAX_TEMPERATURE);
+        int16_t quantised = lroundf(temp * SLIDING_WINDOW_STEPS_PER_DEGREE);
+
+        if (window_full) {
+            int32_t expired = slot[i];
+            sums[i] -= expired;
+            sums_of_squares[i] -= expired * expired;
+        }
+
+        slot[i] = quantised;
+        sums[i] += quantised;
+        sums_of_squares[i] += int32_t(quantised) * quantised;
+    }
+
+    if (!window_full) {
+        num_frames++;
+    }
+    oldest_frame = (oldest_frame + 1) % window_length;
+}
+
+void SlidingWindowBackground::get_statistics(float averages[], float deviations[]){
+    /**
+    * Get the mean and sample standard deviation of each pixel over the frames in the window.
+    * @param averages Output array of the pixel averages, in deg C
+    * @param deviations Output array of the pixel standard deviations, in deg C
+    */
+    if (num_frames == 0) {
+        return;
+    }
+
+    float scale = 1.0 / SLIDING_WINDOW_STEPS_PER_DEGREE;
+    float variance_scale = 0;
+    if (num_frames > 1) {
+        variance_scale = scale * scale / (float(num_frames) * (num_frames - 1));
+    }
+
+    for (int i = 0; i < num_pixels; i++) {
+        // n * sum(x^2) - sum(x)^2 is exact in integers, so it can't go negative through cancellation
+        int64_t spread = num_frames * sums_of_squares[i] - int64_t(sums[i]) * sums[i];
+
+        averages[i] = sums[i] * scale / num_frames;
+        deviations[i] = sqrtf(spread * variance_scale);
+    }
+}
+
+int SlidingWindowBackground::get_num_frames(){
+    /**
+    * Get the number of frames currently held in the window.
+    * @return Number of frames in the window; at most the window length
+    */
+    return num_frames;
+}
+
+size_t SlidingWindowBackground::get_memory_usage(){
+    /**
+    * Get the number of bytes used by this background, including its heap storage.
+    * @return Memory usage in bytes
+    */
+    return get_memory_usage(num_pixels, window_length);
+}
+
+size_t SlidingWindowBackground::get_memory_usage(int num_pixels, int window_length){
+    /**
+    * Get the number of bytes a sliding-window background would use.
+    * Useful to size the window before committing to it on a small device.
+    * @param num_pixels Number of pixels in each frame
+    * @param window_length Number of frames in the window
+    * @return Memory usage in bytes
+    */
+    return sizeof(SlidingWindowBackground)
+        + size_t(num_pixels) * window_length * sizeof(int16_t)
+        + size_t(num_pixels) * (sizeof(int32_t) + sizeof(int64_t));
+}
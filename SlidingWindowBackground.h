@@ -0,0 +1,33 @@
+#ifndef SLIDING_WINDOW_BACKGROUND_H
+#define SLIDING_WINDOW_BACKGROUND_H
+
+#include <Arduino.h>
+
+const int SLIDING_WINDOW_STEPS_PER_DEGREE = 100;
+const float SLIDING_WINDOW_MAX_TEMPERATURE = 32767.0 / SLIDING_WINDOW_STEPS_PER_DEGREE;
+
+class SlidingWindowBackground{
+public:
+    SlidingWindowBackground(int num_pixels, int window_length);
+    ~SlidingWindowBackground();
+    SlidingWindowBackground(const SlidingWindowBackground&) = delete;            // Owns its window and sums
+    SlidingWindowBackground& operator=(const SlidingWindowBackground&) = delete;
+    void reset();
+    void add_frame(const float frame[]);
+    void get_statistics(float averages[], float deviations[]);
+    int get_num_frames();
+    size_t get_memory_usage();
+
+    static size_t get_memory_usage(int num_pixels, int window_length);
+
+private:
+    int16_t* window;    /**< Ring of quantised past frames; window_length frames of num_pixels each*/
+    int32_t* sums;      /**< Running sum of the quantised temperatures in the window for each pixel*/
+    int64_t* sums_of_squares;   /**< Running sum of the squared quantised temperatures in the window for each pixel*/
+    int num_pixels;     /**< Number of pixels in each frame*/
+    int window_length;  /**< Number of frames the statistics are calculated over*/
+    int num_frames;     /**< Number of frames currently held in the window*/
+    int oldest_frame;   /**< Index of the oldest frame in the ring; the next frame overwrites it once the window is full*/
+};
+
+#endif
@@ -1,21 +1,253 @@
 #include "ThermalTracker.h"
+#include <new>
+
+// The coordinate and index types in Pixel.h are picked from the frame size; make sure they cover the largest upsampled grid
+static_assert(pixel_coordinate(FRAME_WIDTH * MAX_UPSAMPLING_FACTOR) == FRAME_WIDTH * MAX_UPSAMPLING_FACTOR, "pixel_coordinate is too narrow for the upsampled frame width");
+static_assert(pixel_coordinate(FRAME_HEIGHT * MAX_UPSAMPLING_FACTOR) == FRAME_HEIGHT * MAX_UPSAMPLING_FACTOR, "pixel_coordinate is too narrow for the upsampled frame height");
+static_assert(pixel_index(long(FRAME_WIDTH) * FRAME_HEIGHT * MAX_UPSAMPLING_FACTOR * MAX_UPSAMPLING_FACTOR) == long(FRAME_WIDTH) * FRAME_HEIGHT * MAX_UPSAMPLING_FACTOR * MAX_UPSAMPLING_FACTOR, "pixel_index is too narrow for the upsampled frame");
+
+// A blob's coordinate sums peak when it covers the whole upsampled frame; bound its squares by the furthest edge
+const int64_t MAX_UPSAMPLED_SIDE = int64_t(FRAME_WIDTH > FRAME_HEIGHT ? FRAME_WIDTH : FRAME_HEIGHT) * MAX_UPSAMPLING_FACTOR;
+const int64_t MAX_BLOB_MOMENT = int64_t(FRAME_WIDTH) * FRAME_HEIGHT * MAX_UPSAMPLING_FACTOR * MAX_UPSAMPLING_FACTOR * MAX_UPSAMPLED_SIDE * MAX_UPSAMPLED_SIDE;
+static_assert(pixel_moment(MAX_BLOB_MOMENT) == MAX_BLOB_MOMENT, "pixel_moment is too narrow for the second moments of the upsampled frame");
+
+struct ArenaLayout {
+    size_t tracked_blobs;
+    size_t frame_blobs;
+    size_t distance_matrix;
+    size_t matches;
+    size_t match_heap;
+    size_t taken_flags;
+    size_t blob_cells;
+    size_t sorted_blobs;
+    size_t blob_features;
+    size_t blob_distances;
+    size_t size;
+};
+
+static size_t reserve_arena_block(size_t& used, size_t size){
+    size_t offset = (used + ARENA_ALIGNMENT - 1) & ~size_t(ARENA_ALIGNMENT - 1);
+    used = offset + size;
+    return offset;
+}
+
+static ArenaLayout get_arena_layout(int max_blobs){
+    /**
+    * Lay out the blob pools and matching scratch space for the given capacity.
+    * Every block is aligned to ARENA_ALIGNMENT from the start of the (aligned) arena.
+    */
+    size_t num_pairs = size_t(max_blobs) * max_blobs;
+    size_t num_flag_words = (max_blobs + 31) / 32;
+    ArenaLayout layout;
+    size_t used = 0;
+
+    layout.tracked_blobs = reserve_arena_block(used, max_blobs * sizeof(TrackedBlob));
+    layout.frame_blobs = reserve_arena_block(used, max_blobs * sizeof(Blob));
+    layout.distance_matrix = reserve_arena_block(used, num_pairs * sizeof(float));
+    layout.matches = reserve_arena_block(used, max_blobs * 2 * sizeof(int));
+    layout.match_heap = reserve_arena_block(used, num_pairs * sizeof(int));
+    layout.taken_flags = reserve_arena_block(used, 2 * num_flag_words * sizeof(uint32_t));
+    layout.blob_cells = reserve_arena_block(used, max_blobs * sizeof(int));
+    layout.sorted_blobs = reserve_arena_block(used, max_blobs * sizeof(int));
+    layout.blob_features = reserve_arena_block(used, NUM_BLOB_FEATURES * max_blobs * sizeof(float));
+    layout.blob_distances = reserve_arena_block(used, max_blobs * sizeof(float));
+    layout.size = used;
+
+    return layout;
+}
+
+static bool is_closer_edge(const float distances[], int edge, int other_edge){
+    return distances[edge] < distances[other_edge] || (distances[edge] == distances[other_edge] && edge < other_edge);
+}
+
+static void sift_down_edge(const float distances[], int heap[], int num_edges, int position){
+    while (true) {
+        int closest = position;
+        int left = 2 * position + 1;
+        int right = left + 1;
+
+        if (left < num_edges && is_closer_edge(distances, heap[left], heap[closest])) {
+            closest = left;
+        }
+        if (right < num_edges && is_closer_edge(distances, heap[right], heap[closest])) {
+            closest = right;
+        }
+        if (closest == position) {
+            return;
+        }
+
+        int swap = heap[position];
+        heap[position] = heap[closest];
+        heap[closest] = swap;
+        position = closest;
+    }
+}
+
+static int compute_distance_span(const float reference[NUM_BLOB_FEATURES], const float features[], int stride, int first, int last, float gate, float output[]){
+    /**
+    * Distance kernel between one tracked blob and a contiguous span of packed blob features.
+    * Terms are summed in the same order as TrackedBlob::get_distance. Blobs outside of the position gate get UNMATCHABLE_DISTANCE.
+    * The gate is a select rather than a branch and there are no calls in the loop, to leave it open to vectorisation across the span.
+    * Features are stored as NUM_BLOB_FEATURES rows of stride floats.
+    * @return Number of blobs in the span that were inside the position gate
+    */
+    int num_inside = 0;
+
+    for (int k = first; k < last; k++) {
+        float offset_x = fabsf(reference[FEATURE_X] - features[FEATURE_X * stride + k]);
+        float offset_y = fabsf(reference[FEATURE_Y] - features[FEATURE_Y * stride + k]);
+
+        float distance = offset_x * POSITION_PENALTY;
+        distance += offset_y * POSITION_PENALTY;
+        distance += fabsf(reference[FEATURE_AREA] - features[FEATURE_AREA * stride + k]) * AREA_PENALTY;
+        distance += fabsf(reference[FEATURE_TEMPERATURE] - features[FEATURE_TEMPERATURE * stride + k]) * TEMPERATURE_PENALTY;
+        distance += fabsf(reference[FEATURE_ASPECT_RATIO] - features[FEATURE_ASPECT_RATIO * stride + k]) * ASPECT_RATIO_PENALTY;
+
+        bool inside = (offset_x + offset_y) <= gate;
+        output[k] = inside ? distance : UNMATCHABLE_DISTANCE;
+        num_inside += inside;
+    }
+
+    return num_inside;
+}
+
+static uint32_t crc32(const uint8_t data[], size_t length){
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 
-ThermalTracker::ThermalTracker(int _running_average_size, int _max_distance_threshold, int _min_blob_size){
+ThermalTracker::ThermalTracker(int _running_average_size, int _max_distance_threshold, int _min_blob_size, float _activation_sigma, int _background_model, int _max_blobs, uint8_t _arena[]){
     /**
     * Constructor - Make a new thermal tracker object
     * The thermal tracker uses a MLX90621 thermopile array to observe moving objects in its view.
     * @param _running_average_size The number of frames to include as the running background average in calculations
     * @param _max_distance_threshold The maximum amount of difference between blobs before they are considered different objects between frames
     * @param _min_blob_size The minimum pixel area that an object can occupy before it is tracked
+    * @param _activation_sigma The number of background standard deviations a pixel must differ by to be considered active
+    * @param _background_model The background engine to use; RUNNING_AVERAGE_BACKGROUND, MIXTURE_BACKGROUND, or SLIDING_WINDOW_BACKGROUND
+    * @param _max_blobs The maximum number of blobs that can be detected and tracked at once
+    * @param _arena Memory for the blob pools and matching scratch space, at least get_arena_size(_max_blobs) bytes.
+    *               If NULL, the arena is allocated on the heap once here.
     */
     running_average_size = _running_average_size;
     max_distance_threshold = _max_distance_threshold;
     min_blob_size = _min_blob_size;
+    activation_sigma = _activation_sigma;
+    background_model = _background_model;
+    position_gate = max_distance_threshold / POSITION_PENALTY;
+    num_evaluated_pairs = 0;
+    num_pruned_pairs = 0;
     movement_changed_since_last_check = false;
+    entry_direction = NO_DIRECTION;
+    occupancy = 0;
+    occupancy_changed_since_last_check = false;
+    num_people_in_view = 0;
+    movement_histogram = NULL;
+    early_commit = false;
+    counting_lines = NULL;
+    line_crossed_since_last_check = false;
+    num_unchanged_frames = 0;
+    num_last_blobs = 0;
+    reset_movements();
     num_background_frames = 0;
+    num_validation_frames = 0;
+    num_blob_overflows = 0;
+    num_dropped_pixels = 0;
+    frame_deadline = FRAME_DEADLINE;
+    last_frame_time = 0;
+    num_deadline_misses = 0;
+    degradation_level = FULL_QUALITY;
+    num_consecutive_misses = 0;
+    num_recovery_frames = 0;
+    pixel_calibration = NULL;
+    exclusion_learning_frames = 0;
+    clear_exclusion_mask();
+    upsampler = NULL;
+    pyramid = NULL;
+    detection_unlabelled = NULL;
+    detection_queue = NULL;
+    frame_data = &frame[0][0];
+    frame_row_step = FRAME_WIDTH;
+    frame_column_step = 1;
+
+    // Start with empty bounds so nothing reads uninitialised memory before the background is built
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            pixel_averages[i][j] = 0;
+            pixel_variance[i][j] = 0;
+        }
+    }
+    update_activation_bounds();
+
+    // Carve the blob pools and scratch space out of the arena
+    max_blobs = _max_blobs;
+    blob_limit = max_blobs;
+    ArenaLayout layout = get_arena_layout(max_blobs);
+    owned_arena = NULL;
+    if (_arena == NULL) {
+        owned_arena = new uint8_t[get_arena_size(max_blobs)];
+        _arena = owned_arena;
+    }
+
+    uint8_t* arena = _arena + (ARENA_ALIGNMENT - uintptr_t(_arena) % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+    tracked_blobs = reinterpret_cast<TrackedBlob*>(arena + layout.tracked_blobs);
+    frame_blobs = reinterpret_cast<Blob*>(arena + layout.frame_blobs);
+    distance_matrix = reinterpret_cast<float*>(arena + layout.distance_matrix);
+    matches = reinterpret_cast<int (*)[2]>(arena + layout.matches);
+    match_heap = reinterpret_cast<int*>(arena + layout.match_heap);
+    taken_flags = reinterpret_cast<uint32_t*>(arena + layout.taken_flags);
+    blob_cells = reinterpret_cast<int*>(arena + layout.blob_cells);
+    sorted_blobs = reinterpret_cast<int*>(arena + layout.sorted_blobs);
+    blob_features = reinterpret_cast<float*>(arena + layout.blob_features);
+    blob_distances = reinterpret_cast<float*>(arena + layout.blob_distances);
+
+    for (int i = 0; i < max_blobs; i++) {
+        new (&tracked_blobs[i]) TrackedBlob();
+        new (&frame_blobs[i]) Blob();
+    }
+
+    mixture_background = NULL;
+    if (background_model == MIXTURE_BACKGROUND) {
+        mixture_background = new MixtureBackground(FRAME_WIDTH * FRAME_HEIGHT, activation_sigma);
+    }
+
+    sliding_window_background = NULL;
+    if (background_model == SLIDING_WINDOW_BACKGROUND) {
+        sliding_window_background = new SlidingWindowBackground(FRAME_WIDTH * FRAME_HEIGHT, running_average_size);
+    }
+}
+
+ThermalTracker::~ThermalTracker(){
+    delete mixture_background;
+    delete sliding_window_background;
+    delete[] owned_arena;
+    delete[] pixel_calibration;
+    delete upsampler;
+    delete pyramid;
+    delete[] detection_unlabelled;
+    delete[] detection_queue;
+    delete counting_lines;
+    delete movement_histogram;
+}
+
+size_t ThermalTracker::get_arena_size(int max_blobs){
+    /**
+    * Get the number of bytes of arena needed for a tracker with the given blob capacity.
+    * Covers the blob and tracked blob pools and all of the scratch space used to match them, so it grows with max_blobs squared.
+    * Includes slack for aligning an arbitrary buffer.
+    * @param max_blobs Capacity of the blob pools
+    * @return Arena size in bytes
+    */
+    return get_arena_layout(max_blobs).size + ARENA_ALIGNMENT - 1;
 }
 
 
@@ -27,6 +259,15 @@ void ThermalTracker::reset_background(){
     * Reset the number of frames in the running background, forcing the tracker to recreate.
     */
     num_background_frames = 0;
+    num_validation_frames = 0;
+
+    if (background_model == MIXTURE_BACKGROUND) {
+        mixture_background->reset();
+    }
+
+    if (background_model == SLIDING_WINDOW_BACKGROUND) {
+        sliding_window_background->reset();
+    }
 }
 
 void ThermalTracker::process_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]){
@@ -36,59 +277,316 @@ void ThermalTracker::process_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]
     * If the background has already been built, then the frame is analysed to detect and track movement.
     * @param frame_buffer A 2D array containing the pixel temperatures from the thermopile sensor.
     */
+    process_frame(&frame_buffer[0][0], FRAME_WIDTH);
+}
+
+void ThermalTracker::process_frame(const float frame_buffer[], int stride, bool column_major){
+    /**
+    * Process an input thermal frame straight out of an external buffer, such as a DMA target or a memory-mapped recording.
+    * The frame is read in place rather than copied, so the buffer must not change until this returns.
+    * It is only copied if a pixel calibration is set, or if the mixture or sliding window background needs it row-major.
+    * @param frame_buffer Pixel temperatures in deg C
+    * @param stride Number of floats between the start of each row, or of each column if column_major
+    * @param column_major True if the pixels are stored column by column, like the MLX90621's RAM
+    */
+    unsigned long start_time = micros();
+    load_frame(frame_buffer, stride, column_major);
+
+    // Keep the histogram's clock close behind millis(), so it can follow it when it wraps
+    if (movement_histogram != NULL) {
+        movement_histogram->advance(millis());
+    }
+
+    // The mixture model classifies and learns from every frame, including the ones used to build it, unless running behind
+    if (background_model == MIXTURE_BACKGROUND) {
+        add_frame_to_mixture_background();
+    }
 
-    load_frame(frame_buffer);
+    // A restored background must agree with the live scene before it is trusted
+    // If it doesn't, it is thrown out and this frame starts a fresh background
+    if (num_validation_frames > 0 && validate_restored_background()) {
+        // Used up checking the restored background
+    }
 
     // Has the background been built first? If not; build it!
-    if (!finished_building_background()){
+    else if (!finished_building_background()){
         build_background();
     }
 
     // Background already built; go track all the things!
     else{
-        bool add_frame_to_average = true;
-        Blob blobs[MAX_BLOBS];
+        get_blobs(frame_blobs);
+        remove_small_blobs(frame_blobs);
+        bool add_frame_to_average = check_background_activity(get_num_blobs(frame_blobs));
+        track_blobs(frame_blobs, tracked_blobs);
+        count_people_in_view();
+
+        // Running behind; the background can wait until the load eases
+        if (degradation_level < SKIP_BACKGROUND_UPDATE) {
+            if (exclusion_learning_frames > 0) {
+                learn_exclusions();
+            }
+
+            if (add_frame_to_average) {
+                add_frame_to_background();
+            }
+        }
+    }
+
+    check_deadline(micros() - start_time);
+}
+
+bool ThermalTracker::check_background_activity(int num_blobs){
+    /**
+    * Decide whether the current frame is quiet enough to be added to the background.
+    * @param num_blobs Number of blobs in the current frame, after the small ones have been removed
+    * @return True if the frame should be added to the background
+    */
+    bool add_frame_to_average = true;
+
+    // Activity check - don't add frames to background when there is activity
+    // There is a limit to this though if the in-frame blobs stay the same for a certain amount of time (default 4 seconds)
+    if (num_blobs > 0) {
+        add_frame_to_average = false;
+
+        if (num_blobs == num_last_blobs){
+            num_unchanged_frames++;
+        }
+        else{
+            num_unchanged_frames = 0;
+        }
+
+        if (num_unchanged_frames > UNCHANGED_FRAME_DELAY){
+            add_frame_to_average = true;
+        }
+    }
+
+    num_last_blobs = num_blobs;
+    return add_frame_to_average;
+}
+
+void ThermalTracker::load_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Load an input frame into the buffer.
+    * @param frame_buffer A 2D array containing the pixel temperatures to be added to the buffer
+    */
+    load_frame(&frame_buffer[0][0], FRAME_WIDTH, false);
+}
+
+void ThermalTracker::load_frame(const float frame_buffer[], int stride, bool column_major){
+    /**
+    * Load an input frame.
+    * This is the only full pass over the input: each pixel is calibrated (if a calibration has been set),
+    * checked against the activation bounds, and folded into the frame stats.
+    * Detection then only needs to walk the active mask.
+    * Uncalibrated frames are left where they are and read through frame_data; calibrated pixels are staged in frame.
+    * Once the background is built, the pyramid replaces the full pass with load_sampled_frame.
+    * @param frame_buffer Pixel temperatures to be loaded
+    * @param stride Number of floats between the start of each row, or of each column if column_major
+    * @param column_major True if the pixels are stored column by column
+    */
+    int row_step = column_major ? 1 : stride;
+    int column_step = column_major ? stride : 1;
 
-        get_blobs(blobs);
-        remove_small_blobs(blobs);
-        int num_blobs = get_num_blobs(blobs);
+    // Building and validating a background both need every pixel
+    if (pyramid != NULL && finished_building_background() && num_validation_frames == 0) {
+        load_sampled_frame(frame_buffer, row_step, column_step);
+        return;
+    }
+
+    float min_temperature = frame_buffer[0];
+    float max_temperature = frame_buffer[0];
+    float total_temperature = 0;
+    int num_active = 0;
 
-        // Activity check - don't add frames to background when there is activity
-        // There is a limit to this though if the in-frame blobs stay the same for a certain amount of time (default 4 seconds)
-        if (num_blobs > 0) {
-            add_frame_to_average = false;
+    if (pixel_calibration != NULL) {
+        min_temperature = min_temperature * pixel_calibration[PIXEL_GAIN][0][0] + pixel_calibration[PIXEL_OFFSET][0][0];
+        max_temperature = min_temperature;
+    }
 
-            if (num_blobs == num_last_blobs){
-                num_unchanged_frames++;
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        const float* row = &frame_buffer[i * row_step];
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            float temp = row[j * column_step];
+            if (pixel_calibration != NULL) {
+                temp = temp * pixel_calibration[PIXEL_GAIN][i][j] + pixel_calibration[PIXEL_OFFSET][i][j];
+                frame[i][j] = temp;
             }
-            else{
-                num_unchanged_frames = 0;
+
+            bool active = detection_mask[i][j] & ((temp < activation_bounds[LOWER_BOUND][i][j]) | (temp > activation_bounds[UPPER_BOUND][i][j]));
+            active_mask[i][j] = active;
+            num_active += active;
+
+            total_temperature += temp;
+            min_temperature = min(min_temperature, temp);
+            max_temperature = max(max_temperature, temp);
+        }
+    }
+
+    frame_data = frame_buffer;
+    frame_row_step = row_step;
+    frame_column_step = column_step;
+    if (pixel_calibration != NULL) {
+        frame_data = &frame[0][0];
+        frame_row_step = FRAME_WIDTH;
+        frame_column_step = 1;
+    }
+
+    // The whole active mask is up to date, so the next regions clear whatever this frame leaves outside of them
+    if (pyramid != NULL) {
+        pyramid->fill_regions();
+    }
+
+    frame_stats.min_temperature = min_temperature;
+    frame_stats.max_temperature = max_temperature;
+    frame_stats.mean_temperature = total_temperature / (FRAME_WIDTH * FRAME_HEIGHT);
+    frame_stats.num_active_pixels = finished_building_background() ? num_active : 0;
+}
+
+void ThermalTracker::load_sampled_frame(const float frame_buffer[], int row_step, int column_step){
+    /**
+    * Load an input frame with the pyramid on.
+    * Only the pyramid's samples are read to find the regions of interest. The only other pixels touched are the
+    * ones inside the regions, and the row of cells that the background refresh is due to reach.
+    * A quiet frame therefore costs a sampled pass plus one row of cells, rather than a pass over the frame.
+    * The frame stats are worked out from the samples.
+    * @param frame_buffer Pixel temperatures to be loaded
+    * @param row_step Number of floats between vertically adjacent pixels
+    * @param column_step Number of floats between horizontally adjacent pixels
+    */
+    float* samples = pyramid->get_samples();
+    const int* sample_rows = pyramid->get_sample_rows();
+    const int* sample_columns = pyramid->get_sample_columns();
+    int sample_width = pyramid->get_sample_width();
+    int num_samples = sample_width * pyramid->get_sample_height();
+    int cell_columns = pyramid->get_width();
+    int num_cells = cell_columns * pyramid->get_height();
+
+    for (int sample_row = 0; sample_row < pyramid->get_sample_height(); sample_row++) {
+        int i = sample_rows[sample_row];
+        const float* row = &frame_buffer[i * row_step];
+        float* row_samples = &samples[sample_row * sample_width];
+        for (int sample_column = 0; sample_column < sample_width; sample_column++) {
+            int j = sample_columns[sample_column];
+            float temp = row[j * column_step];
+            if (pixel_calibration != NULL) {
+                temp = temp * pixel_calibration[PIXEL_GAIN][i][j] + pixel_calibration[PIXEL_OFFSET][i][j];
             }
 
-            if (num_unchanged_frames > UNCHANGED_FRAME_DELAY){
-                add_frame_to_average = true;
+            row_samples[sample_column] = temp;
+        }
+    }
+
+    float min_temperature = samples[0];
+    float max_temperature = samples[0];
+    float total_temperature = 0;
+    for (int sample = 0; sample < num_samples; sample++) {
+        total_temperature += samples[sample];
+        min_temperature = min(min_temperature, samples[sample]);
+        max_temperature = max(max_temperature, samples[sample]);
+    }
+
+    pyramid->find_regions(activation_sigma);
+
+    frame_data = frame_buffer;
+    frame_row_step = row_step;
+    frame_column_step = column_step;
+
+    // Only the pixels that are read again need calibrating
+    if (pixel_calibration != NULL) {
+        const bool* regions = pyramid->get_regions();
+        int factor = pyramid->get_factor();
+        int refresh_top = pyramid->get_refresh_row() * factor;
+        calibrate_block(frame_buffer, row_step, column_step, refresh_top, 0, factor, FRAME_WIDTH);
+
+        for (int cell = 0; cell < num_cells; cell++) {
+            if (regions[cell]) {
+                calibrate_block(frame_buffer, row_step, column_step, (cell / cell_columns) * factor, (cell % cell_columns) * factor, factor, factor);
             }
         }
 
-        num_last_blobs = num_blobs;
-        track_blobs(blobs, tracked_blobs);
+        frame_data = &frame[0][0];
+        frame_row_step = FRAME_WIDTH;
+        frame_column_step = 1;
+    }
+
+    frame_stats.min_temperature = min_temperature;
+    frame_stats.max_temperature = max_temperature;
+    frame_stats.mean_temperature = total_temperature / num_samples;
+    frame_stats.num_active_pixels = refine_regions();
+}
 
-        if (add_frame_to_average) {
-            add_frame_to_to_running_background();
+void ThermalTracker::calibrate_block(const float frame_buffer[], int row_step, int column_step, int top, int left, int height, int width){
+    /**
+    * Calibrate a block of an input frame into the staging frame, clipped to the frame.
+    * @param frame_buffer Uncalibrated pixel temperatures
+    * @param row_step Number of floats between vertically adjacent pixels
+    * @param column_step Number of floats between horizontally adjacent pixels
+    * @param top First row of the block
+    * @param left First column of the block
+    * @param height Number of rows in the block
+    * @param width Number of columns in the block
+    */
+    for (int i = top; i < min(top + height, FRAME_HEIGHT); i++) {
+        for (int j = left; j < min(left + width, FRAME_WIDTH); j++) {
+            frame[i][j] = frame_buffer[i * row_step + j * column_step] * pixel_calibration[PIXEL_GAIN][i][j] + pixel_calibration[PIXEL_OFFSET][i][j];
         }
     }
 }
 
-void ThermalTracker::load_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]){
+int ThermalTracker::refine_regions(){
     /**
-    * Load an input frame into the buffer.
-    * @param frame_buffer A 2D array containing the pixel temperatures to be added to the buffer
+    * Check the pixels inside the pyramid's regions of interest against the activation bounds.
+    * Pixels outside of the regions are left inactive; cells that have just left the regions are cleared.
+    * @return Number of active pixels
+    */
+    const bool* regions = pyramid->get_regions();
+    const bool* previous_regions = pyramid->get_previous_regions();
+    int factor = pyramid->get_factor();
+    int num_active = 0;
+
+    for (int cell_row = 0; cell_row < pyramid->get_height(); cell_row++) {
+        for (int cell_column = 0; cell_column < pyramid->get_width(); cell_column++) {
+            int cell = cell_row * pyramid->get_width() + cell_column;
+            if (!regions[cell] && !previous_regions[cell]) {
+                continue;
+            }
+
+            bool in_region = regions[cell];
+            for (int i = cell_row * factor; i < min((cell_row + 1) * factor, FRAME_HEIGHT); i++) {
+                for (int j = cell_column * factor; j < min((cell_column + 1) * factor, FRAME_WIDTH); j++) {
+                    float temp = frame_data[i * frame_row_step + j * frame_column_step];
+                    bool active = in_region & detection_mask[i][j] & ((temp < activation_bounds[LOWER_BOUND][i][j]) | (temp > activation_bounds[UPPER_BOUND][i][j]));
+                    active_mask[i][j] = active;
+                    num_active += active;
+                }
+            }
+        }
+    }
+
+    return num_active;
+}
+
+const float* ThermalTracker::get_row_major_frame(){
+    /**
+    * Get the loaded frame as a contiguous row-major array, for the background engines that need one.
+    * The frame is only copied into the staging buffer if it isn't laid out that way already.
+    * @return Pointer to FRAME_HEIGHT x FRAME_WIDTH pixel temperatures
     */
+    if (frame_row_step == FRAME_WIDTH && frame_column_step == 1) {
+        return frame_data;
+    }
+
     for (int i = 0; i < FRAME_HEIGHT; i++) {
         for (int j = 0; j < FRAME_WIDTH; j++) {
-            frame[i][j] = frame_buffer[i][j];
+            frame[i][j] = frame_data[i * frame_row_step + j * frame_column_step];
         }
     }
+
+    frame_data = &frame[0][0];
+    frame_row_step = FRAME_WIDTH;
+    frame_column_step = 1;
+    return frame_data;
 }
 
 void ThermalTracker::build_background(){
@@ -98,12 +596,19 @@ void ThermalTracker::build_background(){
     * Note: This function is only meant to be run once before tracking begins.
     *       Frames are still added to the background after tracking begins using the add_frame_to_to_running_background function.
     *       add_frame_to_to_running_background uses a running average and variance to operate whereas this function uses a fixed population size.
+    *       The sliding window background keeps its own exact statistics, so its frames are passed straight through.
     */
 
+    if (background_model == SLIDING_WINDOW_BACKGROUND) {
+        num_background_frames++;
+        add_frame_to_sliding_window_background();
+        return;
+    }
+
     if (num_background_frames == 0) {
         for (int i = 0; i < FRAME_HEIGHT; i++) {
             for (int j = 0; j < FRAME_WIDTH; j++) {
-                pixel_averages[i][j] = frame[i][j];
+                pixel_averages[i][j] = frame_data[i * frame_row_step + j * frame_column_step];
                 pixel_variance[i][j] = 0;
             }
         }
@@ -113,7 +618,7 @@ void ThermalTracker::build_background(){
         // Mean the frames together to form the background and calculate variance
         for (int i = 0; i < FRAME_HEIGHT; i++) {
             for (int j = 0; j < FRAME_WIDTH; j++) {
-                float temp = frame[i][j];
+                float temp = frame_data[i * frame_row_step + j * frame_column_step];
                 float last_average = pixel_averages[i][j];
 
                 pixel_averages[i][j] += (temp - last_average) / (num_background_frames + 1);
@@ -135,6 +640,21 @@ void ThermalTracker::build_background(){
                 pixel_variance[i][j] = sqrtf(pixel_variance[i][j]/(num_background_frames - 1));
             }
         }
+
+        update_activation_bounds();
+    }
+}
+
+void ThermalTracker::add_frame_to_background(){
+    /**
+    * Add the currently-loaded frame to the background once tracking has begun.
+    * The mixture model learns from every frame as it classifies them, so it isn't updated here.
+    */
+    if (background_model == RUNNING_AVERAGE_BACKGROUND) {
+        add_frame_to_to_running_background();
+    }
+    else if (background_model == SLIDING_WINDOW_BACKGROUND) {
+        add_frame_to_sliding_window_background();
     }
 }
 
@@ -145,18 +665,98 @@ void ThermalTracker::add_frame_to_to_running_background(){
     * Note: This method is different to build_background in that the averages and variances are rolling.
     *       Pixel averages and variances are weighted and averaged out of significance as new frames are added.
     *       This results in the averages and variances to be inaccurate, but 'close enough' to function in this implementation.
+    *       With the pyramid on, its coarse background takes every frame, but only one row of cells is refreshed at full
+    *       resolution. Each row then takes a frame in every pyramid->get_height(), weighted so it adapts just as quickly.
     */
-    for (int i = 0; i < FRAME_HEIGHT; i++) {
+    int first_row = 0;
+    int last_row = FRAME_HEIGHT;
+    float population_size = running_average_size;
+
+    if (pyramid != NULL) {
+        pyramid->add_to_background(running_average_size);
+
+        first_row = pyramid->get_refresh_row() * pyramid->get_factor();
+        last_row = min(first_row + pyramid->get_factor(), FRAME_HEIGHT);
+        population_size = 1.0 / (1.0 - powf(1.0 - 1.0 / running_average_size, pyramid->get_height()));
+        pyramid->advance_refresh_row();
+    }
+
+    for (int i = first_row; i < last_row; i++) {
         for (int j = 0; j < FRAME_WIDTH; j++) {
-            float temp = frame[i][j];
+            float temp = frame_data[i * frame_row_step + j * frame_column_step];
 
             // Add the weighted average
-            pixel_averages[i][j] = ((pixel_averages[i][j] * (running_average_size - 1)) + temp)/running_average_size;
+            pixel_averages[i][j] = ((pixel_averages[i][j] * (population_size - 1)) + temp)/population_size;
 
             // Add the weighted variance
             float incremental_variance = absolute(temp - pixel_averages[i][j]);
-            pixel_variance[i][j] = ((pixel_variance[i][j] * (running_average_size - 1)) + incremental_variance)/running_average_size;
+            pixel_variance[i][j] = ((pixel_variance[i][j] * (population_size - 1)) + incremental_variance)/population_size;
+
+            // Refresh the activation bounds while the pixel is still in hand
+            float margin = pixel_variance[i][j] * activation_sigma;
+            activation_bounds[LOWER_BOUND][i][j] = pixel_averages[i][j] - margin;
+            activation_bounds[UPPER_BOUND][i][j] = pixel_averages[i][j] + margin;
+        }
+    }
+}
+
+void ThermalTracker::add_frame_to_sliding_window_background(){
+    /**
+    * Add the current frame to the sliding window background.
+    * Unlike add_frame_to_to_running_background, the averages and deviations are exact over the last running_average_size frames.
+    * The update costs the same no matter how long the window is.
+    */
+    sliding_window_background->add_frame(get_row_major_frame());
+    sliding_window_background->get_statistics(&pixel_averages[0][0], &pixel_variance[0][0]);
+    update_activation_bounds();
+}
+
+void ThermalTracker::update_activation_bounds(){
+    /**
+    * Recalculate the temperature bounds that pixels must stray outside of to be considered active.
+    * The bounds only change when the background does, so they are cached rather than worked out for every frame.
+    */
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            float margin = pixel_variance[i][j] * activation_sigma;
+            activation_bounds[LOWER_BOUND][i][j] = pixel_averages[i][j] - margin;
+            activation_bounds[UPPER_BOUND][i][j] = pixel_averages[i][j] + margin;
+        }
+    }
+
+    if (pyramid != NULL) {
+        pyramid->set_background(&pixel_averages[0][0], &pixel_variance[0][0]);
+    }
+}
+
+void ThermalTracker::add_frame_to_mixture_background(){
+    /**
+    * Classify the current frame against the mixture background and fold it into the mixture.
+    * While the background is being built, the learning rate follows the number of frames seen so the first frames are averaged evenly.
+    * Afterwards, the mixture adapts at the same rate as the running average would.
+    * When running behind, the frame is only classified, just as the other backgrounds skip their updates.
+    */
+    float learning_rate = 1.0 / running_average_size;
+    if (!finished_building_background()) {
+        learning_rate = 1.0 / (num_background_frames + 1);
+    }
+
+    if (finished_building_background() && degradation_level >= SKIP_BACKGROUND_UPDATE) {
+        mixture_background->classify_frame(get_row_major_frame(), &foreground[0][0]);
+    }
+    else{
+        mixture_background->process_frame(get_row_major_frame(), learning_rate, &foreground[0][0]);
+    }
+
+    if (finished_building_background()) {
+        int num_active = 0;
+        for (int i = 0; i < FRAME_HEIGHT; i++) {
+            for (int j = 0; j < FRAME_WIDTH; j++) {
+                foreground[i][j] &= detection_mask[i][j];
+                num_active += foreground[i][j];
+            }
         }
+        frame_stats.num_active_pixels = num_active;
     }
 }
 
@@ -173,6 +773,11 @@ void ThermalTracker::get_averages(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH])
     * Get the average temperatures of the background pixels.
     * @param frame_buffer A 2D array to pass the averages into. Averages in deg C
     */
+    if (background_model == MIXTURE_BACKGROUND) {
+        mixture_background->get_averages(&frame_buffer[0][0]);
+        return;
+    }
+
     for (int i = 0; i < FRAME_HEIGHT; i++) {
         for (int j = 0; j < FRAME_WIDTH; j++) {
             frame_buffer[i][j] = pixel_averages[i][j];
@@ -185,6 +790,11 @@ void ThermalTracker::get_variances(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]
     * Get the temperature variances of the background pixels.
     * @param frame_buffer A 2D array to pass the variances into. Variances in deg C.
     */
+    if (background_model == MIXTURE_BACKGROUND) {
+        mixture_background->get_deviations(&frame_buffer[0][0]);
+        return;
+    }
+
     for (int i = 0; i < FRAME_HEIGHT; i++) {
         for (int j = 0; j < FRAME_WIDTH; j++) {
             frame_buffer[i][j] = pixel_variance[i][j];
@@ -199,86 +809,215 @@ void ThermalTracker::get_variances(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]
 int ThermalTracker::get_blobs(Blob blobs[]){
     /**
     * Search through the current frame to find pixel 'blobs' that appear in front of the background.
+    * If upsampling is on, the search runs over the interpolated frame and the blobs are in upsampled pixels.
+    * Detection stops at blob_limit blobs, which is lowered when the tracker is running behind.
+    * If the pyramid is on, only its regions of interest are searched.
     * @param blobs A Blob array to pass the detected blobs into.
     * @return Number of detected blobs
     *
     * Psuedo:
-    * - Assign every active pixel to a blob
-    * - Sorting ends when there are no more pixels left inside the active pixel queue
-    * - Active pixels are sent to the sort queue if they are adjacent to the currently investigated pixel
-    * - After a pixel is moved to the sort queue, the active pixel queue must be resorted to remove gaps (which can be performed on the fly)
-    * - In the case of multiple adjcent active pixels in the queue, the first free position is indexed as the free space
-    * - Subsequent non-adjacent pixels will be moved to the next free space
-    * - To reiterate: the active pixel queue starts off populated with active pixels
-    * - The active queue depletes as pixels are sorted until there are no more pixels left
-    * - The number of pixels left in the active pixels queue is managed by the num_active_pixels variable
-    * - After each sweep of the queue, the active pixels are resorted to remove gaps in the array as elements are popped out
-    * - The sort queue is reset with each blob that is constructed
-    * - The sort queue starts with zero elements and is populated using pixels from the active pixel queue
-    * - Elements are not sorted or removed from the sort queue until the blob is finalised
-    * - Pixels in the sort queue are added to the blob once they have finished checking for adjacency with active pixels, then are not operated on again
-    */
-
-    Pixel active_pixels[FRAME_WIDTH * FRAME_HEIGHT];
-    int num_blobs = 0;
-    int vacant_index = FRAME_WIDTH * FRAME_HEIGHT + 1;
-    clear_blobs(blobs);
+    * - Every active pixel is marked as waiting to be labelled
+    * - Pixels are visited in row-major order; the first one still waiting seeds a new blob
+    * - The blob is flood filled from the seed through its 8 neighbours, unmarking each pixel as it is queued
+    * - Each pixel only ever has its sums accumulated into the blob; the derived values are worked out once when the blob is finished
+    * - Blobs come out in the order of their first pixel, same as the old queue-sorting search
+    */
+
+    bool sensor_unlabelled[FRAME_WIDTH * FRAME_HEIGHT];
+    pixel_index sensor_queue[FRAME_WIDTH * FRAME_HEIGHT];
+    bool* unlabelled = sensor_unlabelled;
+    pixel_index* fill_queue = sensor_queue;
+    const float* temperatures = frame_data;
+    int row_step = frame_row_step;
+    int column_step = frame_column_step;
+    int width = FRAME_WIDTH;
+    int height = FRAME_HEIGHT;
+
+    // The mixture model classifies the frame itself
+    const bool* mask = &active_mask[0][0];
+    if (background_model == MIXTURE_BACKGROUND) {
+        mask = &foreground[0][0];
+    }
+
+    // Detect on the interpolated frame instead, unless running too far behind to afford it
+    if (upsampler != NULL && degradation_level < COARSE_DETECTION) {
+        if (background_model == MIXTURE_BACKGROUND) {
+            upsampler->upsample(frame_data, frame_row_step, frame_column_step, mask);
+        }
+        else{
+            upsampler->upsample(frame_data, frame_row_step, frame_column_step, &activation_bounds[LOWER_BOUND][0][0], &activation_bounds[UPPER_BOUND][0][0]);
+            if (num_excluded_pixels > 0) {
+                upsampler->mask_pixels(&detection_mask[0][0]);
+            }
+        }
 
-    int num_active_pixels = get_active_pixels(active_pixels);
+        unlabelled = detection_unlabelled;
+        fill_queue = detection_queue;
+        temperatures = upsampler->get_frame();
+        mask = upsampler->get_mask();
+        width = upsampler->get_width();
+        height = upsampler->get_height();
+        row_step = width;
+        column_step = 1;
+    }
 
-    // Assign every active pixel to a blob
-    while ((num_active_pixels > 0) && (num_blobs < MAX_BLOBS)){
+    int num_blobs = 0;
+    int num_active_pixels = 0;
+    int num_labelled_pixels = 0;
+    clear_blobs(blobs);
 
-        int num_queued_pixels = 0;
-        int queue_index = 0;
-        vacant_index = 0;
-        Pixel sort_queue[FRAME_WIDTH * FRAME_HEIGHT];
-        sort_queue[num_queued_pixels++].set(active_pixels[vacant_index].get_x(), active_pixels[vacant_index].get_y(), active_pixels[vacant_index].get_temperature());
-        bool first_pixel = true;
+    // Only the pyramid's regions of interest are searched; everything else in the scratch is always unlabelled
+    if (pyramid != NULL) {
+        const bool* regions = pyramid->get_regions();
+        int factor = pyramid->get_factor();
+        int cell_columns = pyramid->get_width();
+        unlabelled = detection_unlabelled;
+        fill_queue = detection_queue;
+
+        for (int cell = 0; cell < cell_columns * pyramid->get_height(); cell++) {
+            if (!regions[cell]) {
+                continue;
+            }
 
-        // Construct the current blob
-        while (queue_index < num_queued_pixels) {
+            int top = (cell / cell_columns) * factor;
+            int left = (cell % cell_columns) * factor;
+            for (int i = top; i < min(top + factor, FRAME_HEIGHT); i++) {
+                for (int j = left; j < min(left + factor, FRAME_WIDTH); j++) {
+                    unlabelled[i * FRAME_WIDTH + j] = active_mask[i][j];
+                    num_active_pixels += active_mask[i][j];
+                }
+            }
+        }
 
-            // Find adjacent active pixels in the queue
-            for (int i = 0; i < num_active_pixels; i++) {
+        // Seeds are still visited in row-major order, a cell-wide span at a time, skipping rows of cells with no regions
+        for (int i = 0; i < FRAME_HEIGHT && num_blobs < blob_limit; i++) {
+            const bool* region_row = &regions[(i / factor) * cell_columns];
+            if (i % factor == 0) {
+                bool row_has_regions = false;
+                for (int cell_column = 0; cell_column < cell_columns; cell_column++) {
+                    row_has_regions |= region_row[cell_column];
+                }
 
-                if (first_pixel){
-                    i++;
-                    first_pixel = false;
+                if (!row_has_regions) {
+                    i += factor - 1;
+                    continue;
                 }
+            }
 
-                // If the pixel is adjacent to the current pixel, add it to the sort queue
-                if (sort_queue[queue_index].is_adjacent(active_pixels[i])) {
-                    sort_queue[num_queued_pixels++].set(active_pixels[i].get_x(), active_pixels[i].get_y(), active_pixels[i].get_temperature());
+            for (int cell_column = 0; cell_column < cell_columns && num_blobs < blob_limit; cell_column++) {
+                if (!region_row[cell_column]) {
+                    continue;
                 }
 
-                else{
-                    if (vacant_index < i){
-                        // Sort the pixel to the front of the queue
-                        active_pixels[vacant_index].set(active_pixels[i].get_x(), active_pixels[i].get_y(), active_pixels[i].get_temperature());
+                int left = cell_column * factor;
+                for (int j = left; j < min(left + factor, FRAME_WIDTH) && num_blobs < blob_limit; j++) {
+                    int seed = i * FRAME_WIDTH + j;
+                    if (unlabelled[seed]) {
+                        num_labelled_pixels += flood_fill(blobs[num_blobs++], seed, unlabelled, fill_queue, width, height, temperatures, row_step, column_step);
                     }
-                    vacant_index++;
                 }
             }
+        }
+
+        // Leave no pixels behind for the next frame if the blob pool ran out
+        if (num_labelled_pixels < num_active_pixels) {
+            for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+                unlabelled[i] = false;
+            }
+
+            num_blob_overflows++;
+            num_dropped_pixels += num_active_pixels - num_labelled_pixels;
+        }
+
+        return num_blobs;
+    }
+
+    return label_blobs(blobs, mask, width, height, temperatures, row_step, column_step, unlabelled, fill_queue);
+}
 
-            // Reset the number of active pixels in the queue
-            // Note: This needs to be changed at the end of each search cycle; not during
-            num_active_pixels = vacant_index;
-            vacant_index = 0;
+int ThermalTracker::label_blobs(Blob blobs[], const bool mask[], int width, int height, const float temperatures[], int row_step, int column_step, bool unlabelled[], pixel_index fill_queue[]){
+    /**
+    * Assign every active pixel of a detection grid to a blob, seeding new blobs in row-major order.
+    * The blobs must already be cleared.
+    * @param blobs A Blob array to pass the detected blobs into
+    * @param mask Row-major flags of the active pixels
+    * @param width Width of the detection grid in pixels
+    * @param height Height of the detection grid in pixels
+    * @param temperatures Pixel temperatures; pixel (i, j) is at temperatures[i * row_step + j * column_step]
+    * @param row_step Number of floats between vertically adjacent pixels
+    * @param column_step Number of floats between horizontally adjacent pixels
+    * @param unlabelled Scratch space for the pixels still waiting to be labelled; one bool per pixel
+    * @param fill_queue Scratch space for the flood fill; one index per pixel
+    * @return Number of detected blobs
+    */
+    int num_pixels = width * height;
+    int num_blobs = 0;
+    int num_active_pixels = 0;
+    int num_labelled_pixels = 0;
 
-            // Searched finished; add the current pixel to the blob
-            blobs[num_blobs].add_pixel(sort_queue[queue_index++]);
+    for (int i = 0; i < num_pixels; i++) {
+        unlabelled[i] = mask[i];
+        num_active_pixels += mask[i];
+    }
+
+    for (int seed = 0; seed < num_pixels && num_blobs < blob_limit; seed++) {
+        if (unlabelled[seed]) {
+            num_labelled_pixels += flood_fill(blobs[num_blobs++], seed, unlabelled, fill_queue, width, height, temperatures, row_step, column_step);
         }
+    }
 
-        // Blob finished; add it to the current blobs and start on the next one
-        num_blobs++;
+    // Out of room in the blob pool; the remaining pixels are dropped
+    if (num_labelled_pixels < num_active_pixels) {
+        num_blob_overflows++;
+        num_dropped_pixels += num_active_pixels - num_labelled_pixels;
     }
 
     return num_blobs;
 }
 
-void ThermalTracker::clear_blobs(Blob blobs[MAX_BLOBS]){
-    for (int i = 0; i < MAX_BLOBS; i++) {
+int ThermalTracker::flood_fill(Blob& blob, int seed, bool unlabelled[], pixel_index fill_queue[], int width, int height, const float temperatures[], int row_step, int column_step){
+    /**
+    * Grow a blob out from a seed pixel through all of the unlabelled pixels connected to it, including diagonally.
+    * Each pixel is unmarked as it is queued, so it only ever joins one blob. The blob is finalized at the end.
+    * @param blob Empty blob to build
+    * @param seed Row-major index of the first pixel of the blob
+    * @param unlabelled Row-major flags of the active pixels that are still waiting to be put in a blob
+    * @param fill_queue Scratch space for the flood fill; one index per pixel
+    * @param width Width of the detection grid in pixels
+    * @param height Height of the detection grid in pixels
+    * @param temperatures Pixel temperatures; pixel (i, j) is at temperatures[i * row_step + j * column_step]
+    * @param row_step Number of floats between vertically adjacent pixels
+    * @param column_step Number of floats between horizontally adjacent pixels
+    * @return Number of pixels in the blob
+    */
+    int queue_start = 0;
+    int queue_end = 0;
+    fill_queue[queue_end++] = seed;
+    unlabelled[seed] = false;
+
+    while (queue_start < queue_end) {
+        int index = fill_queue[queue_start++];
+        int x = index % width;
+        int y = index / width;
+        blob.accumulate_pixel(x, y, temperatures[y * row_step + x * column_step]);
+
+        for (int row = max(y - 1, 0); row <= min(y + 1, height - 1); row++) {
+            for (int column = max(x - 1, 0); column <= min(x + 1, width - 1); column++) {
+                int neighbour = row * width + column;
+                if (unlabelled[neighbour]) {
+                    fill_queue[queue_end++] = neighbour;
+                    unlabelled[neighbour] = false;
+                }
+            }
+        }
+    }
+
+    blob.finalize();
+    return queue_end;
+}
+
+void ThermalTracker::clear_blobs(Blob blobs[]){
+    for (int i = 0; i < max_blobs; i++) {
         blobs[i].clear();
     }
 }
@@ -286,19 +1025,24 @@ void ThermalTracker::clear_blobs(Blob blobs[MAX_BLOBS]){
 int ThermalTracker::get_active_pixels(Pixel pixel_buffer[]){
     /**
     * Return the active pixels in the current frame.
+    * A pixel is active when its temperature falls outside of the cached activation bounds of the background.
+    * The check itself is done by load_frame; this just collects the pixels flagged in the active mask.
+    * Pixels are always at the sensor's resolution, even if detection is upsampled.
     * @param active Array of Pixel objects. Active pixels are added to the array.
     * @return Number of active pixels in the array.
     */
     int num_active = 0;
 
+    // The mixture model classifies the frame itself
+    bool (*mask)[FRAME_WIDTH] = active_mask;
+    if (background_model == MIXTURE_BACKGROUND) {
+        mask = foreground;
+    }
+
     for (int i = 0; i < FRAME_HEIGHT; i++) {
         for (int j = 0; j < FRAME_WIDTH; j++) {
-            float temp = frame[i][j];
-            float average = pixel_averages[i][j];
-            float variance = pixel_variance[i][j];
-
-            if (absolute(average - temp) > (variance * 3)) {
-                pixel_buffer[num_active++].set(j, i, temp);
+            if (mask[i][j]) {
+                pixel_buffer[num_active++].set(j, i, frame_data[i * frame_row_step + j * frame_column_step]);
             }
         }
     }
@@ -306,18 +1050,20 @@ int ThermalTracker::get_active_pixels(Pixel pixel_buffer[]){
     return num_active;
 }
 
-void ThermalTracker::remove_small_blobs(Blob blobs[MAX_BLOBS]){
+void ThermalTracker::remove_small_blobs(Blob blobs[]){
     /**
     * Drop any blobs that are smaller than the minimum required size.
     * Must be performed after the blobs have finished building
     * @param blobs Blob array comtaining the discovered blobs from a get_blobs call
     * @param minimum_size Minimum number of pixels a blob should have to avoid the chopping block
     */
-    int vacant_index = MAX_BLOBS + 1;
+    int vacant_index = max_blobs + 1;
+    int upsampling_factor = get_upsampling_factor();
+    int min_size = min_blob_size * upsampling_factor * upsampling_factor;  // Same area of the sensor at any upsampling factor
 
     // Pass over the blob array and pop the small ones
-    for (int i = 0; i < MAX_BLOBS; i++) {
-        if (blobs[i].get_size() < min_blob_size) {
+    for (int i = 0; i < max_blobs; i++) {
+        if (blobs[i].get_size() < min_size) {
             // Blob too smol; pop it out
             blobs[i].clear();
 
@@ -335,14 +1081,14 @@ void ThermalTracker::remove_small_blobs(Blob blobs[MAX_BLOBS]){
     }
 }
 
-int ThermalTracker::get_num_blobs(Blob blobs[MAX_BLOBS]){
+int ThermalTracker::get_num_blobs(Blob blobs[]){
     /**
     * Get the number of active blobs in an array
     * @param blobs Array containing the blobs. Yup. Pretty much what it says on the label...
     * @return Number of active blobs in the array.
     */
     int num_blobs = 0;
-    for(int i = 0; i < MAX_BLOBS; i++){
+    for(int i = 0; i < max_blobs; i++){
         if(blobs[i].is_active()){
             num_blobs++;
         }
@@ -351,14 +1097,14 @@ int ThermalTracker::get_num_blobs(Blob blobs[MAX_BLOBS]){
     return num_blobs;
 }
 
-int ThermalTracker::get_num_blobs(TrackedBlob blobs[MAX_BLOBS]){
+int ThermalTracker::get_num_blobs(TrackedBlob blobs[]){
     /**
     * Get the number of active blobs in an array
     * @param blobs Array containing the blobs. Yup. Pretty much what it says on the label...
     * @return Number of active blobs in the array.
     */
     int num_blobs = 0;
-    for(int i = 0; i < MAX_BLOBS; i++){
+    for(int i = 0; i < max_blobs; i++){
         if(blobs[i].is_active()){
             num_blobs++;
         }
@@ -399,8 +1145,8 @@ void ThermalTracker::sort_tracked_blobs(TrackedBlob tracked_blobs[]){
     *   this function didn't feel right.
     */
     // Clean up at the end - Remove gaps in the tracked blobs table and process/clear old and un-updated tracked blobs
-    int free_index = MAX_BLOBS + 1;
-    for (int i = 0; i < MAX_BLOBS; i++) {
+    int free_index = max_blobs + 1;
+    for (int i = 0; i < max_blobs; i++) {
         if (tracked_blobs[i].has_updated()) {
 
             // Tracked blob has updated
@@ -427,7 +1173,7 @@ void ThermalTracker::sort_tracked_blobs(TrackedBlob tracked_blobs[]){
     }
 }
 
-void ThermalTracker::add_remaining_blobs_to_tracked(Blob new_blobs[MAX_BLOBS], TrackedBlob tracked_blobs[MAX_BLOBS]) {
+void ThermalTracker::add_remaining_blobs_to_tracked(Blob new_blobs[], TrackedBlob tracked_blobs[]) {
     /**
     * Add any remaining, new blobs, to the tracked blob list.
     * @param new_blobs Blobs from the latest frame - may contain newly discovered blobs to be tracked
@@ -441,7 +1187,7 @@ void ThermalTracker::add_remaining_blobs_to_tracked(Blob new_blobs[MAX_BLOBS], T
 
     if (num_unassigned_blobs > 0) {
         int i = 0;
-        while (num_unassigned_blobs > 0 && i < MAX_BLOBS) {
+        while (num_unassigned_blobs > 0 && i < max_blobs && num_updated_blobs < max_blobs) {
             if (new_blobs[i].is_active() && !new_blobs[i].is_assigned()){
                 tracked_blobs[num_updated_blobs++].set(new_blobs[i]);
                 new_blobs[i].set_assigned();    // Probably not necessary...
@@ -452,67 +1198,208 @@ void ThermalTracker::add_remaining_blobs_to_tracked(Blob new_blobs[MAX_BLOBS], T
     }
 }
 
-void ThermalTracker::update_tracked_blobs(Blob new_blobs[MAX_BLOBS], TrackedBlob tracked_blobs[MAX_BLOBS]){
+void ThermalTracker::update_tracked_blobs(Blob new_blobs[], TrackedBlob tracked_blobs[]){
     /**
     * Update the details of previously tracked blobs if there is a similar enough to a current blob.
     * @param new_blobs Blobs from the last frame
     * @param tracked_blobs Previously tracked blobs to be updated if there are any matches
     */
-    for (int i = 0; i < MAX_BLOBS; i++) {
+    for (int i = 0; i < max_blobs; i++) {
         tracked_blobs[i].reset_updated_status();
         new_blobs[i].clear_assigned();
     }
 
     // Create a distance matrix to show which blobs are likely the same across frames (lower distance == more likely the same)
-    float distance_matrix[MAX_BLOBS][MAX_BLOBS]; /**< Stores the distance values between every tracked_blob/new_blob combination */
-    int indexes[2];
     generate_distance_matrix(tracked_blobs, new_blobs, distance_matrix);
 
-    // Keep going until there are no more matches
-    while(get_lowest_distance(distance_matrix, indexes) < max_distance_threshold){
-        // Update the tracked blob
-        tracked_blobs[indexes[0]].update_blob(new_blobs[indexes[1]]);
+    int num_matches = get_matches(distance_matrix, matches);
+    for (int i = 0; i < num_matches; i++) {
+        if (counting_lines != NULL) {
+            check_counting_lines(tracked_blobs[matches[i][0]], new_blobs[matches[i][1]]);
+        }
+
+        tracked_blobs[matches[i][0]].update_blob(new_blobs[matches[i][1]]);
+        new_blobs[matches[i][1]].set_assigned();
 
-        // Remove the matched up rows and columns from the distance matrix so they cannot be matched again
-        remove_distance_row_col(indexes[0], indexes[1], distance_matrix);
-        new_blobs[indexes[1]].set_assigned();
+        if (early_commit) {
+            commit_blob_movements(tracked_blobs[matches[i][0]]);
+        }
     }
 }
 
-void ThermalTracker::generate_distance_matrix(TrackedBlob tracked_blobs[MAX_BLOBS], Blob blobs[MAX_BLOBS],float output[MAX_BLOBS][MAX_BLOBS]){
+int ThermalTracker::get_matches(float distance_matrix[], int matches[][2]){
     /**
-    * Generate a matrix of the distances between the tracked blobs and blobs.
-    * @param tracked_blobs List containing the tracked blobs
-    * @param blobs List containing the new blobs from the frame
-    * @param output Matrix to store the distance values
+    * Greedily pair up tracked blobs and blobs, closest first, until no pairs under the maximum distance threshold remain.
+    * Pairs at UNMATCHABLE_DISTANCE, such as those pruned by the position gate or in the rows of inactive tracked blobs,
+    * are never matched, even with a threshold above it.
+    * All candidate pairs under the threshold are collected once into a heap and popped in order of distance,
+    * skipping any whose tracked blob or blob has already been taken.
+    * This gives the same matches as repeatedly taking the lowest distance and removing its row and column,
+    * without rescanning the matrix after every match. Ties go to the lowest (tracked blob, blob) index as before.
+    * The heap and taken flags live in the arena, sized by max_blobs.
+    * @param distance_matrix Matrix containing the distance values between the tracked blobs and blobs
+    * @param matches Output list of matched (tracked blob, blob) index pairs
+    * @return Number of matches found
     */
+    const float* distances = distance_matrix;
+    int* heap = match_heap;
+    int num_flag_words = (max_blobs + 31) / 32;
+    uint32_t* taken_rows = taken_flags;
+    uint32_t* taken_columns = &taken_flags[num_flag_words];
+    int num_edges = 0;
+    int num_matches = 0;
+
+    for (int i = 0; i < 2 * num_flag_words; i++) {
+        taken_flags[i] = 0;
+    }
 
-    for (int i = 0; i < MAX_BLOBS; i++) {
-        for (int j = 0; j < MAX_BLOBS; j++) {
-            if (blobs[j].is_active() && tracked_blobs[i].is_active()) {
-                output[i][j] = tracked_blobs[i].get_distance(blobs[j]);
-            }
-            else{
-                output[i][j] = 999;
-            }
+    for (int edge = 0; edge < max_blobs * max_blobs; edge++) {
+        if (distances[edge] < UNMATCHABLE_DISTANCE && distances[edge] < max_distance_threshold) {
+            heap[num_edges++] = edge;
+        }
+    }
+
+    for (int position = num_edges / 2 - 1; position >= 0; position--) {
+        sift_down_edge(distances, heap, num_edges, position);
+    }
+
+    while (num_edges > 0 && num_matches < max_blobs) {
+        int edge = heap[0];
+        heap[0] = heap[--num_edges];
+        sift_down_edge(distances, heap, num_edges, 0);
+
+        int row = edge / max_blobs;
+        int column = edge % max_blobs;
+        uint32_t row_bit = uint32_t(1) << (row % 32);
+        uint32_t column_bit = uint32_t(1) << (column % 32);
+
+        if ((taken_rows[row / 32] & row_bit) || (taken_columns[column / 32] & column_bit)) {
+            continue;
         }
+
+        taken_rows[row / 32] |= row_bit;
+        taken_columns[column / 32] |= column_bit;
+        matches[num_matches][0] = row;
+        matches[num_matches][1] = column;
+        num_matches++;
     }
+
+    return num_matches;
 }
 
-float ThermalTracker::get_lowest_distance(float distance_matrix[MAX_BLOBS][MAX_BLOBS], int indexes[2]){
+void ThermalTracker::generate_distance_matrix(TrackedBlob tracked_blobs[], Blob blobs[], float output[]){
     /**
-    * Get the index and value of the lowest distance in the distance matrix
-    * @param distance_matrix Matrix containing the distance values between the different tracked blobs and normal blobs.
-    * @param indexes The location of the lowest distance in the matrix.
+    * Generate a matrix of the distances between the tracked blobs and blobs.
+    * New blobs are binned into a uniform grid by centroid, so each tracked blob is only compared with the blobs in the cells
+    * around its reference position. Pairs further apart than the position gate are never compared and are left unmatchable.
+    * The grid cells are at least as large as the gate, so the surrounding 3x3 cells hold every blob inside the gate.
+    * Blob features are packed column-wise in grid order so the blobs in neighbouring cells form contiguous spans for the
+    * vectorised distance kernel.
+    * Positions and areas are compared in sensor pixels whatever grid the blobs were found on, so the distances, the position gate
+    * and max_distance_threshold mean the same at any upsampling factor.
+    * @param tracked_blobs List containing the tracked blobs
+    * @param blobs List containing the new blobs from the frame
+    * @param output Matrix to store the distance values; max_blobs x max_blobs, row-major
     */
-    float lowest = 999;
+    float position_scale = 1.0 / get_upsampling_factor();
+    float area_scale = position_scale * position_scale;
+    float cell_width = max(position_gate, float(FRAME_WIDTH) / DISTANCE_GRID_MAX_CELLS);
+    float cell_height = max(position_gate, float(FRAME_HEIGHT) / DISTANCE_GRID_MAX_CELLS);
+    int grid_columns = constrain(int(ceilf(FRAME_WIDTH / cell_width)), 1, DISTANCE_GRID_MAX_CELLS);
+    int grid_rows = constrain(int(ceilf(FRAME_HEIGHT / cell_height)), 1, DISTANCE_GRID_MAX_CELLS);
+
+    int16_t cell_starts[DISTANCE_GRID_MAX_CELLS * DISTANCE_GRID_MAX_CELLS + 1];   // Blob indexes, so never more than max_blobs
+    float tracked_features[NUM_BLOB_FEATURES];
+    int num_cells = grid_columns * grid_rows;
+    int num_active_blobs = 0;
+
+    for (int i = 0; i < max_blobs * max_blobs; i++) {
+        output[i] = UNMATCHABLE_DISTANCE;
+    }
+
+    // Counting sort the new blobs into their grid cells
+    for (int cell = 0; cell <= num_cells; cell++) {
+        cell_starts[cell] = 0;
+    }
+
+    for (int j = 0; j < max_blobs; j++) {
+        blob_cells[j] = -1;
+        if (blobs[j].is_active()) {
+            int column = constrain(int(blobs[j].centroid[X] * position_scale / cell_width), 0, grid_columns - 1);
+            int row = constrain(int(blobs[j].centroid[Y] * position_scale / cell_height), 0, grid_rows - 1);
+            blob_cells[j] = row * grid_columns + column;
+            cell_starts[blob_cells[j] + 1]++;
+            num_active_blobs++;
+        }
+    }
+
+    for (int cell = 0; cell < num_cells; cell++) {
+        cell_starts[cell + 1] += cell_starts[cell];
+    }
+
+    int16_t cell_fill[DISTANCE_GRID_MAX_CELLS * DISTANCE_GRID_MAX_CELLS];
+    for (int cell = 0; cell < num_cells; cell++) {
+        cell_fill[cell] = cell_starts[cell];
+    }
+
+    // Pack the blob features in grid order
+    for (int j = 0; j < max_blobs; j++) {
+        if (blob_cells[j] >= 0) {
+            int k = cell_fill[blob_cells[j]]++;
+            sorted_blobs[k] = j;
+            blob_features[FEATURE_X * max_blobs + k] = blobs[j].centroid[X] * position_scale;
+            blob_features[FEATURE_Y * max_blobs + k] = blobs[j].centroid[Y] * position_scale;
+            blob_features[FEATURE_AREA * max_blobs + k] = blobs[j].num_pixels * area_scale;
+            blob_features[FEATURE_TEMPERATURE * max_blobs + k] = blobs[j].average_temperature;
+            blob_features[FEATURE_ASPECT_RATIO * max_blobs + k] = blobs[j].aspect_ratio;
+        }
+    }
+
+    // Compare each tracked blob against the blobs in the neighbouring cells only
+    for (int i = 0; i < max_blobs; i++) {
+        if (!tracked_blobs[i].is_active()) {
+            continue;
+        }
+
+        tracked_blobs[i].get_features(tracked_features);
+        tracked_features[FEATURE_X] *= position_scale;
+        tracked_features[FEATURE_Y] *= position_scale;
+        tracked_features[FEATURE_AREA] *= area_scale;
+        int column = constrain(int(floorf(tracked_features[FEATURE_X] / cell_width)), 0, grid_columns - 1);
+        int row = constrain(int(floorf(tracked_features[FEATURE_Y] / cell_height)), 0, grid_rows - 1);
+        int num_evaluated = 0;
+
+        for (int cell_row = max(row - 1, 0); cell_row <= min(row + 1, grid_rows - 1); cell_row++) {
+            // Neighbouring cells in a row are contiguous in the packed features
+            int first = cell_starts[cell_row * grid_columns + max(column - 1, 0)];
+            int last = cell_starts[cell_row * grid_columns + min(column + 1, grid_columns - 1) + 1];
+
+            num_evaluated += compute_distance_span(tracked_features, blob_features, max_blobs, first, last, position_gate, blob_distances);
+
+            for (int k = first; k < last; k++) {
+                output[i * max_blobs + sorted_blobs[k]] = blob_distances[k];
+            }
+        }
+
+        num_evaluated_pairs += num_evaluated;
+        num_pruned_pairs += num_active_blobs - num_evaluated;
+    }
+}
+
+float ThermalTracker::get_lowest_distance(float distance_matrix[], int indexes[2]){
+    /**
+    * Get the index and value of the lowest distance in the distance matrix
+    * @param distance_matrix Matrix containing the distance values between the different tracked blobs and normal blobs.
+    * @param indexes The location of the lowest distance in the matrix.
+    */
+    float lowest = UNMATCHABLE_DISTANCE;
     int x_index = -1;
     int y_index = -1;
 
     // Find the value and index of the lowest value in the matrix
-    for (int i = 0; i < MAX_BLOBS; i++) {
-        for (int j = 0; j < MAX_BLOBS; j++) {
-            float distance = distance_matrix[i][j];
+    for (int i = 0; i < max_blobs; i++) {
+        for (int j = 0; j < max_blobs; j++) {
+            float distance = distance_matrix[i * max_blobs + j];
             if ( distance < lowest && distance < max_distance_threshold) {
                 lowest = distance;
                 x_index = i;
@@ -526,18 +1413,18 @@ float ThermalTracker::get_lowest_distance(float distance_matrix[MAX_BLOBS][MAX_B
     return lowest;
 }
 
-void ThermalTracker::remove_distance_row_col(int row, int col, float distance_matrix[MAX_BLOBS][MAX_BLOBS]){
+void ThermalTracker::remove_distance_row_col(int row, int col, float distance_matrix[]){
     /**
     * Remove a row and column from the distance matrix so it cannot be used in matching up blobs with tracked blobs.
-    * The entire row and column are marked with a distance of 999, which is far above the maximum distance threshold.
+    * The entire row and column are marked with UNMATCHABLE_DISTANCE, so they are never matched whatever the maximum distance threshold.
     * You'd use this function after a match has been found between a blob and a tracked blob.
     * @param row The row number (tracked blob index) to remove from the distance matrix
     * @param col The coloumn number (blob index) to remove from the distance matrix
     * @param distance_matrix A 2D matrix containing the combination of distance between tracked blobs and blobs
     */
-    for (int i = 0; i < MAX_BLOBS; i++) {
-        distance_matrix[row][i] = 999;
-        distance_matrix[i][col] = 999;
+    for (int i = 0; i < max_blobs; i++) {
+        distance_matrix[row * max_blobs + i] = UNMATCHABLE_DISTANCE;
+        distance_matrix[i * max_blobs + col] = UNMATCHABLE_DISTANCE;
     }
 }
 
@@ -545,28 +1432,34 @@ void ThermalTracker::process_blob_movements(TrackedBlob blob){
     /**
     * Check if a dying tracked blob has travelled far enough to register a movement.
     * If a tracked blob travels over the the net minimum travel threshold.
+    * Axes that were already counted by commit_blob_movements are skipped.
+    * Travel is in detection pixels, so the threshold is scaled to cover the same distance on the sensor at any upsampling factor.
     * @param blob Tracked blob to be processed. Contains the travel information.
     */
-
-    bool movement_added = false;
+    float travel_threshold = MINIMUM_TRAVEL_THRESHOLD * get_upsampling_factor();
+    bool movement_added = blob.is_committed(X) || blob.is_committed(Y);
 
     // Check for horizontal movement
-    if (abs(blob.get_travel(X)) > MINIMUM_TRAVEL_THRESHOLD) {
+    if (!blob.is_committed(X) && abs(blob.get_travel(X)) > travel_threshold) {
         movement_added = true;
         if (blob.get_travel(X) < 0) {
             add_movement(LEFT);
+            update_occupancy(LEFT, blob);
         }else{
             add_movement(RIGHT);
+            update_occupancy(RIGHT, blob);
         }
     }
 
     // Check for vertical movement
-    if (abs(blob.get_travel(Y)) > MINIMUM_TRAVEL_THRESHOLD) {
+    if (!blob.is_committed(Y) && abs(blob.get_travel(Y)) > travel_threshold) {
         movement_added = true;
         if (blob.get_travel(Y) > 0) {
             add_movement(UP);
+            update_occupancy(UP, blob);
         }else{
             add_movement(DOWN);
+            update_occupancy(DOWN, blob);
         }
     }
 
@@ -576,6 +1469,81 @@ void ThermalTracker::process_blob_movements(TrackedBlob blob){
     }
 }
 
+void ThermalTracker::commit_blob_movements(TrackedBlob& blob){
+    /**
+    * Count a live tracked blob's movement as soon as it has travelled far enough, instead of waiting for it to die.
+    * Each axis is counted at most once per blob, and is then skipped by process_blob_movements.
+    * @param blob Tracked blob that has just been updated
+    */
+    float travel_threshold = MINIMUM_TRAVEL_THRESHOLD * get_upsampling_factor();
+    if (!blob.is_committed(X) && abs(blob.get_travel(X)) > travel_threshold) {
+        int direction = blob.get_travel(X) < 0 ? LEFT : RIGHT;
+        add_movement(direction);
+        update_occupancy(direction, blob);
+        blob.commit(X);
+    }
+
+    if (!blob.is_committed(Y) && abs(blob.get_travel(Y)) > travel_threshold) {
+        int direction = blob.get_travel(Y) > 0 ? UP : DOWN;
+        add_movement(direction);
+        update_occupancy(direction, blob);
+        blob.commit(Y);
+    }
+}
+
+void ThermalTracker::check_counting_lines(TrackedBlob& tracked_blob, Blob& blob){
+    /**
+    * Count any counting lines crossed by a tracked blob as it moves to its new blob.
+    * Only the step since the last frame is checked, so this costs one test per line for each tracked blob.
+    * @param tracked_blob Tracked blob before it is updated
+    * @param blob Blob the tracked blob has been matched with
+    */
+    // Map detection pixels back onto the sensor's pixels, which the lines are in
+    float scale = get_upsampling_factor();
+    float from[2];
+    float to[2];
+    from[X] = (tracked_blob.get_position(X) + 0.5) / scale - 0.5;
+    from[Y] = (tracked_blob.get_position(Y) + 0.5) / scale - 0.5;
+    to[X] = (blob.centroid[X] + 0.5) / scale - 0.5;
+    to[Y] = (blob.centroid[Y] + 0.5) / scale - 0.5;
+
+    if (counting_lines->check_path(from, to) > 0) {
+        line_crossed_since_last_check = true;
+    }
+}
+
+void ThermalTracker::update_occupancy(int direction, TrackedBlob& blob){
+    /**
+    * Let people in or out of the room as their movements are counted.
+    * Blobs that weren't tracked for OCCUPANCY_CONFIRMATION_FRAMES are left out, so flickers don't change the occupancy.
+    * @param direction Direction of the movement that was just counted
+    * @param blob Tracked blob that made the movement
+    */
+    if (entry_direction == NO_DIRECTION || blob.get_age() < OCCUPANCY_CONFIRMATION_FRAMES) {
+        return;
+    }
+
+    // LEFT/RIGHT and UP/DOWN are pairs of opposites
+    if (direction == entry_direction) {
+        occupancy++;
+        occupancy_changed_since_last_check = true;
+    }
+    else if (direction == (entry_direction ^ 1) && occupancy > 0) {
+        occupancy--;
+        occupancy_changed_since_last_check = true;
+    }
+}
+
+void ThermalTracker::count_people_in_view(){
+    /**
+    * Count the confirmed tracked blobs in the current frame.
+    */
+    num_people_in_view = 0;
+    for (int i = 0; i < max_blobs; i++) {
+        num_people_in_view += tracked_blobs[i].is_active() && tracked_blobs[i].get_age() >= OCCUPANCY_CONFIRMATION_FRAMES;
+    }
+}
+
 void ThermalTracker::add_movement(int direction){
     /**
     * Increment the movement of the specified direction
@@ -584,6 +1552,10 @@ void ThermalTracker::add_movement(int direction){
     direction = constrain(direction, 0, 4);
     movements[direction]++;
     movement_changed_since_last_check = true;
+
+    if (movement_histogram != NULL) {
+        movement_histogram->add(direction, millis());
+    }
 }
 
 void ThermalTracker::get_movements(long _movements[NUM_DIRECTION_CATEGORIES]){
@@ -601,6 +1573,25 @@ void ThermalTracker::get_movements(long _movements[NUM_DIRECTION_CATEGORIES]){
     movement_changed_since_last_check = false;
 }
 
+void ThermalTracker::set_early_commit(bool enabled){
+    /**
+    * Count movements while people are still in view.
+    * Normally a movement is only counted once its tracked blob disappears, so someone standing in a doorway holds
+    * their count back indefinitely. With early commit on, each direction is counted the frame the blob's net travel
+    * passes MINIMUM_TRAVEL_THRESHOLD, and isn't counted again when the blob dies. A person who passes the threshold
+    * and then turns back is still counted in the first direction.
+    * @param enabled True to count movements as soon as they pass the threshold
+    */
+    early_commit = enabled;
+}
+
+bool ThermalTracker::get_early_commit(){
+    /**
+    * @return True if movements are counted as soon as they pass the threshold
+    */
+    return early_commit;
+}
+
 bool ThermalTracker::has_new_movements(){
     /**
     * Determine if there have been any new movements since the last check.
@@ -616,14 +1607,14 @@ void ThermalTracker::reset_movements(){
     }
 }
 
-int ThermalTracker::get_num_unassigned_blobs(Blob blobs[MAX_BLOBS]){
+int ThermalTracker::get_num_unassigned_blobs(Blob blobs[]){
     /**
     * Get the number of blobs that have not been assigned to a tracked blob
     * @param blobs A list of blobs to be tracked
     * @return Number of blobs that are not assigned to tracked blobs
     */
     int num_unassigned = 0;
-    for (int i = 0; i < MAX_BLOBS; i++) {
+    for (int i = 0; i < max_blobs; i++) {
         if (blobs[i].is_active() && !blobs[i].is_assigned()) {
             num_unassigned++;
         }
@@ -632,14 +1623,14 @@ int ThermalTracker::get_num_unassigned_blobs(Blob blobs[MAX_BLOBS]){
     return num_unassigned;
 }
 
-int ThermalTracker::get_num_updated_blobs(TrackedBlob tracked_blobs[MAX_BLOBS]){
+int ThermalTracker::get_num_updated_blobs(TrackedBlob tracked_blobs[]){
     /**
     * Get the number of blobs that have been updated in the tracked blob list
     * @param tracked_blobs List containing the tracked blobs
     * @return Number of tracked blobs that have been updated
     */
     int num_updated = 0;
-    for (int i = 0; i < MAX_BLOBS; i++) {
+    for (int i = 0; i < max_blobs; i++) {
         if(tracked_blobs[i].has_updated()){
             num_updated++;
         }
@@ -648,6 +1639,213 @@ int ThermalTracker::get_num_updated_blobs(TrackedBlob tracked_blobs[MAX_BLOBS]){
     return num_updated;
 }
 
+void ThermalTracker::set_position_gate(float gate){
+    /**
+    * Set how far apart a tracked blob and a new blob can be before they are no longer compared.
+    * The default gate of max_distance_threshold / POSITION_PENALTY never drops a pair that could have matched,
+    * since the position term alone would put the pair over the threshold. Smaller gates prune more pairs.
+    * @param gate Maximum centroid offset (x + y) in sensor pixels, whatever the upsampling factor
+    */
+    position_gate = gate;
+}
+
+long ThermalTracker::get_num_evaluated_pairs(){
+    /**
+    * Get the number of tracked blob/blob pairs that have had their distance calculated.
+    * @return Running count of evaluated pairs
+    */
+    return num_evaluated_pairs;
+}
+
+long ThermalTracker::get_num_pruned_pairs(){
+    /**
+    * Get the number of tracked blob/blob pairs skipped because they were outside of the position gate.
+    * @return Running count of pruned pairs
+    */
+    return num_pruned_pairs;
+}
+
+void ThermalTracker::set_pixel_calibration(float offsets[FRAME_HEIGHT][FRAME_WIDTH], float gains[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Set a per-pixel correction that is applied to every frame as it is loaded: temperature * gain + offset.
+    * Useful for flattening out fixed pattern noise or a lens' vignetting. Storage is allocated on the first call.
+    * The background is built from corrected frames, so reset it if the calibration changes after it has been built.
+    * @param offsets A 2D array of the offset to add to each pixel, in deg C
+    * @param gains A 2D array of the gain to multiply each pixel by
+    */
+    if (pixel_calibration == NULL) {
+        pixel_calibration = new float[2][FRAME_HEIGHT][FRAME_WIDTH];
+    }
+
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            pixel_calibration[PIXEL_OFFSET][i][j] = offsets[i][j];
+            pixel_calibration[PIXEL_GAIN][i][j] = gains[i][j];
+        }
+    }
+}
+
+void ThermalTracker::clear_pixel_calibration(){
+    /**
+    * Stop correcting incoming frames and free the calibration storage.
+    */
+    delete[] pixel_calibration;
+    pixel_calibration = NULL;
+}
+
+FrameStats ThermalTracker::get_frame_stats(){
+    /**
+    * Get the summary of the last processed frame.
+    * The stats are gathered while the frame is loaded, so they cost nothing extra to keep.
+    * With the pyramid on, the temperatures only cover the pixels it samples.
+    * @return Min, max and mean temperature of the frame, and the number of active pixels
+    */
+    return frame_stats;
+}
+
+bool ThermalTracker::set_upsampling_factor(int factor){
+    /**
+    * Run detection on a bilinearly upsampled frame, so that blobs have sub-pixel edges and centroids.
+    * With only 4 rows, a person barely moves far enough vertically to pass MINIMUM_TRAVEL_THRESHOLD; on a 2x or 4x grid they can.
+    * Blob positions, travel and areas are measured in upsampled pixels. The minimum blob size, the travel needed to count a movement,
+    * and the exclusion learning travel are scaled to cover the same area or distance of the sensor. Blobs are matched in sensor
+    * pixels, so max_distance_threshold and the position gate don't need changing either.
+    * The interpolation buffers are allocated here; a factor of 1 frees them. Any tracked blobs are dropped since their units change.
+    * @param factor Number of detection pixels per sensor pixel along each axis (1 - MAX_UPSAMPLING_FACTOR)
+    * Upsampling can't be combined with the pyramid.
+    * @return True if the factor is valid and has been applied
+    */
+    if (factor < 1 || factor > MAX_UPSAMPLING_FACTOR || (pyramid != NULL && factor > 1)) {
+        return false;
+    }
+
+    // Already off, and the pyramid may be using the detection scratch
+    if (pyramid != NULL) {
+        return true;
+    }
+
+    delete upsampler;
+    delete[] detection_unlabelled;
+    delete[] detection_queue;
+    upsampler = NULL;
+    detection_unlabelled = NULL;
+    detection_queue = NULL;
+
+    if (factor > 1) {
+        upsampler = new FrameUpsampler(FRAME_WIDTH, FRAME_HEIGHT, factor);
+        int num_pixels = upsampler->get_width() * upsampler->get_height();
+        detection_unlabelled = new bool[num_pixels];
+        detection_queue = new pixel_index[num_pixels];
+    }
+
+    for (int i = 0; i < max_blobs; i++) {
+        tracked_blobs[i].clear();
+    }
+
+    return true;
+}
+
+int ThermalTracker::get_upsampling_factor(){
+    /**
+    * Get how finely detection is run compared to the sensor's resolution.
+    * Drops to 1 while the tracker is degraded to COARSE_DETECTION, since detection is back on the sensor grid.
+    * @return Number of detection pixels per sensor pixel along each axis
+    */
+    if (upsampler == NULL || degradation_level >= COARSE_DETECTION) {
+        return 1;
+    }
+
+    return upsampler->get_factor();
+}
+
+bool ThermalTracker::set_pyramid_factor(int factor){
+    /**
+    * Search large frames coarse-to-fine.
+    * Once the background is built, the frame is only sampled every PYRAMID_SAMPLE_SPACING pixels and checked against a
+    * background kept at that resolution. Only the factor x factor cells with a sample that stands out, and their
+    * neighbours, have their pixels checked against the activation bounds and labelled, and the full resolution
+    * background is refreshed a row of cells at a time. When people fill a small part of the view, most of the frame is
+    * never read. Blobs narrower or shorter than PYRAMID_SAMPLE_SPACING may be missed, and the frame stats only cover the samples.
+    * The pyramid needs a running average background, and can't be combined with upsampling.
+    * Its buffers are allocated here; a factor of 1 frees them.
+    * @param factor Number of pixels per coarse cell along each axis (1 to turn the pyramid off, or 2 - MAX_PYRAMID_FACTOR)
+    * @return True if the factor is valid and has been applied
+    */
+    if (factor < 1 || factor > MAX_PYRAMID_FACTOR) {
+        return false;
+    }
+
+    if (factor > 1 && (background_model != RUNNING_AVERAGE_BACKGROUND || upsampler != NULL)) {
+        return false;
+    }
+
+    // Already off, and the upsampler may be using the detection scratch
+    if (upsampler != NULL) {
+        return true;
+    }
+
+    delete pyramid;
+    delete[] detection_unlabelled;
+    delete[] detection_queue;
+    pyramid = NULL;
+    detection_unlabelled = NULL;
+    detection_queue = NULL;
+
+    if (factor > 1) {
+        pyramid = new DetectionPyramid(FRAME_WIDTH, FRAME_HEIGHT, factor);
+        pyramid->set_background(&pixel_averages[0][0], &pixel_variance[0][0]);
+        detection_unlabelled = new bool[FRAME_WIDTH * FRAME_HEIGHT];
+        detection_queue = new pixel_index[FRAME_WIDTH * FRAME_HEIGHT];
+
+        // Only the regions of interest are kept up to date from here on
+        for (int i = 0; i < FRAME_HEIGHT; i++) {
+            for (int j = 0; j < FRAME_WIDTH; j++) {
+                active_mask[i][j] = false;
+                detection_unlabelled[i * FRAME_WIDTH + j] = false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int ThermalTracker::get_pyramid_factor(){
+    /**
+    * Get the size of the pyramid's coarse cells.
+    * @return Number of pixels per coarse cell along each axis, or 1 if the pyramid is off
+    */
+    if (pyramid == NULL) {
+        return 1;
+    }
+
+    return pyramid->get_factor();
+}
+
+int ThermalTracker::get_max_blobs(){
+    /**
+    * Get the capacity of the blob and tracked blob pools.
+    * @return Maximum number of blobs that can be detected and tracked at once
+    */
+    return max_blobs;
+}
+
+long ThermalTracker::get_num_blob_overflows(){
+    /**
+    * Get the number of frames that had more blobs than the blob pool could hold.
+    * Blobs past the capacity are dropped before tracking; a steady count here means max_blobs is too small for the scene.
+    * @return Running count of overflowing frames
+    */
+    return num_blob_overflows;
+}
+
+long ThermalTracker::get_num_dropped_pixels(){
+    /**
+    * Get the number of active pixels that were never labelled because the blob pool was full.
+    * @return Running count of dropped pixels
+    */
+    return num_dropped_pixels;
+}
+
 int ThermalTracker::get_num_last_blobs(){
     /**
     * Get the number of blobs that were in the last processed frame.
@@ -655,3 +1853,555 @@ int ThermalTracker::get_num_last_blobs(){
     */
     return num_last_blobs;
 }
+
+size_t ThermalTracker::get_background_memory_usage(){
+    /**
+    * Get the number of bytes used by the background model, including any heap storage.
+    * The sliding window background grows with running_average_size; see SlidingWindowBackground::get_memory_usage to size it in advance.
+    * @return Memory usage in bytes
+    */
+    size_t usage = sizeof(pixel_averages) + sizeof(pixel_variance) + sizeof(activation_bounds);
+
+    if (background_model == MIXTURE_BACKGROUND) {
+        usage += mixture_background->get_memory_usage() + sizeof(foreground);
+    }
+
+    if (background_model == SLIDING_WINDOW_BACKGROUND) {
+        usage += sliding_window_background->get_memory_usage();
+    }
+
+    return usage;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Background persistence
+
+size_t ThermalTracker::get_background_snapshot_size(){
+    /**
+    * Get the number of bytes needed to hold a background snapshot.
+    * @return Snapshot size in bytes
+    */
+    return BACKGROUND_SNAPSHOT_HEADER_SIZE + 2 * sizeof(float) * FRAME_WIDTH * FRAME_HEIGHT;
+}
+
+size_t ThermalTracker::save_background(uint8_t buffer[], size_t buffer_size){
+    /**
+    * Save the background model into a buffer so it can be written to flash or a file and restored after a reset.
+    * The snapshot holds the pixel averages, deviations, and frame count behind a versioned header with a CRC.
+    * Only a finished running average background can be saved.
+    * @param buffer Buffer to write the snapshot into
+    * @param buffer_size Size of the buffer; must be at least get_background_snapshot_size() bytes
+    * @return Number of bytes written, or 0 if the background could not be saved
+    */
+    size_t snapshot_size = get_background_snapshot_size();
+    if (buffer_size < snapshot_size || background_model != RUNNING_AVERAGE_BACKGROUND || !finished_building_background()) {
+        return 0;
+    }
+
+    uint8_t* payload = &buffer[BACKGROUND_SNAPSHOT_HEADER_SIZE];
+    memcpy(payload, pixel_averages, sizeof(pixel_averages));
+    memcpy(payload + sizeof(pixel_averages), pixel_variance, sizeof(pixel_variance));
+    uint32_t crc = crc32(payload, snapshot_size - BACKGROUND_SNAPSHOT_HEADER_SIZE);
+
+    buffer[0] = BACKGROUND_SNAPSHOT_MAGIC & 0xFF;
+    buffer[1] = BACKGROUND_SNAPSHOT_MAGIC >> 8;
+    buffer[2] = BACKGROUND_SNAPSHOT_VERSION;
+    buffer[3] = FRAME_WIDTH;
+    buffer[4] = FRAME_HEIGHT;
+    buffer[5] = 0;
+    buffer[6] = num_background_frames & 0xFF;
+    buffer[7] = (num_background_frames >> 8) & 0xFF;
+    for (int i = 0; i < 4; i++) {
+        buffer[8 + i] = (crc >> (8 * i)) & 0xFF;
+    }
+
+    return snapshot_size;
+}
+
+bool ThermalTracker::restore_background(const uint8_t buffer[], size_t buffer_size){
+    /**
+    * Restore a background model saved by save_background, skipping the rebuild after a reset.
+    * The restored background is checked against the next RESTORE_VALIDATION_FRAMES live frames before tracking resumes.
+    * If the scene has changed too much, the background is rebuilt from scratch as usual.
+    * @param buffer Buffer containing the snapshot
+    * @param buffer_size Number of bytes in the buffer
+    * @return True if the snapshot was valid and has been loaded
+    */
+    size_t snapshot_size = get_background_snapshot_size();
+    if (buffer_size < snapshot_size || background_model != RUNNING_AVERAGE_BACKGROUND) {
+        return false;
+    }
+
+    uint16_t magic = buffer[0] | (uint16_t(buffer[1]) << 8);
+    int saved_frames = buffer[6] | (int(buffer[7]) << 8);
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) {
+        crc |= uint32_t(buffer[8 + i]) << (8 * i);
+    }
+
+    if (magic != BACKGROUND_SNAPSHOT_MAGIC || buffer[2] != BACKGROUND_SNAPSHOT_VERSION || buffer[3] != FRAME_WIDTH || buffer[4] != FRAME_HEIGHT) {
+        return false;
+    }
+
+    // A background built from fewer frames than the tracker is set up for isn't trusted
+    const uint8_t* payload = &buffer[BACKGROUND_SNAPSHOT_HEADER_SIZE];
+    if (saved_frames < running_average_size || crc != crc32(payload, snapshot_size - BACKGROUND_SNAPSHOT_HEADER_SIZE)) {
+        return false;
+    }
+
+    memcpy(pixel_averages, payload, sizeof(pixel_averages));
+    memcpy(pixel_variance, payload + sizeof(pixel_averages), sizeof(pixel_variance));
+    update_activation_bounds();
+
+    num_background_frames = saved_frames;
+    num_validation_frames = RESTORE_VALIDATION_FRAMES;
+    return true;
+}
+
+bool ThermalTracker::is_validating_background(){
+    /**
+    * Determine if a restored background is still being checked against the live frames.
+    * @return True if tracking is waiting on the validation of a restored background
+    */
+    return num_validation_frames > 0;
+}
+
+bool ThermalTracker::validate_restored_background(){
+    /**
+    * Check the current frame against a restored background.
+    * Most pixels should sit inside the activation bounds if the scene hasn't changed since the snapshot was taken.
+    * An inconsistent frame discards the restored background so that it is rebuilt starting with this frame.
+    * @return True if the frame was consumed by the validation; false if the background was discarded
+    */
+    // Consistent pixels are the ones load_frame found inside the bounds
+    int num_consistent = FRAME_WIDTH * FRAME_HEIGHT - frame_stats.num_active_pixels;
+
+    if (num_consistent < RESTORE_CONSISTENCY_RATIO * FRAME_WIDTH * FRAME_HEIGHT) {
+        reset_background();
+        return false;
+    }
+
+    num_validation_frames--;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Exclusion mask
+
+void ThermalTracker::set_exclusion_mask(const uint8_t mask[EXCLUSION_MASK_SIZE]){
+    /**
+    * Stop pixels from ever becoming active, such as the ones looking at a heater, light or monitor.
+    * Fixed heat sources otherwise show up as blobs in every frame, costing detection and tracking time and keeping
+    * the background from updating. Excluded pixels are still learnt into the background.
+    * @param mask Packed bitmask of the pixels to exclude, one bit per pixel in row-major order, least significant bit first.
+    *             Bit (i * FRAME_WIDTH + j) % 8 of byte (i * FRAME_WIDTH + j) / 8 excludes the pixel in row i, column j.
+    */
+    clear_exclusion_mask();
+
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            int index = i * FRAME_WIDTH + j;
+            if ((mask[index / 8] >> (index % 8)) & 1) {
+                exclude_pixel(i, j);
+            }
+        }
+    }
+}
+
+void ThermalTracker::get_exclusion_mask(uint8_t mask[EXCLUSION_MASK_SIZE]){
+    /**
+    * Get the excluded pixels, including any that have been learnt, so they can be saved and set again after a restart.
+    * @param mask Output packed bitmask in the same layout as set_exclusion_mask
+    */
+    for (int i = 0; i < EXCLUSION_MASK_SIZE; i++) {
+        mask[i] = exclusion_mask[i];
+    }
+}
+
+void ThermalTracker::clear_exclusion_mask(){
+    /**
+    * Let every pixel become active again.
+    */
+    for (int i = 0; i < EXCLUSION_MASK_SIZE; i++) {
+        exclusion_mask[i] = 0;
+    }
+
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            detection_mask[i][j] = true;
+        }
+    }
+
+    num_excluded_pixels = 0;
+}
+
+int ThermalTracker::get_num_excluded_pixels(){
+    /**
+    * @return Number of pixels in the exclusion mask
+    */
+    return num_excluded_pixels;
+}
+
+void ThermalTracker::set_exclusion_learning(int frames){
+    /**
+    * Add fixed heat sources to the exclusion mask automatically.
+    * A blob that has been tracked for the given number of frames without moving more than EXCLUSION_LEARNING_TRAVEL
+    * has its active pixels excluded. A person standing still for that long is excluded too, so keep this well above
+    * how long anyone is expected to stand in view, and save the mask with get_exclusion_mask once it has settled.
+    * @param frames Number of frames a blob must stay put for; 0 turns learning off
+    */
+    exclusion_learning_frames = max(frames, 0);
+}
+
+void ThermalTracker::exclude_pixel(int i, int j){
+    /**
+    * Add a pixel to the exclusion mask.
+    * @param i Row of the pixel
+    * @param j Column of the pixel
+    */
+    int index = i * FRAME_WIDTH + j;
+    num_excluded_pixels += detection_mask[i][j];
+    exclusion_mask[index / 8] |= 1 << (index % 8);
+    detection_mask[i][j] = false;
+}
+
+void ThermalTracker::learn_exclusions(){
+    /**
+    * Exclude the active pixels of any tracked blob that has stayed put for exclusion_learning_frames.
+    * The blob is dropped so that its track doesn't end as a movement.
+    */
+    int scale = get_upsampling_factor();
+    const bool* mask = &active_mask[0][0];
+    if (background_model == MIXTURE_BACKGROUND) {
+        mask = &foreground[0][0];
+    }
+
+    for (int i = 0; i < max_blobs; i++) {
+        TrackedBlob& blob = tracked_blobs[i];
+        if (!blob.is_active() || blob.get_age() < exclusion_learning_frames) {
+            continue;
+        }
+
+        if (absolute(blob.get_travel(X)) + absolute(blob.get_travel(Y)) > EXCLUSION_LEARNING_TRAVEL * scale) {
+            continue;
+        }
+
+        // Blob bounds are on the detection grid, which may be upsampled
+        int min_corner[2];
+        int max_corner[2];
+        blob.get_bounds(min_corner, max_corner);
+        for (int row = min_corner[Y] / scale; row <= max_corner[Y] / scale; row++) {
+            for (int column = min_corner[X] / scale; column <= max_corner[X] / scale; column++) {
+                if (mask[row * FRAME_WIDTH + column]) {
+                    exclude_pixel(row, column);
+                }
+            }
+        }
+
+        blob.clear();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Counting lines
+
+int ThermalTracker::add_counting_line(float start_x, float start_y, float end_x, float end_y){
+    /**
+    * Count people as they cross a line, rather than by their net travel once they leave the view.
+    * Tracked blobs are checked against the line every frame, so crossings are counted straight away, and a person who
+    * lingers or turns back is counted by what they actually crossed. The movement counts are kept as before.
+    * See CountingLines::add_line for the coordinates and which way is LINE_FORWARD.
+    * @param start_x Column of the start of the line, in sensor pixels
+    * @param start_y Row of the start of the line, in sensor pixels
+    * @param end_x Column of the end of the line, in sensor pixels
+    * @param end_y Row of the end of the line, in sensor pixels
+    * @return Index of the new line, or -1 if there are already MAX_COUNTING_LINES lines
+    */
+    if (counting_lines == NULL) {
+        counting_lines = new CountingLines();
+    }
+
+    return counting_lines->add_line(start_x, start_y, end_x, end_y);
+}
+
+void ThermalTracker::clear_counting_lines(){
+    /**
+    * Remove all of the counting lines and their counts.
+    */
+    delete counting_lines;
+    counting_lines = NULL;
+    line_crossed_since_last_check = false;
+}
+
+long ThermalTracker::get_line_count(int line, int direction){
+    /**
+    * Get the number of times a counting line has been crossed.
+    * @param line Index of the line from add_counting_line
+    * @param direction LINE_FORWARD or LINE_BACKWARD
+    * @return Number of crossings, or 0 if there is no such line
+    */
+    if (counting_lines == NULL) {
+        return 0;
+    }
+
+    return counting_lines->get_count(line, direction);
+}
+
+bool ThermalTracker::has_new_line_crossings(){
+    /**
+    * Check if any counting line has been crossed since the last check.
+    * Unlike has_new_movements, checking clears the flag, since there is no single call that grabs every line's counts.
+    * @return True if there are new crossings
+    */
+    bool crossed = line_crossed_since_last_check;
+    line_crossed_since_last_check = false;
+    return crossed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Occupancy
+
+void ThermalTracker::set_entry_direction(int direction){
+    /**
+    * Keep a live count of the people in the room the sensor is watching the door of.
+    * Each counted movement in the entry direction lets a person in, and each one in the opposite direction lets one out.
+    * Pair this with set_early_commit so people are counted as they pass through, rather than once they are out of view.
+    * @param direction LEFT, RIGHT, UP or DOWN; the way people move through the view to enter. NO_DIRECTION stops counting.
+    */
+    if (direction < LEFT || direction > NO_DIRECTION) {
+        direction = NO_DIRECTION;
+    }
+
+    entry_direction = direction;
+}
+
+void ThermalTracker::set_occupancy(int _occupancy){
+    /**
+    * Correct the occupancy, such as to zero it when the building is known to be empty overnight.
+    * @param _occupancy Number of people in the room
+    */
+    occupancy = max(_occupancy, 0);
+    occupancy_changed_since_last_check = true;
+}
+
+int ThermalTracker::get_occupancy(){
+    /**
+    * Get the number of people in the room; the entries less the exits, never going below zero.
+    * Reading the occupancy clears the occupancy_changed_since_last_check flag.
+    * @return Number of people in the room
+    */
+    occupancy_changed_since_last_check = false;
+    return occupancy;
+}
+
+bool ThermalTracker::has_occupancy_changed(){
+    /**
+    * Determine if the occupancy has changed since it was last read.
+    * @return True if the occupancy has changed
+    */
+    return occupancy_changed_since_last_check;
+}
+
+int ThermalTracker::get_num_people_in_view(){
+    /**
+    * Get the number of people in view right now, such as standing in the doorway.
+    * Only tracked blobs seen for at least OCCUPANCY_CONFIRMATION_FRAMES frames are counted.
+    * @return Number of confirmed tracked blobs
+    */
+    return num_people_in_view;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Movement histogram
+
+bool ThermalTracker::set_movement_histogram(int num_buckets, unsigned long bucket_width){
+    /**
+    * Also count movements into a ring of time buckets, so per-minute or per-hour rates can be read straight off the device.
+    * Each movement costs one bucket update. The buckets are allocated here, once; any previous histogram is dropped.
+    * Every processed frame also moves the histogram's clock along, so it keeps counting across the millis() wrap after 49.7 days.
+    * @param num_buckets Number of buckets to keep, such as 60 for an hour of minutes; 0 turns the histogram off
+    * @param bucket_width Length of time covered by each bucket, in ms
+    * @return True if the histogram has been set up, or turned off
+    */
+    if (num_buckets < 0 || bucket_width == 0) {
+        return false;
+    }
+
+    delete movement_histogram;
+    movement_histogram = NULL;
+
+    if (num_buckets > 0) {
+        movement_histogram = new MovementHistogram(num_buckets, bucket_width, NUM_DIRECTION_CATEGORIES);
+    }
+
+    return true;
+}
+
+void ThermalTracker::get_movement_bucket(int age, long _movements[NUM_DIRECTION_CATEGORIES]){
+    /**
+    * Get the movements counted in one time bucket, in the same order as get_movements.
+    * @param age Number of buckets back from the current one; 0 is the current, still filling, bucket
+    * @param _movements Output movement counts; all zero if there is no histogram or the bucket is empty
+    */
+    if (movement_histogram == NULL) {
+        for (int i = 0; i < NUM_DIRECTION_CATEGORIES; i++) {
+            _movements[i] = 0;
+        }
+        return;
+    }
+
+    movement_histogram->get_bucket(age, millis(), _movements);
+}
+
+void ThermalTracker::get_movement_rollup(int num_buckets, long _movements[NUM_DIRECTION_CATEGORIES]){
+    /**
+    * Get the movements counted over the most recent time buckets, in the same order as get_movements.
+    * @param num_buckets Number of buckets to add up, including the current one
+    * @param _movements Output movement counts; all zero if there is no histogram
+    */
+    if (movement_histogram == NULL) {
+        for (int i = 0; i < NUM_DIRECTION_CATEGORIES; i++) {
+            _movements[i] = 0;
+        }
+        return;
+    }
+
+    movement_histogram->get_rollup(num_buckets, millis(), _movements);
+}
+
+size_t ThermalTracker::get_movement_histogram_memory_usage(){
+    /**
+    * @return Number of bytes used by the movement histogram, or 0 if there isn't one
+    */
+    if (movement_histogram == NULL) {
+        return 0;
+    }
+
+    return movement_histogram->get_memory_usage();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame deadline
+
+void ThermalTracker::set_frame_deadline(unsigned long deadline){
+    /**
+    * Set the time budget for each call to process_frame.
+    * Frames that take longer are counted as misses. After DEADLINE_MISSES_TO_DEGRADE misses in a row the tracker steps down a
+    * degradation level, and after FRAMES_TO_RECOVER frames in a row within RECOVERY_HEADROOM of the deadline it steps back up.
+    * Only frames run through process_frame are timed; the pipelined executor isn't checked.
+    * @param deadline Budget in microseconds; FRAME_DEADLINE keeps up with REFRESH_RATE. 0 stops checking and goes back to full quality.
+    */
+    frame_deadline = deadline;
+    num_consecutive_misses = 0;
+    num_recovery_frames = 0;
+
+    if (frame_deadline == 0) {
+        set_degradation_level(FULL_QUALITY);
+    }
+}
+
+unsigned long ThermalTracker::get_frame_deadline(){
+    /**
+    * @return Time budget for each call to process_frame in microseconds, or 0 if frames aren't checked
+    */
+    return frame_deadline;
+}
+
+unsigned long ThermalTracker::get_last_frame_time(){
+    /**
+    * @return Time the last call to process_frame took, in microseconds
+    */
+    return last_frame_time;
+}
+
+long ThermalTracker::get_num_deadline_misses(){
+    /**
+    * Get the number of frames that took longer than the deadline, whether or not the tracker degraded because of them.
+    * @return Running count of missed deadlines
+    */
+    return num_deadline_misses;
+}
+
+int ThermalTracker::get_degradation_level(){
+    /**
+    * Get how much work is being skipped to keep up with the frame rate. Each level also skips the work of the ones before it.
+    * SKIP_BACKGROUND_UPDATE: tracked frames aren't added to the background, and exclusions aren't learnt. The mixture
+    * background only classifies them.
+    * CAP_BLOBS: detection stops at half of max_blobs, so matching has fewer pairs to compare. The dropped pixels count as overflows.
+    * COARSE_DETECTION: detection runs on the sensor grid instead of the upsampled one. Only reached when upsampling is on.
+    * @return The current level (degradation_levels); FULL_QUALITY when nothing is skipped
+    */
+    return degradation_level;
+}
+
+void ThermalTracker::check_deadline(unsigned long frame_time){
+    /**
+    * Count a missed deadline, and step the degradation level down under sustained overrun or back up once the load eases.
+    * Frames between the recovery headroom and the deadline hold the current level.
+    * @param frame_time Time the frame took to process, in microseconds
+    */
+    last_frame_time = frame_time;
+    if (frame_deadline == 0) {
+        return;
+    }
+
+    // Coarse detection would change nothing on the sensor grid, so it is skipped without upsampling
+    int lowest_level = upsampler != NULL ? COARSE_DETECTION : CAP_BLOBS;
+
+    if (frame_time > frame_deadline) {
+        num_deadline_misses++;
+        num_consecutive_misses++;
+        num_recovery_frames = 0;
+
+        if (num_consecutive_misses >= DEADLINE_MISSES_TO_DEGRADE && degradation_level < lowest_level) {
+            set_degradation_level(degradation_level + 1);
+            num_consecutive_misses = 0;
+        }
+    }
+    else if (frame_time < frame_deadline * RECOVERY_HEADROOM) {
+        num_consecutive_misses = 0;
+        num_recovery_frames++;
+
+        if (num_recovery_frames >= FRAMES_TO_RECOVER && degradation_level > FULL_QUALITY) {
+            set_degradation_level(degradation_level - 1);
+            num_recovery_frames = 0;
+        }
+    }
+    else{
+        num_consecutive_misses = 0;
+        num_recovery_frames = 0;
+    }
+}
+
+void ThermalTracker::set_degradation_level(int level){
+    /**
+    * Move to a degradation level, applying its blob cap.
+    * Moving on or off the upsampled grid changes the units of the tracked blobs, so they are rescaled onto the new grid
+    * and carry on being tracked.
+    * @param level New level (degradation_levels)
+    */
+    int previous_factor = get_upsampling_factor();
+
+    degradation_level = level;
+    blob_limit = max_blobs;
+    if (degradation_level >= CAP_BLOBS) {
+        blob_limit = max(1, max_blobs / 2);
+    }
+
+    if (get_upsampling_factor() != previous_factor) {
+        rescale_tracked_blobs(float(get_upsampling_factor()) / previous_factor);
+    }
+}
+
+void ThermalTracker::rescale_tracked_blobs(float scale){
+    /**
+    * Move all of the live tracked blobs onto a new detection grid, so a person isn't counted again when the grid changes.
+    * @param scale Number of pixels on the new grid per pixel on the old one, along each axis
+    */
+    for (int i = 0; i < max_blobs; i++) {
+        if (tracked_blobs[i].is_active()) {
+            tracked_blobs[i].rescale(scale);
+        }
+    }
+}
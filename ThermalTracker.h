@@ -1,6 +1,15 @@
+#ifndef THERMAL_TRACKER_H
+#define THERMAL_TRACKER_H
+
 #include "Pixel.h"
 #include "Blob.h"
 #include "TrackedBlob.h"
+#include "MixtureBackground.h"
+#include "SlidingWindowBackground.h"
+#include "FrameUpsampler.h"
+#include "DetectionPyramid.h"
+#include "CountingLines.h"
+#include "MovementHistogram.h"
 #include <Arduino.h>
 #include <Wire.h>
 #include <stdarg.h>
@@ -8,15 +17,32 @@
 const int MINIMUM_TRAVEL_THRESHOLD = 5;
 const int ADD_TO_BACKGROUND_DELAY = 20;
 const bool INVERT_TRAVEL_DIRECTION = false;
-const int FRAME_WIDTH = 16;
-const int FRAME_HEIGHT = 4;
+// The frame size build flags default in Pixel.h, next to the coordinate types they size
+const int FRAME_WIDTH = THERMAL_TRACKER_FRAME_WIDTH;
+const int FRAME_HEIGHT = THERMAL_TRACKER_FRAME_HEIGHT;
 const int MAX_BLOBS = 8;
 const int MINIMUM_BLOB_SIZE = 4;
 const int MAX_DISTANCE_THRESHOLD = 200;
+const float UNMATCHABLE_DISTANCE = 999;
 const int RUNNING_AVERAGE_SIZE = 80;
 const int REFRESH_RATE = 16;
 const int UNCHANGED_FRAME_DELAY = REFRESH_RATE * 2;
 const int NUM_DIRECTION_CATEGORIES = 5;
+const int DISTANCE_GRID_MAX_CELLS = 8;
+const float ACTIVATION_SIGMA = 3.0;
+const uint16_t BACKGROUND_SNAPSHOT_MAGIC = 0x5442;
+const uint8_t BACKGROUND_SNAPSHOT_VERSION = 1;
+const int BACKGROUND_SNAPSHOT_HEADER_SIZE = 12;
+const int RESTORE_VALIDATION_FRAMES = REFRESH_RATE / 2;
+const float RESTORE_CONSISTENCY_RATIO = 0.9;
+const int ARENA_ALIGNMENT = 8;
+const int OCCUPANCY_CONFIRMATION_FRAMES = REFRESH_RATE / 4;
+const int EXCLUSION_MASK_SIZE = (FRAME_WIDTH * FRAME_HEIGHT + 7) / 8;
+const float EXCLUSION_LEARNING_TRAVEL = 1.0;
+const unsigned long FRAME_DEADLINE = 1000000UL / REFRESH_RATE;
+const int DEADLINE_MISSES_TO_DEGRADE = 4;
+const int FRAMES_TO_RECOVER = REFRESH_RATE * 2;
+const float RECOVERY_HEADROOM = 0.5;
 
 enum directions {
     LEFT    = 0,
@@ -26,55 +52,212 @@ enum directions {
     NO_DIRECTION  = 4
 };
 
+enum background_models {
+    RUNNING_AVERAGE_BACKGROUND  = 0,
+    MIXTURE_BACKGROUND          = 1,
+    SLIDING_WINDOW_BACKGROUND   = 2
+};
+
+enum degradation_levels {
+    FULL_QUALITY            = 0,
+    SKIP_BACKGROUND_UPDATE  = 1,
+    CAP_BLOBS               = 2,
+    COARSE_DETECTION        = 3
+};
+
+enum bounds {
+    LOWER_BOUND = 0,
+    UPPER_BOUND = 1
+};
+
+enum calibration_terms {
+    PIXEL_OFFSET    = 0,
+    PIXEL_GAIN      = 1
+};
+
+struct FrameStats {
+    float min_temperature;  /**< Coldest pixel in the frame, in deg C*/
+    float max_temperature;  /**< Hottest pixel in the frame, in deg C*/
+    float mean_temperature; /**< Average pixel temperature of the frame, in deg C*/
+    int num_active_pixels;  /**< Number of pixels that stand out from the background; 0 while the background is being built*/
+};
+
 class ThermalTracker{
 public:
-    ThermalTracker(int _running_average_size = RUNNING_AVERAGE_SIZE, int _max_distance_threshold = MAX_DISTANCE_THRESHOLD, int _min_blob_size = MINIMUM_BLOB_SIZE);
+    ThermalTracker(int _running_average_size = RUNNING_AVERAGE_SIZE, int _max_distance_threshold = MAX_DISTANCE_THRESHOLD, int _min_blob_size = MINIMUM_BLOB_SIZE, float _activation_sigma = ACTIVATION_SIGMA, int _background_model = RUNNING_AVERAGE_BACKGROUND, int _max_blobs = MAX_BLOBS, uint8_t _arena[] = NULL);
+    ~ThermalTracker();
+    ThermalTracker(const ThermalTracker&) = delete;             // Owns its engines and arena, and points into itself
+    ThermalTracker& operator=(const ThermalTracker&) = delete;
     void reset_background();
     void process_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]);
+    void process_frame(const float frame_buffer[], int stride, bool column_major = false);
     bool finished_building_background();
     void get_averages(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]);
     void get_variances(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]);
     bool has_new_movements();
+    void get_movements(long _movements[NUM_DIRECTION_CATEGORIES]);
+    void set_early_commit(bool enabled);
+    bool get_early_commit();
+    void set_entry_direction(int direction);
+    void set_occupancy(int _occupancy);
+    int get_occupancy();
+    bool has_occupancy_changed();
+    int get_num_people_in_view();
+    bool set_movement_histogram(int num_buckets, unsigned long bucket_width);
+    void get_movement_bucket(int age, long _movements[NUM_DIRECTION_CATEGORIES]);
+    void get_movement_rollup(int num_buckets, long _movements[NUM_DIRECTION_CATEGORIES]);
+    size_t get_movement_histogram_memory_usage();
     int get_num_last_blobs();
+    size_t get_background_memory_usage();
+    size_t save_background(uint8_t buffer[], size_t buffer_size);
+    bool restore_background(const uint8_t buffer[], size_t buffer_size);
+    bool is_validating_background();
+    static size_t get_background_snapshot_size();
+    void set_position_gate(float gate);
+    long get_num_evaluated_pairs();
+    long get_num_pruned_pairs();
+    int get_max_blobs();
+    long get_num_blob_overflows();
+    long get_num_dropped_pixels();
+    static size_t get_arena_size(int max_blobs);
+    void set_pixel_calibration(float offsets[FRAME_HEIGHT][FRAME_WIDTH], float gains[FRAME_HEIGHT][FRAME_WIDTH]);
+    void clear_pixel_calibration();
+    FrameStats get_frame_stats();
+    bool set_upsampling_factor(int factor);
+    int get_upsampling_factor();
+    bool set_pyramid_factor(int factor);
+    int get_pyramid_factor();
+    void set_exclusion_mask(const uint8_t mask[EXCLUSION_MASK_SIZE]);
+    void get_exclusion_mask(uint8_t mask[EXCLUSION_MASK_SIZE]);
+    void clear_exclusion_mask();
+    int get_num_excluded_pixels();
+    void set_exclusion_learning(int frames);
+    int add_counting_line(float start_x, float start_y, float end_x, float end_y);
+    void clear_counting_lines();
+    long get_line_count(int line, int direction);
+    bool has_new_line_crossings();
+    void set_frame_deadline(unsigned long deadline);
+    unsigned long get_frame_deadline();
+    unsigned long get_last_frame_time();
+    long get_num_deadline_misses();
+    int get_degradation_level();
 
 private:     // Should be private, but left public for testing.
+    friend class PipelinedTracker;  // Runs the per-frame steps on separate threads on the host
+    friend class ThermalTrackerTest;    // Defined by the test sketch, host tests and benchmarks to reach the internals
     void load_frame(float frame_buffer[FRAME_HEIGHT][FRAME_WIDTH]);
+    void load_frame(const float frame_buffer[], int stride, bool column_major);
+    void load_sampled_frame(const float frame_buffer[], int row_step, int column_step);
+    void calibrate_block(const float frame_buffer[], int row_step, int column_step, int top, int left, int height, int width);
+    const float* get_row_major_frame();
+    int refine_regions();
+    bool check_background_activity(int num_blobs);
     void build_background();
+    void add_frame_to_background();
     void add_frame_to_to_running_background();
+    void update_activation_bounds();
+    bool validate_restored_background();
+    void add_frame_to_mixture_background();
+    void add_frame_to_sliding_window_background();
+    void exclude_pixel(int i, int j);
+    void learn_exclusions();
+    void check_deadline(unsigned long frame_time);
+    void set_degradation_level(int level);
+    void rescale_tracked_blobs(float scale);
 
-    void track_blobs(Blob new_blobs[MAX_BLOBS], TrackedBlob old_tracked_blobs[MAX_BLOBS]);
-    void update_tracked_blobs(Blob new_blobs[MAX_BLOBS], TrackedBlob old_tracked_blobs[MAX_BLOBS]);
-    void generate_distance_matrix(TrackedBlob tracked_blobs[MAX_BLOBS], Blob blobs[MAX_BLOBS],float output[MAX_BLOBS][MAX_BLOBS]);
-    float get_lowest_distance(float distance_matrix[MAX_BLOBS][MAX_BLOBS], int indexs[2]);
-    void remove_distance_row_col(int row, int col, float distance_matrix[MAX_BLOBS][MAX_BLOBS]);
+    void track_blobs(Blob new_blobs[], TrackedBlob old_tracked_blobs[]);
+    void update_tracked_blobs(Blob new_blobs[], TrackedBlob old_tracked_blobs[]);
+    void generate_distance_matrix(TrackedBlob tracked_blobs[], Blob blobs[], float output[]);
+    float get_lowest_distance(float distance_matrix[], int indexs[2]);
+    int get_matches(float distance_matrix[], int matches[][2]);
+    void remove_distance_row_col(int row, int col, float distance_matrix[]);
     void process_blob_movements(TrackedBlob blob);
+    void commit_blob_movements(TrackedBlob& blob);
+    void update_occupancy(int direction, TrackedBlob& blob);
+    void count_people_in_view();
+    void check_counting_lines(TrackedBlob& tracked_blob, Blob& blob);
     void add_movement(int direction);
-    void get_movements(long _movements[NUM_DIRECTION_CATEGORIES]);
     void reset_movements();
-    void sort_tracked_blobs(TrackedBlob tracked_blobs[MAX_BLOBS]);
-    void add_remaining_blobs_to_tracked(Blob new_blobs[MAX_BLOBS], TrackedBlob old_tracked_blobs[MAX_BLOBS]);
-    void clear_blobs(Blob blobs[MAX_BLOBS]);
+    void sort_tracked_blobs(TrackedBlob tracked_blobs[]);
+    void add_remaining_blobs_to_tracked(Blob new_blobs[], TrackedBlob old_tracked_blobs[]);
+    void clear_blobs(Blob blobs[]);
 
     int get_blobs(Blob blobs[]);
+    int label_blobs(Blob blobs[], const bool mask[], int width, int height, const float temperatures[], int row_step, int column_step, bool unlabelled[], pixel_index fill_queue[]);
+    int flood_fill(Blob& blob, int seed, bool unlabelled[], pixel_index fill_queue[], int width, int height, const float temperatures[], int row_step, int column_step);
     int get_active_pixels(Pixel pixel_buffer[]);
-    void remove_small_blobs(Blob blobs[MAX_BLOBS]);
-    int get_num_blobs(Blob blobs[MAX_BLOBS]);
-    int get_num_blobs(TrackedBlob blobs[MAX_BLOBS]);
-    int get_num_unassigned_blobs(Blob blobs[MAX_BLOBS]);
-    int get_num_updated_blobs(TrackedBlob tracked_blobs[MAX_BLOBS]);
+    void remove_small_blobs(Blob blobs[]);
+    int get_num_blobs(Blob blobs[]);
+    int get_num_blobs(TrackedBlob blobs[]);
+    int get_num_unassigned_blobs(Blob blobs[]);
+    int get_num_updated_blobs(TrackedBlob tracked_blobs[]);
 
-    TrackedBlob tracked_blobs[MAX_BLOBS]; /**<Blobs that are tracked between frames. Contains movement info*/
+    int max_blobs;  /**< Capacity of the blob and tracked blob pools; all blob scratch space is sized from this*/
+    uint8_t* owned_arena;   /**< Heap arena allocated when the caller doesn't provide one; NULL otherwise*/
+    TrackedBlob* tracked_blobs; /**<Blobs that are tracked between frames. Contains movement info*/
+    Blob* frame_blobs;  /**< Blobs detected in the current frame*/
+    float* distance_matrix; /**< Distances between every tracked blob/blob pair; max_blobs x max_blobs, row-major*/
+    int (*matches)[2];  /**< Matched (tracked blob, blob) index pairs*/
+    int* match_heap;    /**< Heap of candidate pairs used by get_matches; max_blobs x max_blobs*/
+    uint32_t* taken_flags;  /**< Bitsets of the tracked blobs, then blobs, that have been matched*/
+    int* blob_cells;    /**< Distance grid cell of each blob*/
+    int* sorted_blobs;  /**< Blob indexes in distance grid order*/
+    float* blob_features;   /**< Blob features packed in grid order; NUM_BLOB_FEATURES rows of max_blobs*/
+    float* blob_distances;  /**< Output of the distance kernel for one tracked blob*/
+    long num_blob_overflows;    /**< Number of frames that had more blobs than the blob pool could hold*/
+    long num_dropped_pixels;    /**< Number of active pixels left unlabelled because the blob pool was full*/
+    int blob_limit; /**< Number of blobs detection stops at; max_blobs unless capped by the degradation level*/
 
-    float frame[FRAME_HEIGHT][FRAME_WIDTH];     /**< Currently loaded frame; contains temperture information for each pixel*/
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];     /**< Staging buffer for frames that have to be copied (calibrated, or rearranged for a background engine)*/
+    const float* frame_data;    /**< Currently loaded frame; contains temperture information for each pixel. Points into the caller's buffer or at frame*/
+    int frame_row_step;     /**< Number of floats between vertically adjacent pixels in frame_data*/
+    int frame_column_step;  /**< Number of floats between horizontally adjacent pixels in frame_data*/
     float pixel_averages[FRAME_HEIGHT][FRAME_WIDTH];    /**< Background average of the previously loaded frames*/
     float pixel_variance[FRAME_HEIGHT][FRAME_WIDTH];    /**< Background variance of the previously loaded frames*/
+    bool foreground[FRAME_HEIGHT][FRAME_WIDTH];  /**< Pixels classified as foreground by the mixture background model*/
+    bool active_mask[FRAME_HEIGHT][FRAME_WIDTH];    /**< Pixels outside of the activation bounds, worked out as the frame is loaded*/
+    float (*pixel_calibration)[FRAME_HEIGHT][FRAME_WIDTH];  /**< Per-pixel offset and gain applied to incoming frames; NULL when not set*/
+    uint8_t exclusion_mask[EXCLUSION_MASK_SIZE];    /**< Pixels that are never active, packed row-major, least significant bit first; set bits are excluded*/
+    bool detection_mask[FRAME_HEIGHT][FRAME_WIDTH]; /**< Unpacked copy of the exclusion mask that is ANDed into the active pixels; false for excluded pixels*/
+    int num_excluded_pixels;    /**< Number of set bits in the exclusion mask*/
+    int exclusion_learning_frames;  /**< Number of frames a blob must stay put for before its pixels are excluded; 0 when learning is off*/
+    FrameStats frame_stats; /**< Summary of the currently loaded frame*/
+    float activation_bounds[2][FRAME_HEIGHT][FRAME_WIDTH];  /**< Lower and upper temperatures outside of which a pixel is active; refreshed when the background changes*/
 
     long movements[5];  /**< Array to keep track of the movements detected by the tracking script*/
     bool movement_changed_since_last_check; /**< Movement flag; True if movement has occurred since last check*/
+    int entry_direction;    /**< Direction people move in to enter the room being monitored; NO_DIRECTION if occupancy isn't kept*/
+    int occupancy;  /**< Number of people in the room; entries less exits*/
+    bool occupancy_changed_since_last_check;    /**< Occupancy flag; True if the occupancy has changed since last check*/
+    int num_people_in_view; /**< Number of confirmed tracked blobs in the current frame*/
+    MovementHistogram* movement_histogram;  /**< Ring of time buckets that movements are also counted into; only allocated when set*/
+    bool early_commit;  /**< True if movements are added as soon as a live tracked blob has travelled far enough, rather than when it dies*/
+    CountingLines* counting_lines;  /**< Virtual tripwires checked as the tracked blobs move; only allocated once a line is added*/
+    bool line_crossed_since_last_check; /**< Counting line flag; True if a line has been crossed since last check*/
     int running_average_size;   /**< The number of frames needed in the background average before detection can occur*/
     int num_background_frames;  /**< The current number of frames included in the background calculations*/
+    int num_validation_frames;  /**< The number of live frames left to check a restored background against before tracking resumes*/
     int max_distance_threshold; /**< The maximum distance between blobs where the blobs can be considered the same blob*/
+    float position_gate;    /**< The maximum centroid offset (x + y, in sensor pixels) between a tracked blob's reference position and a blob for the pair to be compared*/
+    long num_evaluated_pairs;   /**< Running count of tracked blob/blob pairs that had their distance calculated*/
+    long num_pruned_pairs;  /**< Running count of tracked blob/blob pairs skipped by the position gate*/
     int min_blob_size;  /**< The minimum number of pixels needed in a blob to avoid being cut at detection time*/
+    float activation_sigma; /**< The number of standard deviations a pixel must stray from the background to become active*/
+    int background_model;   /**< The background engine used to separate moving objects from the scene*/
+    MixtureBackground* mixture_background;  /**< Mixture-of-gaussians background; only allocated when selected as the background model*/
+    SlidingWindowBackground* sliding_window_background; /**< Exact sliding-window background; only allocated when selected as the background model*/
+    FrameUpsampler* upsampler;  /**< Interpolates frames for detection on a finer grid; only allocated when upsampling is on*/
+    DetectionPyramid* pyramid;  /**< Coarse detection level that limits full resolution detection to regions of interest; only allocated when the pyramid is on*/
+    bool* detection_unlabelled; /**< Labelling scratch for the upsampled grid or pyramid; pixels still waiting to be put in a blob*/
+    pixel_index* detection_queue;   /**< Labelling scratch for the upsampled grid or pyramid; flood fill queue*/
     int num_unchanged_frames;   /**< The number of consecutive frames where the number of blobs hasn't changed*/
     int num_last_blobs; /**< Number of blobs in the previously loaded frame*/
+    unsigned long frame_deadline;   /**< Time budget for each call to process_frame, in microseconds; 0 if frames aren't checked*/
+    unsigned long last_frame_time;  /**< Time the last call to process_frame took, in microseconds*/
+    long num_deadline_misses;   /**< Running count of frames that took longer than the deadline*/
+    int degradation_level;  /**< How much work is being skipped to keep up (degradation_levels)*/
+    int num_consecutive_misses; /**< Number of frames in a row that missed the deadline*/
+    int num_recovery_frames;    /**< Number of frames in a row that finished well inside the deadline*/
 };
+
+#endif
@@ -1,5 +1,8 @@
 #include "TrackedBlob.h"
 
+// Padded out to the alignment of the blob, which is a word unless its coordinate sums are 64 bit
+static_assert(sizeof(TrackedBlob) <= (sizeof(Blob) + 4 * sizeof(float) + sizeof(uint16_t) + sizeof(uint8_t) + alignof(Blob) - 1) / alignof(Blob) * alignof(Blob), "TrackedBlob has grown past its fields");
+
 float absolute(float f){
     if (f < 0.0){
         f *= -1.0;
@@ -34,7 +37,8 @@ void TrackedBlob::clear(){
     _predicted_position[Y] = -1;
     _travel[X] = 0;
     _travel[Y] = 0;
-    reset_updated_status();
+    _age = 0;
+    _flags = 0;
 }
 
 void TrackedBlob::set(Blob blob){
@@ -45,7 +49,8 @@ void TrackedBlob::set(Blob blob){
     */
     clear();
     copy_blob(blob);
-    _has_updated = true;
+    _age = 1;
+    _flags |= UPDATED_FLAG;
 }
 
 bool TrackedBlob::is_active(){
@@ -76,7 +81,10 @@ void TrackedBlob::update_blob(Blob blob){
 
         copy_blob(blob);
 
-        _has_updated = true;
+        if (_age < UINT16_MAX) {
+            _age++;
+        }
+        _flags |= UPDATED_FLAG;
 }
 
 bool TrackedBlob::has_updated(){
@@ -84,7 +92,7 @@ bool TrackedBlob::has_updated(){
     * Find out if the tracked blob has updated
     * @return True if the tracked blob has updated
     */
-    return _has_updated;
+    return _flags & UPDATED_FLAG;
 }
 
 void TrackedBlob::reset_updated_status(){
@@ -92,7 +100,7 @@ void TrackedBlob::reset_updated_status(){
     * Reset the updated status of the tracked blob.
     * Tracked blobs that have not updated will be purged at the end of frame processing.
     */
-    _has_updated = false;
+    _flags &= ~UPDATED_FLAG;
 }
 
 void TrackedBlob::copy(TrackedBlob tblob){
@@ -108,7 +116,8 @@ void TrackedBlob::copy(TrackedBlob tblob){
     _predicted_position[Y] = tblob._predicted_position[Y];
     _travel[Y] = tblob._travel[Y];
     _travel[X] = tblob._travel[X];
-    _has_updated = tblob.has_updated();
+    _age = tblob._age;
+    _flags = tblob._flags;
 }
 
 float TrackedBlob::get_travel(int axis){
@@ -129,26 +138,128 @@ float TrackedBlob::get_travel(int axis){
     return travel;
 }
 
-float TrackedBlob::get_distance(Blob other_blob){
+float TrackedBlob::get_reference_position(int axis){
+    /**
+    * Get the position that new blobs are compared against when calculating distances.
+    * This is the predicted position of the blob if a prediction has been made, or its current centroid if not.
+    * The choice is made as a blend rather than a branch so it can be used inside vectorised loops.
+    * @param axis The axis to get the position for
+    * @return Reference position of the tracked blob in the specified axis
+    */
+    float predicted = (_predicted_position[X] >= 0) & (_predicted_position[Y] >= 0);
+    return predicted * _predicted_position[axis] + (1 - predicted) * _blob.centroid[axis];
+}
+
+float TrackedBlob::get_position(int axis){
+    /**
+    * Get where the blob is now.
+    * @param axis The axis to get the position for
+    * @return Centroid of the blob in its latest frame in the specified axis
+    */
+    return _blob.centroid[axis];
+}
+
+int TrackedBlob::get_age(){
+    /**
+    * Get how long the blob has been tracked for.
+    * Stops counting at UINT16_MAX, about an hour at 16 Hz.
+    * @return Number of frames the blob has been seen in, including the one it was first found in
+    */
+    return _age;
+}
+
+void TrackedBlob::rescale(float scale){
+    /**
+    * Move the tracked blob onto a finer or coarser detection grid, keeping its track.
+    * Pixel centres line up between the grids, so a position p becomes (p + 0.5) * scale - 0.5. Travel and area scale with
+    * the grid; the age, committed movements, temperature and aspect ratio carry over unchanged.
+    * @param scale Number of pixels on the new grid per pixel on the old one, along each axis
+    */
+    // A blob with no prediction yet keeps none, and one with a prediction keeps it on the new grid
+    bool predicted = _predicted_position[X] >= 0 && _predicted_position[Y] >= 0;
+
+    for (int axis = 0; axis < 2; axis++) {
+        _blob.centroid[axis] = (_blob.centroid[axis] + 0.5) * scale - 0.5;
+        _blob.weighted_centroid[axis] = (_blob.weighted_centroid[axis] + 0.5) * scale - 0.5;
+        _blob.min[axis] = floorf(_blob.min[axis] * scale);
+        _blob.max[axis] = ceilf((_blob.max[axis] + 1) * scale) - 1;
+        _travel[axis] *= scale;
+
+        if (predicted) {
+            _predicted_position[axis] = max((_predicted_position[axis] + 0.5f) * scale - 0.5f, 0.0f);
+        }
+    }
+
+    _blob.width = _blob.max[X] - _blob.min[X] + 1;
+    _blob.height = _blob.max[Y] - _blob.min[Y] + 1;
+    _blob.num_pixels = max(int(_blob.num_pixels * scale * scale + 0.5), 1);
+}
+
+void TrackedBlob::commit(int axis){
+    /**
+    * Mark the blob's movement along an axis as already counted, so it isn't counted again when the blob dies.
+    * @param axis The axis the movement was counted on
+    */
+    _flags |= COMMITTED_Y_FLAG << axis;
+}
+
+bool TrackedBlob::is_committed(int axis){
+    /**
+    * Find out if the blob's movement along an axis has already been counted while it was still being tracked.
+    * @param axis The axis to check
+    * @return True if the movement has been counted
+    */
+    return _flags & (COMMITTED_Y_FLAG << axis);
+}
+
+void TrackedBlob::get_bounds(int min[2], int max[2]){
+    /**
+    * Get the bounding box of the blob in its latest frame.
+    * @param min Output minimum pixel coordinates of the blob; indexed by X and Y
+    * @param max Output maximum pixel coordinates of the blob; indexed by X and Y
+    */
+    min[X] = _blob.min[X];
+    min[Y] = _blob.min[Y];
+    max[X] = _blob.max[X];
+    max[Y] = _blob.max[Y];
+}
+
+void TrackedBlob::get_features(float features[NUM_BLOB_FEATURES]){
+    /**
+    * Get the characteristics of the tracked blob that are compared in get_distance.
+    * @param features Output array of the reference position, area, temperature and aspect ratio; indexed by blob_features
+    */
+    features[FEATURE_X] = get_reference_position(X);
+    features[FEATURE_Y] = get_reference_position(Y);
+    features[FEATURE_AREA] = _blob.num_pixels;
+    features[FEATURE_TEMPERATURE] = _blob.average_temperature;
+    features[FEATURE_ASPECT_RATIO] = _blob.aspect_ratio;
+}
+
+float TrackedBlob::get_distance(Blob other_blob, int upsampling_factor){
     /**
     * Find out how 'different' the tracked blob is from another blob; not just how far away the blob is...
     * A low distance score between blobs means they are very similar
     * This function is used on blobs between frames to determine if the blobs originate from the same object
+    * Positions and areas are compared in sensor pixels, so the score is the same whichever grid the blobs were found on.
     * @param other_blob The second blob in the calculations. The distance factor will be between this blob and the tracked blob.
+    * @param upsampling_factor Number of detection pixels per sensor pixel along each axis that the blobs were found with
     * @return The distance score between the two blobs. Unitless.
     */
     float difference_factor = 0.0;
+    float position_scale = 1.0 / upsampling_factor;
+    float area_scale = position_scale * position_scale;
 
     if (_predicted_position[X] >= 0 && _predicted_position[Y] >= 0){
-        difference_factor += absolute(_predicted_position[X] - other_blob.centroid[X]) * POSITION_PENALTY;
-        difference_factor += absolute(_predicted_position[Y] - other_blob.centroid[Y]) * POSITION_PENALTY;
+        difference_factor += absolute(_predicted_position[X] * position_scale - other_blob.centroid[X] * position_scale) * POSITION_PENALTY;
+        difference_factor += absolute(_predicted_position[Y] * position_scale - other_blob.centroid[Y] * position_scale) * POSITION_PENALTY;
     }
     else{
-        difference_factor += absolute(_blob.centroid[X] - other_blob.centroid[X]) * POSITION_PENALTY;
-        difference_factor += absolute(_blob.centroid[Y] - other_blob.centroid[Y]) * POSITION_PENALTY;
+        difference_factor += absolute(_blob.centroid[X] * position_scale - other_blob.centroid[X] * position_scale) * POSITION_PENALTY;
+        difference_factor += absolute(_blob.centroid[Y] * position_scale - other_blob.centroid[Y] * position_scale) * POSITION_PENALTY;
     }
 
-    difference_factor += absolute(_blob.num_pixels - other_blob.num_pixels) * AREA_PENALTY;
+    difference_factor += absolute(_blob.num_pixels * area_scale - other_blob.num_pixels * area_scale) * AREA_PENALTY;
 
     difference_factor += absolute(_blob.average_temperature - other_blob.average_temperature) * TEMPERATURE_PENALTY;
 
@@ -167,6 +278,8 @@ void TrackedBlob::copy_blob(Blob blob){
     */
     _blob.centroid[X] = blob.centroid[X];
     _blob.centroid[Y] = blob.centroid[Y];
+    _blob.weighted_centroid[X] = blob.weighted_centroid[X];
+    _blob.weighted_centroid[Y] = blob.weighted_centroid[Y];
     _blob.min[X] = blob.min[X];
     _blob.min[Y] = blob.min[Y];
     _blob.max[X] = blob.max[X];
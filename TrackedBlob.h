@@ -1,5 +1,5 @@
-// #ifndef TRACKED_BLOB_H
-// #define TRACKED_BLOB_H
+#ifndef TRACKED_BLOB_H
+#define TRACKED_BLOB_H
 
 #include "Pixel.h"
 #include "Blob.h"
@@ -9,6 +9,21 @@ const float AREA_PENALTY = 2.0;
 const float ASPECT_RATIO_PENALTY = 10.0;
 const float TEMPERATURE_PENALTY = 10.0;
 
+enum tracked_blob_flags {
+    UPDATED_FLAG        = 0x01,
+    COMMITTED_Y_FLAG    = 0x02,     // Shifted left by the axis, so COMMITTED_Y_FLAG << X is the X flag
+    COMMITTED_X_FLAG    = 0x04
+};
+
+enum blob_features {
+    FEATURE_X           = 0,
+    FEATURE_Y           = 1,
+    FEATURE_AREA        = 2,
+    FEATURE_TEMPERATURE = 3,
+    FEATURE_ASPECT_RATIO = 4,
+    NUM_BLOB_FEATURES   = 5
+};
+
 float absolute(float f);
 
 class TrackedBlob{
@@ -18,22 +33,32 @@ public:
     void set(Blob);
     void update_blob(Blob blob);
     float get_travel(int axis);
+    float get_reference_position(int axis);
+    float get_position(int axis);
+    int get_age();
+    void rescale(float scale);
+    void commit(int axis);
+    bool is_committed(int axis);
+    void get_bounds(int min[2], int max[2]);
+    void get_features(float features[NUM_BLOB_FEATURES]);
 
     void reset_updated_status();
     bool is_active();
     bool has_updated();
 
-    float get_distance(Blob other_blob);
+    float get_distance(Blob other_blob, int upsampling_factor = 1);
     void copy(TrackedBlob tblob);
 
 private:
+    friend class ThermalTrackerTest;    // Defined by the test sketch, host tests and benchmarks to reach the internals
     void copy_blob(Blob blob);
 
     Blob _blob;
     float _predicted_position[2];
     float _travel[2];
-    bool _has_updated;
+    uint16_t _age;  /**< Frames the blob has been seen in; stops counting at UINT16_MAX*/
+    uint8_t _flags; /**< tracked_blob_flags*/
 };
 
 
-// #endif
+#endif
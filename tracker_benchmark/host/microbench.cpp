@@ -0,0 +1,350 @@
+/**
+* Kernel microbenchmarks for the ThermalTracker library, for desktops and gateways.
+* Each tracker kernel is timed on its own over a grid of active pixel and blob counts, and the results are written as
+* CSV so runs can be compared across versions and machines.
+*
+* Build and run from the repository root:
+*   g++ -std=gnu++11 -O2 -pthread -Itracker_test/host -I. -include Arduino.h *.cpp tracker_benchmark/host/microbench.cpp -o microbench
+*   ./microbench > results.csv
+*
+* The frame size is fixed at build time, so sweep it with the frame size flags and append the runs:
+*   g++ ... -DTHERMAL_TRACKER_FRAME_WIDTH=32 -DTHERMAL_TRACKER_FRAME_HEIGHT=24 ... && ./microbench --no-header >> results.csv
+*
+* Options:
+*   --no-header         Don't print the CSV header
+*   --min-time <us>     Shortest time for each timed batch (default 20000)
+*
+* Columns:
+*   kernel, arch, frame_width, frame_height, active_pixels, num_blobs, calls, mean_ns, min_ns
+* active_pixels and num_blobs are measured from the generated frame; blobs smaller than the minimum blob size still count.
+* mean_ns is the mean time per call over every batch and min_ns is the mean time per call of the fastest batch.
+* Kernels that change their inputs have the inputs restored before every call; the time to restore them is measured
+* separately and subtracted.
+*/
+
+#include "ThermalTracker.h"
+#include <chrono>
+
+// The kernels are private, so the benchmarks are members of the test class the library's classes befriend
+class ThermalTrackerTest{
+public:
+    static bool set_up_scene(ThermalTracker& tracker, int num_active_pixels, int num_blobs);
+    static void restore_blobs();
+    static void restore_tracked_blobs();
+    static void restore_unupdated_tracked_blobs();
+    static void restore_running_background();
+    static void restore_background_build();
+    static void get_active_pixels_kernel();
+    static void get_blobs_kernel();
+    static void remove_small_blobs_kernel();
+    static void generate_distance_matrix_kernel();
+    static void update_tracked_blobs_kernel();
+    static void sort_tracked_blobs_kernel();
+    static void build_background_kernel();
+    static void add_frame_to_running_background_kernel();
+    static void benchmark_scene();
+};
+
+const int MAX_BENCHMARK_BLOBS = 32;
+const int NUM_BATCHES = 5;
+const long DEFAULT_MIN_BATCH_TIME = 20000;
+const float BACKGROUND_TEMPERATURE = 20.0;
+const float BACKGROUND_NOISE = 0.1;
+const float BLOB_TEMPERATURE = 30.0;
+const int NUM_ACTIVE_FRACTIONS = 5;
+const float ACTIVE_FRACTIONS[NUM_ACTIVE_FRACTIONS] = {0, 0.0625, 0.125, 0.25, 0.5};
+const int NUM_BLOB_COUNTS = 6;
+const int BLOB_COUNTS[NUM_BLOB_COUNTS] = {1, 2, 4, 8, 16, 32};
+
+#if defined(__x86_64__)
+const char* ARCH = "x86_64";
+#elif defined(__aarch64__)
+const char* ARCH = "aarch64";
+#elif defined(__arm__)
+const char* ARCH = "arm";
+#else
+const char* ARCH = "unknown";
+#endif
+
+typedef void (*BenchmarkStep)();
+
+struct BenchmarkScene {
+    ThermalTracker* tracker;    /**< Tracker with a built background and the scene's frame loaded*/
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];     /**< Frame with the requested blobs in it*/
+    float previous_frame[FRAME_HEIGHT][FRAME_WIDTH];    /**< Same blobs, one column to the left; gives the tracked blobs*/
+    Blob blobs[MAX_BENCHMARK_BLOBS];    /**< Blobs in the frame, before small ones are removed*/
+    Blob working_blobs[MAX_BENCHMARK_BLOBS];    /**< Copy of the blobs for the kernels that change them*/
+    TrackedBlob tracked_blobs[MAX_BENCHMARK_BLOBS]; /**< Tracked blobs from the previous frame*/
+    TrackedBlob working_tracked_blobs[MAX_BENCHMARK_BLOBS]; /**< Copy of the tracked blobs for the kernels that change them*/
+    Pixel pixels[FRAME_WIDTH * FRAME_HEIGHT];   /**< Output of get_active_pixels*/
+    float distance_matrix[MAX_BENCHMARK_BLOBS * MAX_BENCHMARK_BLOBS];  /**< Output of generate_distance_matrix*/
+    float pixel_averages[FRAME_HEIGHT][FRAME_WIDTH];    /**< Background averages when the scene was set up*/
+    float pixel_variance[FRAME_HEIGHT][FRAME_WIDTH];    /**< Background variances when the scene was set up*/
+    int num_active_pixels;  /**< Active pixels in the frame*/
+    int num_blobs;  /**< Blobs in the frame*/
+};
+
+BenchmarkScene scene;
+long min_batch_time = DEFAULT_MIN_BATCH_TIME;
+
+////////////////////////////////////////////////////////////////////////////////
+// Scenes
+
+void fill_blob_frame(float frame[FRAME_HEIGHT][FRAME_WIDTH], int num_active_pixels, int num_blobs, int shift){
+    /**
+    * Fill a frame with separate blobs that share out the active pixels.
+    * Each blob gets its own strip of columns, with a free column between strips so neighbouring blobs never touch.
+    * Blobs fill their strip column by column, top to bottom.
+    * @param frame Output frame
+    * @param num_active_pixels Total number of pixels to put in the blobs
+    * @param num_blobs Number of blobs
+    * @param shift Number of columns to move every blob to the right by
+    */
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = BACKGROUND_TEMPERATURE;
+        }
+    }
+
+    if (num_blobs == 0) {
+        return;
+    }
+
+    int strip_width = FRAME_WIDTH / num_blobs;
+    for (int blob = 0; blob < num_blobs; blob++) {
+        int blob_pixels = num_active_pixels / num_blobs + (blob < num_active_pixels % num_blobs);
+        int first_column = blob * strip_width + shift;
+        for (int pixel = 0; pixel < blob_pixels; pixel++) {
+            int column = first_column + pixel / FRAME_HEIGHT;
+            if (column < FRAME_WIDTH && column < first_column + strip_width - 1) {
+                frame[pixel % FRAME_HEIGHT][column] = BLOB_TEMPERATURE;
+            }
+        }
+    }
+}
+
+void build_noisy_background(ThermalTracker& tracker){
+    /**
+    * Build a background that alternates a little either side of the room temperature, so it has some variance.
+    * Pixels at exactly room temperature are then inactive, and the blobs are the only active pixels.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    tracker.reset_background();
+    for (int f = 0; !tracker.finished_building_background(); f++) {
+        for (int i = 0; i < FRAME_HEIGHT; i++) {
+            for (int j = 0; j < FRAME_WIDTH; j++) {
+                frame[i][j] = BACKGROUND_TEMPERATURE + ((f + i + j) % 2 == 0 ? BACKGROUND_NOISE : -BACKGROUND_NOISE);
+            }
+        }
+        tracker.process_frame(frame);
+    }
+}
+
+bool ThermalTrackerTest::set_up_scene(ThermalTracker& tracker, int num_active_pixels, int num_blobs){
+    /**
+    * Generate the scene for one point on the grid and get every kernel's inputs ready.
+    * @param tracker Tracker with a built background
+    * @param num_active_pixels Requested number of active pixels
+    * @param num_blobs Requested number of blobs
+    * @return False if the blobs don't fit in the frame
+    */
+    if (num_blobs > 0 && (FRAME_WIDTH / num_blobs < 2 || num_active_pixels < num_blobs)) {
+        return false;
+    }
+
+    // The background kernels of the last scene will have learnt its blobs
+    build_noisy_background(tracker);
+
+    scene.tracker = &tracker;
+    fill_blob_frame(scene.previous_frame, num_active_pixels, num_blobs, 0);
+    fill_blob_frame(scene.frame, num_active_pixels, num_blobs, num_blobs > 0 && FRAME_WIDTH / num_blobs > 2);
+
+    // Track the previous frame so the tracked blobs line up with the frame's blobs
+    tracker.reset_movements();
+    for (int b = 0; b < tracker.get_max_blobs(); b++) {
+        scene.tracked_blobs[b].clear();
+    }
+    tracker.load_frame(scene.previous_frame);
+    tracker.get_blobs(scene.blobs);
+    tracker.track_blobs(scene.blobs, scene.tracked_blobs);
+
+    tracker.load_frame(scene.frame);
+    tracker.get_blobs(scene.blobs);
+    scene.num_active_pixels = tracker.get_frame_stats().num_active_pixels;
+    scene.num_blobs = tracker.get_num_blobs(scene.blobs);
+    memcpy(scene.pixel_averages, tracker.pixel_averages, sizeof(scene.pixel_averages));
+    memcpy(scene.pixel_variance, tracker.pixel_variance, sizeof(scene.pixel_variance));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernels
+
+void ThermalTrackerTest::restore_blobs(){
+    for (int b = 0; b < scene.tracker->get_max_blobs(); b++) {
+        scene.working_blobs[b] = scene.blobs[b];
+    }
+}
+
+void ThermalTrackerTest::restore_tracked_blobs(){
+    for (int b = 0; b < scene.tracker->get_max_blobs(); b++) {
+        scene.working_blobs[b] = scene.blobs[b];
+        scene.working_tracked_blobs[b] = scene.tracked_blobs[b];
+    }
+}
+
+void ThermalTrackerTest::restore_unupdated_tracked_blobs(){
+    /**
+    * Every other tracked blob wasn't matched this frame, so sorting has half of them to remove.
+    */
+    for (int b = 0; b < scene.tracker->get_max_blobs(); b++) {
+        scene.working_tracked_blobs[b] = scene.tracked_blobs[b];
+        if (b % 2 == 1) {
+            scene.working_tracked_blobs[b].reset_updated_status();
+        }
+    }
+}
+
+void ThermalTrackerTest::restore_running_background(){
+    // Adding the same frame over and over decays the variances into denormals, which no live sensor would ever do
+    memcpy(scene.tracker->pixel_averages, scene.pixel_averages, sizeof(scene.pixel_averages));
+    memcpy(scene.tracker->pixel_variance, scene.pixel_variance, sizeof(scene.pixel_variance));
+}
+
+void ThermalTrackerTest::restore_background_build(){
+    // Keeps the build going without ever finishing, so the once-per-background bounds calculation isn't included
+    scene.tracker->num_background_frames = 1;
+}
+
+void ThermalTrackerTest::get_active_pixels_kernel(){
+    scene.tracker->get_active_pixels(scene.pixels);
+}
+
+void ThermalTrackerTest::get_blobs_kernel(){
+    scene.tracker->get_blobs(scene.working_blobs);
+}
+
+void ThermalTrackerTest::remove_small_blobs_kernel(){
+    scene.tracker->remove_small_blobs(scene.working_blobs);
+}
+
+void ThermalTrackerTest::generate_distance_matrix_kernel(){
+    scene.tracker->generate_distance_matrix(scene.tracked_blobs, scene.blobs, scene.distance_matrix);
+}
+
+void ThermalTrackerTest::update_tracked_blobs_kernel(){
+    scene.tracker->update_tracked_blobs(scene.working_blobs, scene.working_tracked_blobs);
+}
+
+void ThermalTrackerTest::sort_tracked_blobs_kernel(){
+    scene.tracker->sort_tracked_blobs(scene.working_tracked_blobs);
+}
+
+void ThermalTrackerTest::build_background_kernel(){
+    scene.tracker->build_background();
+}
+
+void ThermalTrackerTest::add_frame_to_running_background_kernel(){
+    scene.tracker->add_frame_to_to_running_background();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Timing
+
+double time_calls(BenchmarkStep restore, BenchmarkStep kernel, long calls){
+    /**
+    * @return Time taken by a number of calls, in ns
+    */
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long call = 0; call < calls; call++) {
+        if (restore != NULL) {
+            restore();
+        }
+        if (kernel != NULL) {
+            kernel();
+        }
+    }
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark_kernel(const char* name, BenchmarkStep restore, BenchmarkStep kernel){
+    /**
+    * Time a kernel on the current scene and print a CSV row.
+    * The number of calls per batch is doubled until a batch takes at least min_batch_time.
+    * @param name Name of the kernel
+    * @param restore Step that puts the kernel's inputs back before every call; NULL if the kernel leaves them as they were
+    * @param kernel Step that runs the kernel
+    */
+    long calls = 1;
+    while (time_calls(restore, kernel, calls) < min_batch_time * 1000.0 && calls < (1L << 30)) {
+        calls *= 2;
+    }
+
+    double total_time = 0;
+    double min_time = 0;
+    for (int batch = 0; batch < NUM_BATCHES; batch++) {
+        double batch_time = time_calls(restore, kernel, calls);
+        if (restore != NULL) {
+            batch_time = max(batch_time - time_calls(restore, NULL, calls), 0.0);
+        }
+
+        total_time += batch_time;
+        min_time = batch == 0 ? batch_time : min(min_time, batch_time);
+    }
+
+    printf("%s,%s,%d,%d,%d,%d,%ld,%.1f,%.1f\n", name, ARCH, FRAME_WIDTH, FRAME_HEIGHT, scene.num_active_pixels, scene.num_blobs,
+           calls * NUM_BATCHES, total_time / (calls * NUM_BATCHES), min_time / calls);
+}
+
+void ThermalTrackerTest::benchmark_scene(){
+    /**
+    * Time every kernel on the current scene.
+    */
+    benchmark_kernel("get_active_pixels", NULL, get_active_pixels_kernel);
+    benchmark_kernel("get_blobs", NULL, get_blobs_kernel);
+    benchmark_kernel("remove_small_blobs", restore_blobs, remove_small_blobs_kernel);
+    benchmark_kernel("generate_distance_matrix", NULL, generate_distance_matrix_kernel);
+    benchmark_kernel("update_tracked_blobs", restore_tracked_blobs, update_tracked_blobs_kernel);
+    benchmark_kernel("sort_tracked_blobs", restore_unupdated_tracked_blobs, sort_tracked_blobs_kernel);
+
+    // The background kernels work on the loaded frame, whatever is in it
+    benchmark_kernel("add_frame_to_to_running_background", restore_running_background, add_frame_to_running_background_kernel);
+    benchmark_kernel("build_background", restore_background_build, build_background_kernel);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Main
+
+int main(int argc, char* argv[]){
+    bool header = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-header") == 0) {
+            header = false;
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_batch_time = max(atol(argv[++i]), 1L);
+        }
+    }
+
+    if (header) {
+        printf("kernel,arch,frame_width,frame_height,active_pixels,num_blobs,calls,mean_ns,min_ns\n");
+    }
+
+    ThermalTracker tracker(RUNNING_AVERAGE_SIZE, MAX_DISTANCE_THRESHOLD, MINIMUM_BLOB_SIZE, ACTIVATION_SIGMA, RUNNING_AVERAGE_BACKGROUND, MAX_BENCHMARK_BLOBS);
+
+    if (ThermalTrackerTest::set_up_scene(tracker, 0, 0)) {
+        ThermalTrackerTest::benchmark_scene();
+    }
+
+    for (int a = 1; a < NUM_ACTIVE_FRACTIONS; a++) {
+        int num_active_pixels = int(ACTIVE_FRACTIONS[a] * FRAME_WIDTH * FRAME_HEIGHT);
+        for (int b = 0; b < NUM_BLOB_COUNTS; b++) {
+            if (ThermalTrackerTest::set_up_scene(tracker, num_active_pixels, BLOB_COUNTS[b])) {
+                ThermalTrackerTest::benchmark_scene();
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,529 @@
+#include <Arduino.h>
+#include "ThermalTracker.h"
+#include "MLX90621Converter.h"
+#include "Logging.h"
+
+const long SERIAL_BAUD = 115200;
+const int LOGGER_LEVEL = LOG_LEVEL_DEBUG;
+const int NUM_ITERATIONS = 100;
+const int RECORDING_LENGTH = 600;
+const int BACKGROUND_FRAMES = 80;
+const int PYRAMID_FACTOR = 4;
+const int PYRAMID_BLOB_SIZE = 4;
+
+void conversion_benchmark();
+void background_model_benchmark();
+void sliding_window_memory_report();
+void upsampling_benchmark();
+void pyramid_benchmark();
+void counting_line_benchmark();
+void early_commit_benchmark();
+void deadline_benchmark();
+
+uint8_t sample_eeprom[MLX90621_EEPROM_SIZE];
+int16_t sample_ir_data[MLX90621_NUM_PIXELS];
+const int16_t SAMPLE_COMPENSATION_PIXEL = -20;
+const float SAMPLE_AMBIENT_TEMPERATURE = 25.0;
+
+////////////////////////////////////////////////////////////////////////////////
+// Main
+void setup(){
+
+    Log.Init(LOGGER_LEVEL, SERIAL_BAUD);
+    conversion_benchmark();
+    background_model_benchmark();
+    sliding_window_memory_report();
+    upsampling_benchmark();
+    pyramid_benchmark();
+    counting_line_benchmark();
+    early_commit_benchmark();
+    deadline_benchmark();
+}
+
+void loop(){
+    Log.Info("\t==================================================\n\t\tBenchmarks finished.\n\t\t==================================================\n\n");
+    delay(5000);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sample data
+
+void fill_sample_eeprom(){
+    /**
+    * Fill the EEPROM image with plausible calibration values.
+    * Replace this with a real dump from a sensor to benchmark against its calibration.
+    */
+    for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+        sample_eeprom[CAL_A_I_START + i] = 20 + (i * 7) % 40;
+        sample_eeprom[CAL_B_I_START + i] = (i * 3) % 16;
+        sample_eeprom[CAL_DELTA_ALPHA_START + i] = 100 + (i * 5) % 100;
+    }
+
+    sample_eeprom[CAL_ACOMMON_L] = 0xCE;    // -50
+    sample_eeprom[CAL_ACOMMON_H] = 0xFF;
+    sample_eeprom[CAL_KT_SCALE] = 0x8B;
+    sample_eeprom[CAL_ACP_L] = 0xD0;        // -48
+    sample_eeprom[CAL_ACP_H] = 0xFF;
+    sample_eeprom[CAL_BCP] = 0x04;
+    sample_eeprom[CAL_ALPHA_CP_L] = 0x00;
+    sample_eeprom[CAL_ALPHA_CP_H] = 0x10;
+    sample_eeprom[CAL_TGC] = 0x08;
+    sample_eeprom[CAL_AI_BI_SCALE] = 0x00;
+    sample_eeprom[CAL_VTH_L] = 0x00;
+    sample_eeprom[CAL_VTH_H] = 0x64;
+    sample_eeprom[CAL_KT1_L] = 0x00;
+    sample_eeprom[CAL_KT1_H] = 0x55;
+    sample_eeprom[CAL_KT2_L] = 0x00;
+    sample_eeprom[CAL_KT2_H] = 0x58;
+    sample_eeprom[CAL_A0_L] = 0x00;
+    sample_eeprom[CAL_A0_H] = 0x6A;
+    sample_eeprom[CAL_A0_SCALE] = 40;
+    sample_eeprom[CAL_DELTA_A_SCALE] = 46;
+    sample_eeprom[CAL_EMIS_L] = 0x00;
+    sample_eeprom[CAL_EMIS_H] = 0x80;
+    sample_eeprom[CAL_KSTA_L] = 0x00;
+    sample_eeprom[CAL_KSTA_H] = 0x00;
+
+    for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+        sample_ir_data[i] = 10 + (i * 13) % 60;
+    }
+}
+
+void fill_recorded_frame(int index, float frame[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Get a frame from the benchmark recording.
+    * The recording is a stand-in for a real capture: a 20 deg C room with sensor noise.
+    * Once the background has been built, a person walks across the view every 100 frames and a vent starts toggling every 30 frames.
+    * @param index Frame number in the recording
+    * @param frame A 2D array to write the frame into
+    */
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = 20.0 + ((index * 31 + i * 17 + j * 7) % 11) * 0.02;
+        }
+    }
+
+    // HVAC vent in the corner
+    if (index >= 150 && (index / 30) % 2 == 1) {
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 3; j++) {
+                frame[i][j] += 3.0;
+            }
+        }
+    }
+
+    // Person walking left to right
+    int step = index % 100;
+    if (index >= 100 && step < FRAME_WIDTH * 2) {
+        int column = step / 2;
+        for (int i = 0; i < FRAME_HEIGHT; i++) {
+            for (int j = column - 1; j <= column + 1; j++) {
+                if (j >= 0 && j < FRAME_WIDTH) {
+                    frame[i][j] = 30.0;
+                }
+            }
+        }
+    }
+}
+
+void fill_vertical_frame(int index, float frame[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Get a frame of a person walking up or down through the view, across the sensor's short axis.
+    * The person is rendered as a soft warm spot so that their position varies smoothly between pixels.
+    * @param index Frame number in the recording
+    * @param frame A 2D array to write the frame into
+    */
+    int step = index % 50;
+    float centre_y = -1.5 + step * 0.15;
+    if ((index / 50) % 2 == 1) {
+        centre_y = FRAME_HEIGHT + 0.5 - step * 0.15;
+    }
+    float centre_x = 4 + (index / 100) % 8;
+
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            float offset_x = j - centre_x;
+            float offset_y = i - centre_y;
+            frame[i][j] = 20.0 + ((index * 31 + i * 17 + j * 7) % 11) * 0.02;
+
+            if (index >= BACKGROUND_FRAMES && step < 42) {
+                frame[i][j] += 8.0 * expf(-(offset_x * offset_x + offset_y * offset_y) / 1.5);
+            }
+        }
+    }
+}
+
+void fill_doorway_frame(int index, float frame[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Get a frame of a person who walks in from the left, stops in the middle of the view for a second, then walks out to the right.
+    * The stop is kept shorter than UNCHANGED_FRAME_DELAY so that the person isn't absorbed into the background.
+    * @param index Frame number in the recording
+    * @param frame A 2D array to write the frame into
+    */
+    const int walk_frames = FRAME_WIDTH;
+    const int stand_frames = REFRESH_RATE;
+    int step = (index - BACKGROUND_FRAMES) % (2 * walk_frames + stand_frames + REFRESH_RATE);
+
+    float column = -2 + min(step, walk_frames) * 0.5;
+    if (step > walk_frames + stand_frames) {
+        column += (step - walk_frames - stand_frames) * 0.5;
+    }
+
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = 20.0 + ((index * 31 + i * 17 + j * 7) % 11) * 0.02;
+
+            if (index >= BACKGROUND_FRAMES && step < 2 * walk_frames + stand_frames && absolute(j - column) < 1.5) {
+                frame[i][j] = 30.0;
+            }
+        }
+    }
+}
+
+void fill_crowd_frame(int index, int num_people, float frame[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * Get a frame with a number of people spread evenly across the view, all drifting to the right.
+    * Each person is a PYRAMID_BLOB_SIZE square, clipped to the frame.
+    * @param index Frame number in the recording
+    * @param num_people Number of people in view once the background has been built
+    * @param frame A 2D array to write the frame into
+    */
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = 20.0 + ((index * 31 + i * 17 + j * 7) % 11) * 0.02;
+        }
+    }
+
+    if (index < BACKGROUND_FRAMES) {
+        return;
+    }
+
+    // Lay the people out on a grid with a gap between them
+    int spacing = PYRAMID_BLOB_SIZE * 2;
+    int people_per_row = max(FRAME_WIDTH / spacing, 1);
+    for (int p = 0; p < num_people; p++) {
+        int top = (p / people_per_row) * spacing % FRAME_HEIGHT;
+        int left = ((p % people_per_row) * spacing + index / 4) % FRAME_WIDTH;
+
+        for (int i = top; i < min(top + PYRAMID_BLOB_SIZE, FRAME_HEIGHT); i++) {
+            for (int j = left; j < min(left + PYRAMID_BLOB_SIZE, FRAME_WIDTH); j++) {
+                frame[i][j] = 30.0;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+void conversion_benchmark(){
+    /**
+    * Compare the precomputed raw-to-temperature conversion against the step-by-step datasheet reference.
+    */
+    MLX90621Converter converter;
+    float reference_frame[MLX90621_NUM_ROWS][MLX90621_NUM_COLS];
+    float converted_frame[MLX90621_NUM_ROWS][MLX90621_NUM_COLS];
+    Log.Info("Raw conversion benchmark");
+
+    fill_sample_eeprom();
+    converter.load_calibration(sample_eeprom);
+    converter.set_ambient_temperature(SAMPLE_AMBIENT_TEMPERATURE);
+
+    unsigned long start = micros();
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        MLX90621Converter::convert_frame_reference(sample_eeprom, MLX90621_DEFAULT_RESOLUTION, SAMPLE_AMBIENT_TEMPERATURE, sample_ir_data, SAMPLE_COMPENSATION_PIXEL, reference_frame);
+    }
+    unsigned long reference_time = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        converter.convert_frame(sample_ir_data, SAMPLE_COMPENSATION_PIXEL, converted_frame);
+    }
+    unsigned long converted_time = micros() - start;
+
+    float worst_error = 0;
+    for (int i = 0; i < MLX90621_NUM_ROWS; i++) {
+        for (int j = 0; j < MLX90621_NUM_COLS; j++) {
+            float error = absolute(reference_frame[i][j] - converted_frame[i][j]);
+            if (error > worst_error) {
+                worst_error = error;
+            }
+        }
+    }
+
+    Log.Debug("Reference: %l us/frame", long(reference_time / NUM_ITERATIONS));
+    Log.Debug("Precomputed: %l us/frame", long(converted_time / NUM_ITERATIONS));
+    Log.Info("Raw conversion benchmark: worst error %d mC\n\n", int(worst_error * 1000));
+}
+
+void time_background_model(int background_model, const char* name){
+    /**
+    * Replay the recording through a tracker using the given background model.
+    * @param background_model Background engine to benchmark
+    * @param name Name of the background engine for the log
+    */
+    ThermalTracker tracker(BACKGROUND_FRAMES, MAX_DISTANCE_THRESHOLD, MINIMUM_BLOB_SIZE, ACTIVATION_SIGMA, background_model);
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    unsigned long total_time = 0;
+    int frames_with_blobs = 0;
+
+    for (int i = 0; i < RECORDING_LENGTH; i++) {
+        fill_recorded_frame(i, frame);
+
+        unsigned long start = micros();
+        tracker.process_frame(frame);
+        total_time += micros() - start;
+
+        if (tracker.finished_building_background() && tracker.get_num_last_blobs() > 0) {
+            frames_with_blobs++;
+        }
+    }
+
+    Log.Debug("%s: %l us/frame, %d frames with blobs", name, long(total_time / RECORDING_LENGTH), frames_with_blobs);
+}
+
+void background_model_benchmark(){
+    /**
+    * Compare the per-frame cost of the background models over the same recording.
+    * Frames with blobs are reported alongside; the person is only in view for 32 of every 100 frames.
+    */
+    Log.Info("Background model benchmark");
+    time_background_model(RUNNING_AVERAGE_BACKGROUND, "Running average");
+    time_background_model(MIXTURE_BACKGROUND, "Mixture of gaussians");
+    time_background_model(SLIDING_WINDOW_BACKGROUND, "Sliding window");
+    Log.Info("Background model benchmark finished\n\n");
+}
+
+void sliding_window_memory_report(){
+    /**
+    * Report how much memory the sliding window background needs for a range of window lengths.
+    */
+    const int window_lengths[] = {16, 32, 48, 80, 160, 320};
+    Log.Info("Sliding window memory report");
+
+    for (unsigned int i = 0; i < sizeof(window_lengths) / sizeof(window_lengths[0]); i++) {
+        long usage = SlidingWindowBackground::get_memory_usage(FRAME_WIDTH * FRAME_HEIGHT, window_lengths[i]);
+        Log.Debug("Window of %d frames: %l bytes", window_lengths[i], usage);
+    }
+
+    Log.Info("Sliding window memory report finished\n\n");
+}
+
+void upsampling_benchmark(){
+    /**
+    * Measure the per-frame cost of detecting on an upsampled grid, for each upsampling factor.
+    * Only frames processed after the background has been built are timed.
+    */
+    const int factors[] = {1, 2, 4};
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    Log.Info("Upsampling benchmark");
+
+    for (unsigned int f = 0; f < sizeof(factors) / sizeof(factors[0]); f++) {
+        ThermalTracker tracker(BACKGROUND_FRAMES);
+        tracker.set_upsampling_factor(factors[f]);
+        tracker.set_frame_deadline(0);  // Time every frame at full quality
+        unsigned long total_time = 0;
+
+        for (int i = 0; i < RECORDING_LENGTH; i++) {
+            fill_vertical_frame(i, frame);
+            bool timed = tracker.finished_building_background();
+
+            unsigned long start = micros();
+            tracker.process_frame(frame);
+            if (timed) {
+                total_time += micros() - start;
+            }
+        }
+
+        Log.Debug("%dx: %l us/frame", factors[f], long(total_time / (RECORDING_LENGTH - BACKGROUND_FRAMES)));
+    }
+
+    Log.Info("Upsampling benchmark finished\n\n");
+}
+
+long time_crowd(int num_people, int pyramid_factor){
+    /**
+    * Time the tracker over a crowd recording, not counting the frames used to build the background.
+    * @param num_people Number of people in view
+    * @param pyramid_factor Pyramid cell size to use; 1 for full resolution detection
+    * @return Average processing time in us/frame
+    */
+    const int num_timed_frames = 50;
+    ThermalTracker tracker(BACKGROUND_FRAMES);
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    unsigned long total_time = 0;
+    tracker.set_pyramid_factor(pyramid_factor);
+    tracker.set_frame_deadline(0);  // Time every frame at full quality
+
+    for (int i = 0; i < BACKGROUND_FRAMES + num_timed_frames; i++) {
+        fill_crowd_frame(i, num_people, frame);
+        bool timed = tracker.finished_building_background();
+
+        unsigned long start = micros();
+        tracker.process_frame(frame);
+        if (timed) {
+            total_time += micros() - start;
+        }
+    }
+
+    return total_time / num_timed_frames;
+}
+
+void pyramid_benchmark(){
+    /**
+    * Compare full resolution detection against coarse-to-fine pyramid detection as more of the view is covered by people.
+    * The pyramid pays off on large sensors; build with THERMAL_TRACKER_FRAME_WIDTH/HEIGHT set to try one.
+    */
+    const int active_percentages[] = {0, 1, 5, 10, 25, 50};
+    int person_area = PYRAMID_BLOB_SIZE * PYRAMID_BLOB_SIZE;
+    Log.Info("Pyramid benchmark (%dx%d frame, %dx%d cells)", FRAME_WIDTH, FRAME_HEIGHT, PYRAMID_FACTOR, PYRAMID_FACTOR);
+
+    for (unsigned int a = 0; a < sizeof(active_percentages) / sizeof(active_percentages[0]); a++) {
+        int num_people = (long(FRAME_WIDTH) * FRAME_HEIGHT * active_percentages[a] / 100 + person_area - 1) / person_area;
+        long full_time = time_crowd(num_people, 1);
+        long pyramid_time = time_crowd(num_people, PYRAMID_FACTOR);
+        Log.Debug("%d%% active (%d people): %l us/frame full, %l us/frame pyramid", active_percentages[a], num_people, full_time, pyramid_time);
+    }
+
+    Log.Info("Pyramid benchmark finished\n\n");
+}
+
+void counting_line_benchmark(){
+    /**
+    * Measure the cost of checking tracked blobs against counting lines.
+    * The worst case per frame is a full pool of tracked blobs each checked against MAX_COUNTING_LINES lines.
+    * The recording is also run with no lines and with the most lines, to show the cost within a whole frame.
+    */
+    CountingLines lines;
+    float from[2];
+    float to[2];
+    Log.Info("Counting line benchmark");
+
+    for (int l = 0; l < MAX_COUNTING_LINES; l++) {
+        lines.add_line(2 + l * 4, -1, 2 + l * 4, FRAME_HEIGHT);
+    }
+
+    unsigned long start = micros();
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        for (int b = 0; b < MAX_BLOBS; b++) {
+            from[X] = (i + b) % FRAME_WIDTH;
+            from[Y] = b % FRAME_HEIGHT;
+            to[X] = from[X] + 0.5;
+            to[Y] = from[Y];
+            lines.check_path(from, to);
+        }
+    }
+    unsigned long total_time = micros() - start;
+    Log.Debug("%d tracked blobs x %d lines: %l us/frame", MAX_BLOBS, MAX_COUNTING_LINES, long(total_time / NUM_ITERATIONS));
+
+    const int line_counts[] = {0, MAX_COUNTING_LINES};
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    for (unsigned int c = 0; c < sizeof(line_counts) / sizeof(line_counts[0]); c++) {
+        ThermalTracker tracker(BACKGROUND_FRAMES);
+        for (int l = 0; l < line_counts[c]; l++) {
+            tracker.add_counting_line(2 + l * 4, -1, 2 + l * 4, FRAME_HEIGHT);
+        }
+
+        total_time = 0;
+        for (int i = 0; i < RECORDING_LENGTH; i++) {
+            fill_recorded_frame(i, frame);
+            bool timed = tracker.finished_building_background();
+
+            start = micros();
+            tracker.process_frame(frame);
+            if (timed) {
+                total_time += micros() - start;
+            }
+        }
+
+        Log.Debug("Recording with %d lines: %l us/frame, %l forward crossings of the first line", line_counts[c], long(total_time / (RECORDING_LENGTH - BACKGROUND_FRAMES)), tracker.get_line_count(0, LINE_FORWARD));
+    }
+
+    Log.Info("Counting line benchmark finished\n\n");
+}
+
+void early_commit_benchmark(){
+    /**
+    * Measure how much sooner movements are counted with early commit, for people who stop in a doorway.
+    * Two trackers are fed the same recording. With early commit, a movement is counted the frame its blob passes
+    * MINIMUM_TRAVEL_THRESHOLD, so the difference to when the normal tracker counts it is the latency that early commit removes.
+    */
+    ThermalTracker normal_tracker(BACKGROUND_FRAMES);
+    ThermalTracker early_tracker(BACKGROUND_FRAMES);
+    ThermalTracker* trackers[2] = {&normal_tracker, &early_tracker};
+    long totals[2] = {0, 0};
+    long emission_frames[2] = {0, 0};
+    unsigned long total_times[2] = {0, 0};
+    long movements[NUM_DIRECTION_CATEGORIES];
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    Log.Info("Early commit benchmark");
+    trackers[1]->set_early_commit(true);
+
+    for (int i = 0; i < RECORDING_LENGTH; i++) {
+        fill_doorway_frame(i, frame);
+
+        for (int t = 0; t < 2; t++) {
+            bool timed = trackers[t]->finished_building_background();
+            unsigned long start = micros();
+            trackers[t]->process_frame(frame);
+            if (timed) {
+                total_times[t] += micros() - start;
+            }
+
+            // Sum up the frames each movement was counted on; the difference between the trackers is their total latency
+            trackers[t]->get_movements(movements);
+            long total = movements[LEFT] + movements[RIGHT] + movements[UP] + movements[DOWN];
+            emission_frames[t] += (total - totals[t]) * i;
+            totals[t] = total;
+        }
+    }
+
+    for (int t = 0; t < 2; t++) {
+        Log.Debug("Early commit %s: %l movements, %l us/frame", t ? "on" : "off", totals[t], long(total_times[t] / (RECORDING_LENGTH - BACKGROUND_FRAMES)));
+    }
+
+    if (totals[0] == totals[1] && totals[0] > 0) {
+        long latency_frames = (emission_frames[0] - emission_frames[1]) / totals[0];
+        Log.Debug("Counted %l frames (%l ms) sooner with early commit", latency_frames, latency_frames * 1000 / REFRESH_RATE);
+    }
+    else{
+        Log.Debug("Trackers counted different movements; latency not comparable");
+    }
+
+    Log.Info("Early commit benchmark finished\n\n");
+}
+
+void deadline_benchmark(){
+    /**
+    * Show the tracker degrading to keep up with a deadline it can't meet at full quality.
+    * The vertical recording is run on a 4x grid with no deadline, then again with a deadline of half the full quality time.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    unsigned long deadline = 0;
+    Log.Info("Deadline benchmark");
+
+    for (int run = 0; run < 2; run++) {
+        ThermalTracker tracker(BACKGROUND_FRAMES);
+        tracker.set_upsampling_factor(4);
+        tracker.set_frame_deadline(deadline);
+        unsigned long total_time = 0;
+        int level_frames[COARSE_DETECTION + 1] = {0, 0, 0, 0};
+
+        for (int i = 0; i < RECORDING_LENGTH; i++) {
+            fill_vertical_frame(i, frame);
+            bool timed = tracker.finished_building_background();
+            tracker.process_frame(frame);
+            if (timed) {
+                total_time += tracker.get_last_frame_time();
+                level_frames[tracker.get_degradation_level()]++;
+            }
+        }
+
+        long frame_time = total_time / (RECORDING_LENGTH - BACKGROUND_FRAMES);
+        Log.Debug("Deadline %l us: %l us/frame, %l misses, frames at each level %d/%d/%d/%d", long(deadline), frame_time, tracker.get_num_deadline_misses(),
+            level_frames[FULL_QUALITY], level_frames[SKIP_BACKGROUND_UPDATE], level_frames[CAP_BLOBS], level_frames[COARSE_DETECTION]);
+        deadline = max(1L, frame_time / 2);
+    }
+
+    Log.Info("Deadline benchmark finished\n\n");
+}
@@ -0,0 +1,32 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the library on a desktop for the host tests.
+// ARDUINO is left undefined so host-only code, such as the pipelined tracker, is built too.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <type_traits>
+
+// Like the core's macros, these return the common type of mixed arguments
+template <typename T, typename U> inline typename std::common_type<T, U>::type min(T a, U b){ return a < b ? a : b; }
+template <typename T, typename U> inline typename std::common_type<T, U>::type max(T a, U b){ return a > b ? a : b; }
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline unsigned long micros(){
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline unsigned long millis(){
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long){}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+// The tracker doesn't talk to the sensor itself; this only satisfies ThermalTracker.h's include on the host.
+
+#endif
@@ -0,0 +1,1632 @@
+/**
+* Host test executable for the ThermalTracker library.
+* Runs the tracker_test.ino test vectors on a desktop, then replays fixed scenes and compares every frame's movement
+* counts and tracked blob table bit-for-bit against the golden outputs of the reference implementation.
+* Run it after touching any kernel to check that the tracking results haven't changed.
+*
+* Build and run from the repository root:
+*   g++ -std=gnu++11 -O2 -Wall -pthread -Itracker_test/host -I. -include Arduino.h *.cpp tracker_test/host/host_test.cpp -o host_test
+*   ./host_test
+*
+* A change that is meant to alter the tracking results needs new golden outputs; regenerate and review them with
+*   ./host_test --update
+*
+* Golden outputs print floats in hex, so they only match on builds that round the same way; keep -ffast-math and
+* FMA contraction (-mfma / -march=native on x86) out of the reference build.
+*/
+
+#include "ThermalTracker.h"
+#include "PipelinedTracker.h"
+#include "SceneGenerator.h"
+#include "MLX90621Converter.h"
+
+// The tests reach into the library's internals, so they are members of the test class its classes befriend
+class ThermalTrackerTest{
+public:
+    static void build_background_test();
+    static void background_average_and_variance_test();
+    static void active_pixel_test();
+    static void pixel_adjacency_test();
+    static void blob_detection_test();
+    static void blob_add_pixel_test();
+    static void distance_test();
+    static void process_blob_test();
+    static void get_num_blobs_test();
+    static void distance_matrix_test();
+    static void sort_tracked_blobs_test();
+    static bool track_frame(float frame[FRAME_HEIGHT][FRAME_WIDTH], TrackedBlob tracked_blobs[], int expected_blobs, int expected_tracked, int expected_updated);
+    static bool check_new_movement(int direction);
+    static void track_test();
+    static void scene_generator_test();
+    static void degradation_test();
+    static void upsampling_scale_test();
+    static void format_frame_result(ThermalTracker& scene_tracker, int frame_number, char line[]);
+    static void golden_scene_test(const char* name, const char* golden_name, ThermalTracker& scene_tracker, int input, const char* directory, bool update);
+    static void golden_tests(const char* directory, bool update);
+    static void degradation_cost_test();
+    static void pyramid_equivalence_test();
+    static void converter_equivalence_test();
+    static void exclusion_test();
+    static void counting_line_test();
+    static void early_commit_test();
+    static void occupancy_test();
+    static void movement_histogram_test();
+    static void background_snapshot_test();
+    static void pruning_stats_test();
+    static void unmatchable_pair_test();
+    static void degrade_mid_walk_test();
+    static void pipeline_lifecycle_test();
+};
+
+const int GOLDEN_FRAMES = 600;
+const int GOLDEN_LINE_LENGTH = 512;
+const char* DEFAULT_GOLDEN_DIRECTORY = "tracker_test/host/golden";
+
+int num_tests = 0;
+int num_passed = 0;
+
+ThermalTracker tracker(5);
+
+float zeros[FRAME_HEIGHT][FRAME_WIDTH] =   {{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                            {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                            {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                            {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}};
+
+float ones[FRAME_HEIGHT][FRAME_WIDTH] =    {{1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1},
+                                            {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1},
+                                            {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1},
+                                            {1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1}};
+
+float twos[FRAME_HEIGHT][FRAME_WIDTH] =    {{2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2},
+                                            {2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2},
+                                            {2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2},
+                                            {2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2}};
+
+float test_frame[FRAME_HEIGHT][FRAME_WIDTH] =  {{5,5,5,5,5,5,5,0,0,0,0,0,0,0,0,0},
+                                                {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                {0,0,0,0,0,0,0,0,0,0,0,0,2,2,0,0},
+                                                {0,9,9,0,0,0,0,0,0,0,0,2,2,2,0,0}};
+
+float blob_test_frame[FRAME_HEIGHT][FRAME_WIDTH] = {{5,5,5,5,0,0,8,8,0,7,7,0,0,0,1,1},
+                                                    {0,0,0,0,0,0,0,0,0,7,7,0,0,0,0,0},
+                                                    {9,9,0,3,0,4,4,0,0,0,0,0,2,2,0,0},
+                                                    {9,9,0,3,0,4,4,0,6,6,0,2,2,2,0,0}};
+
+float track_test_frame_1[FRAME_HEIGHT][FRAME_WIDTH] =  {{0,0,5,5,5,5,5,5,5,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,2,2,0,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,2,2,0,0,0,0,0,0,0,0}};
+
+float track_test_frame_2[FRAME_HEIGHT][FRAME_WIDTH] =  {{0,0,0,0,5,5,5,5,5,5,5,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,0,2,2,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,2,2,2,0,0,0,0,0,0,0,0,0,0,0,0}};
+
+float track_test_frame_3[FRAME_HEIGHT][FRAME_WIDTH] =  {{0,0,0,0,0,0,5,5,5,5,5,5,5,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}};
+
+float track_test_frame_4[FRAME_HEIGHT][FRAME_WIDTH] =  {{0,0,0,0,0,0,0,0,0,0,0,5,5,5,5,5},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
+                                                        {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}};
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+void report(const char* name, bool passing){
+    num_tests++;
+    if (passing) {
+        num_passed++;
+    }
+    printf("%s: Pass? %s %d/%d\n", name, passing ? "true" : "false", num_passed, num_tests);
+}
+
+void build_test_background(){
+    tracker.reset_background();
+    while (!tracker.finished_building_background()){
+        tracker.process_frame(zeros);
+    }
+}
+
+void add_square(Blob& blob, int x, int y, int size, float temperature){
+    Pixel pixel;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            pixel.set(x + j, y + i, temperature);
+            blob.add_pixel(pixel);
+        }
+    }
+}
+
+bool check(bool condition, const char* description, int line){
+    if (!condition) {
+        printf("    Check failed on line %d: %s\n", line, description);
+    }
+    return condition;
+}
+
+// Carries on after a failed check, so every check that broke is reported
+#define CHECK(passing, condition) passing = check((condition), #condition, __LINE__) && passing
+
+void make_built_tracker(ThermalTracker& new_tracker){
+    /**
+    * Build a tracker's background on an empty view; configure it first if the settings must be in place while building.
+    * The frame deadline is turned off so slow or sanitised builds never degrade the tracker partway through a test.
+    */
+    new_tracker.set_frame_deadline(0);
+    while (!new_tracker.finished_building_background()) {
+        new_tracker.process_frame(zeros);
+    }
+}
+
+void paint_person(float frame[FRAME_HEIGHT][FRAME_WIDTH], int column){
+    /**
+    * Paint a person two columns wide and the full height of the view into a frame.
+    * @param column Column of the person's left edge
+    */
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        frame[i][column] = 10;
+        frame[i][column + 1] = 10;
+    }
+}
+
+void show_person(ThermalTracker& scene_tracker, int column){
+    /**
+    * Process a frame with only one person in view.
+    * @param column Column of the person's left edge
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    memcpy(frame, zeros, sizeof(frame));
+    paint_person(frame, column);
+    scene_tracker.process_frame(frame);
+}
+
+void empty_view(ThermalTracker& scene_tracker){
+    /**
+    * Leave the view empty until every track has ended.
+    */
+    for (int i = 0; i < UNCHANGED_FRAME_DELAY; i++) {
+        scene_tracker.process_frame(zeros);
+    }
+}
+
+void walk_person(ThermalTracker& scene_tracker, int first_column, int last_column, int step){
+    /**
+    * Walk a person across the view, then leave the view empty until their track has ended.
+    * @param first_column Column of the person's left edge in the first frame
+    * @param last_column Column of the person's left edge in the last frame
+    * @param step Columns moved each frame; negative to walk left
+    */
+    for (int column = first_column; (last_column - column) * step >= 0; column += step) {
+        show_person(scene_tracker, column);
+    }
+    empty_view(scene_tracker);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Unit tests; ported from tracker_test.ino
+
+void ThermalTrackerTest::build_background_test(){
+    build_test_background();
+    report("Background build test", tracker.finished_building_background());
+}
+
+void ThermalTrackerTest::background_average_and_variance_test(){
+    float averages[FRAME_HEIGHT][FRAME_WIDTH];
+    float variances[FRAME_HEIGHT][FRAME_WIDTH];
+
+    tracker.reset_background();
+    tracker.process_frame(zeros);
+    tracker.process_frame(ones);
+    tracker.get_averages(averages);
+    bool passing = averages[0][0] == 0.5;
+
+    tracker.process_frame(twos);
+    tracker.get_averages(averages);
+    passing = passing && averages[0][0] == 1;
+
+    tracker.process_frame(twos);
+    tracker.get_averages(averages);
+    passing = passing && averages[0][0] == 1.25;
+
+    tracker.process_frame(ones);
+    tracker.get_averages(averages);
+    tracker.get_variances(variances);
+    passing = passing && absolute(averages[0][0] - 1.2) < 0.1 && absolute(variances[0][0] - 0.83666) < 0.1;
+
+    report("Background average and variance test", passing);
+}
+
+void ThermalTrackerTest::active_pixel_test(){
+    Pixel pixels[FRAME_WIDTH * FRAME_HEIGHT];
+    build_test_background();
+
+    tracker.load_frame(test_frame);
+    int num_pixels = tracker.get_active_pixels(pixels);
+    report("Active pixel test", num_pixels == 14);
+}
+
+void ThermalTrackerTest::pixel_adjacency_test(){
+    Pixel pixels[FRAME_WIDTH * FRAME_HEIGHT];
+    tracker.load_frame(test_frame);
+    int num_pixels = tracker.get_active_pixels(pixels);
+
+    // The first two pixels are next to each other in the top row; the last is in the bottom right blob
+    bool passing = pixels[0].is_adjacent(pixels[1]) && !pixels[0].is_adjacent(pixels[num_pixels - 1]);
+    report("Adjacency test", passing);
+}
+
+void ThermalTrackerTest::blob_detection_test(){
+    Blob blobs[MAX_BLOBS];
+
+    tracker.load_frame(test_frame);
+    int num_blobs = tracker.get_blobs(blobs);
+    bool passing = num_blobs == 3;
+
+    tracker.remove_small_blobs(blobs);
+    passing = passing && tracker.get_num_blobs(blobs) == 2;
+
+    // blob_test_frame has 9 blobs, one more than the default pool holds
+    long num_overflows = tracker.get_num_blob_overflows();
+    tracker.load_frame(blob_test_frame);
+    num_blobs = tracker.get_blobs(blobs);
+    passing = passing && num_blobs == MAX_BLOBS && tracker.get_num_blob_overflows() == num_overflows + 1;
+
+    ThermalTracker large_tracker(5, MAX_DISTANCE_THRESHOLD, MINIMUM_BLOB_SIZE, ACTIVATION_SIGMA, RUNNING_AVERAGE_BACKGROUND, 10);
+    Blob large_blobs[10];
+    while (!large_tracker.finished_building_background()){
+        large_tracker.process_frame(zeros);
+    }
+    large_tracker.load_frame(blob_test_frame);
+    passing = passing && large_tracker.get_blobs(large_blobs) == 9;
+
+    report("Blob detection test", passing);
+}
+
+void ThermalTrackerTest::blob_add_pixel_test(){
+    Blob blob;
+    Pixel pixel;
+
+    blob.clear();
+    pixel.set(1, 1, 10.0);
+    blob.add_pixel(pixel);
+    bool passing = blob.num_pixels == 1 && blob.centroid[X] == 1.0 && blob.centroid[Y] == 1.0 && blob.average_temperature == 10.0;
+
+    pixel.set(1, 2, 20.0);
+    blob.add_pixel(pixel);
+    passing = passing && blob.num_pixels == 2 && blob.centroid[X] == 1.0 && blob.centroid[Y] == 1.5 && blob.average_temperature == 15.0;
+
+    pixel.set(1, 3, 30.0);
+    blob.add_pixel(pixel);
+    passing = passing && blob.num_pixels == 3 && blob.centroid[X] == 1.0 && blob.centroid[Y] == 2.0 && blob.average_temperature == 20.0;
+
+    pixel.set(2, 3, 40.0);
+    blob.add_pixel(pixel);
+    passing = passing && blob.num_pixels == 4 && blob.centroid[X] == 1.25 && blob.centroid[Y] == 2.25 && blob.average_temperature == 25.0;
+    passing = passing && blob.width == 2 && blob.height == 3;
+
+    report("Blob add pixel test", passing);
+}
+
+void ThermalTrackerTest::distance_test(){
+    TrackedBlob t_blob;
+    Blob blob;
+    Pixel pixel;
+
+    // Centroid = (14.5, 3), Area = 6, Temperature = 30, AR = 0.66
+    blob.clear();
+    pixel.set(15, 2, 30);
+    blob.add_pixel(pixel);
+    pixel.set(15, 3, 30);
+    blob.add_pixel(pixel);
+    pixel.set(15, 4, 30);
+    blob.add_pixel(pixel);
+    pixel.set(14, 2, 30);
+    blob.add_pixel(pixel);
+    pixel.set(14, 3, 30);
+    blob.add_pixel(pixel);
+    pixel.set(14, 4, 30);
+    blob.add_pixel(pixel);
+    t_blob.set(blob);
+
+    // Centroid = (3, 2), Area = 3, Temperature = 48, AR = 3
+    blob.clear();
+    pixel.set(2, 2, 48);
+    blob.add_pixel(pixel);
+    pixel.set(3, 2, 48);
+    blob.add_pixel(pixel);
+    pixel.set(4, 2, 48);
+    blob.add_pixel(pixel);
+
+    // Distance = 2*(14.5 - 3) + 2*(3 - 2) + 2*(6 - 3) + 10*(3 - 0.666666) + 10(48 - 30) = 234.33334
+    float distance = t_blob.get_distance(blob);
+    bool passing = absolute(distance - 234.33334) < 1;
+
+    // Centroid = (10.5, 3), Area = 6, Temperature = 30, AR = 0.66
+    blob.clear();
+    pixel.set(11, 2, 30);
+    blob.add_pixel(pixel);
+    pixel.set(11, 3, 30);
+    blob.add_pixel(pixel);
+    pixel.set(11, 4, 30);
+    blob.add_pixel(pixel);
+    pixel.set(10, 2, 30);
+    blob.add_pixel(pixel);
+    pixel.set(10, 3, 30);
+    blob.add_pixel(pixel);
+    pixel.set(10, 4, 30);
+    blob.add_pixel(pixel);
+
+    // Distance = 2*(14.5 - 10.5) = 8
+    distance = t_blob.get_distance(blob);
+    passing = passing && distance == 8.0;
+
+    // Test out distance using predicted path
+    t_blob.update_blob(blob);
+    blob.clear();
+    pixel.set(7, 2, 30);
+    blob.add_pixel(pixel);
+    pixel.set(7, 3, 30);
+    blob.add_pixel(pixel);
+    pixel.set(7, 4, 30);
+    blob.add_pixel(pixel);
+    pixel.set(6, 2, 30);
+    blob.add_pixel(pixel);
+    pixel.set(6, 3, 30);
+    blob.add_pixel(pixel);
+    pixel.set(6, 4, 30);
+    blob.add_pixel(pixel);
+
+    // Centroid = (6.5, 3), right where the tracked blob is predicted to be
+    distance = t_blob.get_distance(blob);
+    passing = passing && distance == 0;
+
+    report("Distance calculation test", passing);
+}
+
+void ThermalTrackerTest::process_blob_test(){
+    TrackedBlob t_blob;
+    Blob blob;
+    long movements[NUM_DIRECTION_CATEGORIES];
+
+    add_square(blob, 0, 0, 2, 25.0);
+    t_blob.set(blob);
+
+    blob.clear();
+    add_square(blob, 4, 5, 2, 25.0);
+    t_blob.update_blob(blob);
+    bool passing = t_blob.get_travel(X) == 4;
+
+    blob.clear();
+    add_square(blob, 14, 0, 2, 25.0);
+    t_blob.update_blob(blob);
+    passing = passing && t_blob.get_travel(X) == 14;
+
+    tracker.reset_movements();
+    tracker.process_blob_movements(t_blob);
+    tracker.get_movements(movements);
+    passing = passing && movements[RIGHT] == 1;
+
+    report("Tracked blob movement test", passing);
+}
+
+void ThermalTrackerTest::get_num_blobs_test(){
+    Blob blobs[MAX_BLOBS];
+    TrackedBlob tracked_blobs[MAX_BLOBS];
+    Pixel pixel;
+
+    for (int i = 0; i < MAX_BLOBS; i++) {
+        pixel.set(i, i, i);
+        blobs[i].add_pixel(pixel);
+    }
+    bool passing = tracker.get_num_blobs(blobs) == MAX_BLOBS;
+
+    for (int i = 0; i < MAX_BLOBS/2; i++) {
+        tracked_blobs[i].set(blobs[i]);
+    }
+    passing = passing && tracker.get_num_blobs(tracked_blobs) == MAX_BLOBS/2;
+
+    report("Get num blobs test", passing);
+}
+
+void ThermalTrackerTest::distance_matrix_test(){
+    /**
+    * 3 tracked blobs; 3 New blobs
+    * 2 of the new blobs will match the tracked blobs closely.
+    * The last combination will not match up
+    */
+    TrackedBlob tracked_blobs[MAX_BLOBS];
+    Blob blobs[MAX_BLOBS];
+    Pixel pixel;
+    float distance_matrix[MAX_BLOBS * MAX_BLOBS];
+
+    // Blob 0 matches TBlob 0
+    add_square(blobs[0], 2, 2, 2, 10);
+    tracked_blobs[0].set(blobs[0]);
+
+    // Blob 1 matches TBlob 2
+    pixel.set(9, 1, 20);
+    blobs[1].add_pixel(pixel);
+    pixel.set(9, 2, 20);
+    blobs[1].add_pixel(pixel);
+    tracked_blobs[2].set(blobs[1]);
+    pixel.set(9, 3, 20);
+    blobs[1].add_pixel(pixel);
+
+    // Blob 2 matches nothing!
+    pixel.set(15, 1, 30);
+    blobs[2].add_pixel(pixel);
+    pixel.set(14, 2, 30);
+    blobs[2].add_pixel(pixel);
+    tracked_blobs[1].set(blobs[2]);
+
+    blobs[2].clear();
+    pixel.set(7, 0, 90);
+    blobs[2].add_pixel(pixel);
+    pixel.set(6, 0, 90);
+    blobs[2].add_pixel(pixel);
+
+    tracker.generate_distance_matrix(tracked_blobs, blobs, distance_matrix);
+
+    int indexes[2];
+    float distance = tracker.get_lowest_distance(distance_matrix, indexes);
+    bool passing = indexes[0] == 0 && indexes[1] == 0 && distance == 0.0;
+    tracker.remove_distance_row_col(indexes[0], indexes[1], distance_matrix);
+
+    distance = tracker.get_lowest_distance(distance_matrix, indexes);
+    passing = passing && indexes[0] == 2 && indexes[1] == 1 && absolute(distance - 4.67) < 1;
+    tracker.remove_distance_row_col(indexes[0], indexes[1], distance_matrix);
+
+    distance = tracker.get_lowest_distance(distance_matrix, indexes);
+    passing = passing && indexes[0] == -1 && indexes[1] == -1 && distance == 999;
+
+    report("Distance matrix test", passing);
+}
+
+void ThermalTrackerTest::sort_tracked_blobs_test(){
+    TrackedBlob tracked_blobs[MAX_BLOBS];
+    Blob blob;
+    Pixel pixel;
+
+    for (int i = 0; i < 5; i++) {
+        blob.clear();
+        pixel.set(i, i, i);
+        blob.add_pixel(pixel);
+        tracked_blobs[i].set(blob);
+    }
+    bool passing = tracker.get_num_blobs(tracked_blobs) == 5 && tracker.get_num_updated_blobs(tracked_blobs) == 5;
+
+    // Scratch one off and recheck numbers
+    tracked_blobs[1].reset_updated_status();
+    passing = passing && tracker.get_num_blobs(tracked_blobs) == 5 && tracker.get_num_updated_blobs(tracked_blobs) == 4;
+    passing = passing && int(tracked_blobs[1]._blob.centroid[X]) == 1 && int(tracked_blobs[1]._blob.centroid[Y]) == 1;
+
+    // Re-sort to remove un-updated blobs
+    tracker.sort_tracked_blobs(tracked_blobs);
+    passing = passing && tracker.get_num_blobs(tracked_blobs) == 4 && tracker.get_num_updated_blobs(tracked_blobs) == 4;
+    passing = passing && int(tracked_blobs[1]._blob.centroid[X]) != 1 && int(tracked_blobs[1]._blob.centroid[Y]) != 1;
+
+    // Now remove the rest, but leave the blob in position 1 (it will move to 0 after the shuffle)
+    tracked_blobs[0].reset_updated_status();
+    tracked_blobs[2].reset_updated_status();
+    tracked_blobs[3].reset_updated_status();
+    passing = passing && tracker.get_num_blobs(tracked_blobs) == 4 && tracker.get_num_updated_blobs(tracked_blobs) == 1;
+
+    // Check that the sort function can remove multiple blobs at once
+    tracker.sort_tracked_blobs(tracked_blobs);
+    passing = passing && tracker.get_num_blobs(tracked_blobs) == 1 && tracker.get_num_updated_blobs(tracked_blobs) == 1;
+    passing = passing && tracked_blobs[1]._blob.centroid[X] < 0 && tracked_blobs[1]._blob.centroid[Y] < 0;
+
+    report("Sort tracked blobs test", passing);
+}
+
+bool ThermalTrackerTest::track_frame(float frame[FRAME_HEIGHT][FRAME_WIDTH], TrackedBlob tracked_blobs[], int expected_blobs, int expected_tracked, int expected_updated){
+    Blob blobs[MAX_BLOBS];
+    tracker.load_frame(frame);
+    tracker.get_blobs(blobs);
+    int num_blobs = tracker.get_num_blobs(blobs);
+    int num_tracked = tracker.get_num_blobs(tracked_blobs);
+    tracker.track_blobs(blobs, tracked_blobs);
+    int num_updated = tracker.get_num_updated_blobs(tracked_blobs);
+    return num_blobs == expected_blobs && num_tracked == expected_tracked && num_updated == expected_updated;
+}
+
+bool ThermalTrackerTest::check_new_movement(int direction){
+    long movements[NUM_DIRECTION_CATEGORIES];
+    if (!tracker.has_new_movements()) {
+        return false;
+    }
+
+    tracker.get_movements(movements);
+    tracker.reset_movements();
+    return movements[direction] == 1;
+}
+
+void ThermalTrackerTest::track_test(){
+    TrackedBlob tracked_blobs[MAX_BLOBS];
+
+    long movements[NUM_DIRECTION_CATEGORIES];
+
+    build_test_background();
+
+    // Read movements to clear the has_new_movements flag
+    tracker.get_movements(movements);
+    tracker.reset_movements();
+
+    // Test frame 0 contains 3 blobs - one of them is small
+    bool passing = track_frame(test_frame, tracked_blobs, 3, 0, 3) && !tracker.has_new_movements();
+
+    // Test frame 1 has 2 blobs - both are similar to the last frame's blobs (small blob missing)
+    passing = passing && track_frame(track_test_frame_1, tracked_blobs, 2, 3, 2) && check_new_movement(NO_DIRECTION);
+
+    // Test frame 2 has 2 blobs - none new
+    passing = passing && track_frame(track_test_frame_2, tracked_blobs, 2, 2, 2) && !tracker.has_new_movements();
+
+    // Test frame 3 contains 1 blob - A blob from the last frame has left
+    passing = passing && track_frame(track_test_frame_3, tracked_blobs, 1, 2, 1) && check_new_movement(LEFT);
+
+    // Test frame 4 has 1 blob - none new
+    passing = passing && track_frame(track_test_frame_4, tracked_blobs, 1, 1, 1) && !tracker.has_new_movements();
+
+    // The last blob leaves
+    passing = passing && track_frame(zeros, tracked_blobs, 0, 1, 0) && check_new_movement(RIGHT);
+
+    report("Track test", passing);
+}
+
+void ThermalTrackerTest::scene_generator_test(){
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    float repeat_frame[FRAME_HEIGHT][FRAME_WIDTH];
+    long truth[NUM_DIRECTION_CATEGORIES];
+    long movements[NUM_DIRECTION_CATEGORIES];
+
+    // The same seed renders the same frames
+    SceneGenerator scene(FRAME_WIDTH, FRAME_HEIGHT, REFRESH_RATE, 7);
+    SceneGenerator repeat_scene(FRAME_WIDTH, FRAME_HEIGHT, REFRESH_RATE, 7);
+    scene.set_traffic(30);
+    repeat_scene.set_traffic(30);
+    bool passing = true;
+    for (int f = 0; f < 1000; f++) {
+        scene.render(&frame[0][0]);
+        repeat_scene.render(&repeat_frame[0][0]);
+        passing = passing && memcmp(frame, repeat_frame, sizeof(frame)) == 0;
+    }
+
+    // Sparse traffic past a drifting room and a heater is counted to within 15% of the ground truth
+    ThermalTracker scene_tracker;
+    scene.reset(7);
+    scene.set_ambient(SCENE_AMBIENT_TEMPERATURE, 0.2);
+    scene.add_hot_spot(1, 0.5, 0.8, 0.8, 24);
+    scene.set_traffic(0);
+    scene.process_frames(scene_tracker, RUNNING_AVERAGE_SIZE + REFRESH_RATE);
+    scene.set_traffic(5, 6, 12);
+    scene.process_frames(scene_tracker, REFRESH_RATE * 60 * 10);
+    scene.set_traffic(0);
+    scene.process_frames(scene_tracker, REFRESH_RATE * 5);
+
+    scene.get_crossings(truth);
+    scene_tracker.get_movements(movements);
+    long num_crossings = truth[LEFT] + truth[RIGHT];
+    long num_counted = movements[LEFT] + movements[RIGHT];
+    passing = passing && num_crossings > 20 && absolute(num_counted - num_crossings) <= 0.15 * num_crossings;
+    passing = passing && movements[LEFT] <= truth[LEFT] && movements[RIGHT] <= truth[RIGHT];
+
+    report("Scene generator test", passing);
+}
+
+void ThermalTrackerTest::degradation_test(){
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    float averages[FRAME_HEIGHT][FRAME_WIDTH];
+    ThermalTracker degrading_tracker(5);
+    degrading_tracker.set_upsampling_factor(2);
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = 20;
+        }
+    }
+    for (int f = 0; f < 5; f++) {
+        degrading_tracker.process_frame(frame);
+    }
+
+    // Sustained overrun steps down one level at a time, as far as coarse detection
+    bool passing = degrading_tracker.get_degradation_level() == FULL_QUALITY;
+    for (int f = 0; f < DEADLINE_MISSES_TO_DEGRADE - 1; f++) {
+        degrading_tracker.check_deadline(FRAME_DEADLINE + 1);
+    }
+    passing = passing && degrading_tracker.get_degradation_level() == FULL_QUALITY;
+    for (int f = 0; f < DEADLINE_MISSES_TO_DEGRADE * 5; f++) {
+        degrading_tracker.check_deadline(FRAME_DEADLINE + 1);
+    }
+    passing = passing && degrading_tracker.get_degradation_level() == COARSE_DETECTION;
+    passing = passing && degrading_tracker.get_num_deadline_misses() == DEADLINE_MISSES_TO_DEGRADE * 6 - 1;
+    passing = passing && degrading_tracker.get_upsampling_factor() == 1 && degrading_tracker.blob_limit == MAX_BLOBS / 2;
+
+    // Tracked frames are kept out of the background
+    degrading_tracker.get_averages(averages);
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = 21;
+        }
+    }
+    degrading_tracker.process_frame(frame);
+    degrading_tracker.get_averages(frame);
+    passing = passing && memcmp(frame, averages, sizeof(frame)) == 0;
+
+    // Frames between the headroom and the deadline hold the level; frames well inside it step back up
+    for (int f = 0; f < FRAMES_TO_RECOVER * 2; f++) {
+        degrading_tracker.check_deadline(FRAME_DEADLINE);
+    }
+    passing = passing && degrading_tracker.get_degradation_level() == COARSE_DETECTION;
+    for (int f = 0; f < FRAMES_TO_RECOVER * 3; f++) {
+        degrading_tracker.check_deadline(0);
+    }
+    passing = passing && degrading_tracker.get_degradation_level() == FULL_QUALITY;
+    passing = passing && degrading_tracker.get_upsampling_factor() == 2 && degrading_tracker.blob_limit == MAX_BLOBS;
+
+    // No deadline, no misses
+    degrading_tracker.set_frame_deadline(0);
+    for (int f = 0; f < DEADLINE_MISSES_TO_DEGRADE; f++) {
+        degrading_tracker.check_deadline(FRAME_DEADLINE + 1);
+    }
+    passing = passing && degrading_tracker.get_degradation_level() == FULL_QUALITY;
+    passing = passing && degrading_tracker.get_num_deadline_misses() == DEADLINE_MISSES_TO_DEGRADE * 6 - 1;
+
+    report("Degradation test", passing);
+}
+
+void ThermalTrackerTest::upsampling_scale_test(){
+    // The same pair of blobs found on a 1x and a 2x grid are the same distance apart
+    TrackedBlob tracked_blobs[2];
+    Blob blobs[2];
+    for (int f = 1; f <= 2; f++) {
+        Blob tracked;
+        add_square(tracked, 2 * f, f, 2 * f, 30);
+        add_square(blobs[f - 1], 5 * f, f, 3 * f, 28);
+        tracked_blobs[f - 1].set(tracked);
+    }
+    bool passing = absolute(tracked_blobs[0].get_distance(blobs[0], 1) - tracked_blobs[1].get_distance(blobs[1], 2)) < 0.001;
+
+    // A short shuffle isn't counted, and real crossings are, whatever the upsampling factor
+    const int factors[] = {1, 2, 4};
+    long movements[NUM_DIRECTION_CATEGORIES];
+    for (unsigned int f = 0; f < sizeof(factors) / sizeof(factors[0]); f++) {
+        ThermalTracker scaled_tracker(20);
+        scaled_tracker.set_upsampling_factor(factors[f]);
+        scaled_tracker.set_frame_deadline(0);
+        SceneGenerator scene(FRAME_WIDTH, FRAME_HEIGHT, REFRESH_RATE, 3);
+        scene.process_frames(scaled_tracker, 40);
+        scene.add_person(5, 1.5, 8, 1.5, 4, scene.get_frame_number());
+        scene.process_frames(scaled_tracker, 40);
+        scene.add_person(-2, 1.5, 18, 1.5, 8, scene.get_frame_number());
+        scene.process_frames(scaled_tracker, 60);
+        scene.add_person(16, 1.5, -3, 1.5, 6, scene.get_frame_number());
+        scene.process_frames(scaled_tracker, 80);
+
+        scaled_tracker.get_movements(movements);
+        passing = passing && movements[LEFT] == 1 && movements[RIGHT] == 1 && movements[UP] == 0 && movements[DOWN] == 0;
+        passing = passing && movements[NO_DIRECTION] == 1;
+    }
+
+    report("Upsampling scale test", passing);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Golden output tests
+
+unsigned int scene_seed;
+
+float scene_noise(){
+    scene_seed = scene_seed * 1103515245u + 12345u;
+    return ((scene_seed >> 8) & 0xFFFF) / 65536.0f;
+}
+
+void make_walkers_frame(int frame_number, float frame[FRAME_HEIGHT][FRAME_WIDTH]){
+    /**
+    * A noisy empty room with people walking through it; alternately one at a time left and right, then two passing each other.
+    */
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frame[i][j] = 20 + scene_noise() * 0.2;
+        }
+    }
+
+    int period = 40;
+    int phase = frame_number % period;
+    int kind = (frame_number / period) % 4;
+    if (frame_number <= period || phase >= 20) {
+        return;
+    }
+
+    float x = (kind % 2 == 0) ? phase * 0.9 - 1 : 17 - phase * 0.9;
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            if ((j - x) * (j - x) < 2.5) {
+                frame[i][j] = 30 + scene_noise();
+            }
+        }
+    }
+
+    if (kind >= 2) {
+        float other_x = 15 - x;
+        for (int i = 1; i < 3; i++) {
+            for (int j = 0; j < FRAME_WIDTH; j++) {
+                if ((j - other_x) * (j - other_x) < 1.1) {
+                    frame[i][j] = 27 + scene_noise();
+                }
+            }
+        }
+    }
+}
+
+void ThermalTrackerTest::format_frame_result(ThermalTracker& scene_tracker, int frame_number, char line[]){
+    /**
+    * Print a frame's movement counts and tracked blob table, with floats in hex so the comparison is exact.
+    */
+    long movements[NUM_DIRECTION_CATEGORIES];
+    scene_tracker.get_movements(movements);
+    int length = snprintf(line, GOLDEN_LINE_LENGTH, "%d %d %ld %ld %ld %ld %ld", frame_number, scene_tracker.get_num_last_blobs(),
+                          movements[LEFT], movements[RIGHT], movements[UP], movements[DOWN], movements[NO_DIRECTION]);
+
+    for (int b = 0; b < scene_tracker.get_max_blobs() && length < GOLDEN_LINE_LENGTH; b++) {
+        TrackedBlob& tracked_blob = scene_tracker.tracked_blobs[b];
+        if (tracked_blob.is_active()) {
+            length += snprintf(&line[length], GOLDEN_LINE_LENGTH - length, " (%a %a %d %a)", tracked_blob._blob.centroid[X],
+                               tracked_blob._blob.centroid[Y], tracked_blob._blob.num_pixels, tracked_blob._blob.average_temperature);
+        }
+    }
+}
+
+class GoldenFile{
+public:
+    GoldenFile(const char* directory, const char* name, bool _update){
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s.txt", directory, name);
+        update = _update;
+        file = fopen(path, update ? "w" : "r");
+        num_mismatches = 0;
+        if (file == NULL) {
+            printf("Can't open golden output %s\n", path);
+        }
+    }
+
+    ~GoldenFile(){
+        if (file != NULL) {
+            fclose(file);
+        }
+    }
+
+    void check(int frame_number, const char line[]){
+        char expected[GOLDEN_LINE_LENGTH + 2];
+        if (file == NULL) {
+            return;
+        }
+
+        if (update) {
+            fprintf(file, "%s\n", line);
+            return;
+        }
+
+        if (fgets(expected, sizeof(expected), file) == NULL) {
+            expected[0] = '\0';
+        }
+        expected[strcspn(expected, "\n")] = '\0';
+
+        if (strcmp(expected, line) != 0) {
+            if (num_mismatches == 0) {
+                printf("  frame %d\n    expected: %s\n    got:      %s\n", frame_number, expected, line);
+            }
+            num_mismatches++;
+        }
+    }
+
+    bool passed(){
+        return file != NULL && num_mismatches == 0;
+    }
+
+private:
+    FILE* file;
+    bool update;
+    int num_mismatches;
+};
+
+enum golden_inputs {
+    ROW_MAJOR_INPUT = 0,
+    COLUMN_MAJOR_INPUT = 1,
+    PIPELINED_INPUT = 2
+};
+
+void ThermalTrackerTest::golden_scene_test(const char* name, const char* golden_name, ThermalTracker& scene_tracker, int input, const char* directory, bool update){
+    /**
+    * Replay the walkers scene through a tracker and compare every frame against a golden output.
+    * @param name Name of the test
+    * @param golden_name Name of the golden output; scenes that must give the same results share one
+    * @param scene_tracker Tracker set up for the scene
+    * @param input How the frames are fed in (golden_inputs)
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    float transposed[FRAME_WIDTH][FRAME_HEIGHT];
+    char line[GOLDEN_LINE_LENGTH];
+    GoldenFile golden(directory, golden_name, update);
+    PipelinedTracker pipeline(scene_tracker, 0);
+    scene_tracker.set_frame_deadline(0);    // A slow machine mustn't change what is tracked
+    if (input == PIPELINED_INPUT) {
+        pipeline.start();
+    }
+
+    scene_seed = 12345;
+    for (int f = 0; f < GOLDEN_FRAMES; f++) {
+        make_walkers_frame(f, frame);
+
+        if (input == COLUMN_MAJOR_INPUT) {
+            for (int i = 0; i < FRAME_HEIGHT; i++) {
+                for (int j = 0; j < FRAME_WIDTH; j++) {
+                    transposed[j][i] = frame[i][j];
+                }
+            }
+            scene_tracker.process_frame(&transposed[0][0], FRAME_HEIGHT, true);
+        }
+        else if (input == PIPELINED_INPUT) {
+            pipeline.process_frame(frame);
+            pipeline.flush();
+        }
+        else{
+            scene_tracker.process_frame(frame);
+        }
+
+        format_frame_result(scene_tracker, f, line);
+        golden.check(f, line);
+    }
+
+    if (!update) {
+        report(name, golden.passed());
+    }
+}
+
+void ThermalTrackerTest::golden_tests(const char* directory, bool update){
+    ThermalTracker running_average(20);
+    golden_scene_test("Golden running average test", "walkers_running_average", running_average, ROW_MAJOR_INPUT, directory, update);
+
+    // Strided input, and the pipeline when the ingest stage waits on every background decision, must track exactly the same
+    if (!update) {
+        ThermalTracker column_major(20);
+        golden_scene_test("Golden column-major input test", "walkers_running_average", column_major, COLUMN_MAJOR_INPUT, directory, false);
+
+        ThermalTracker pipelined(20);
+        golden_scene_test("Golden pipelined test", "walkers_running_average", pipelined, PIPELINED_INPUT, directory, false);
+    }
+
+    ThermalTracker mixture(20, MAX_DISTANCE_THRESHOLD, MINIMUM_BLOB_SIZE, ACTIVATION_SIGMA, MIXTURE_BACKGROUND);
+    golden_scene_test("Golden mixture background test", "walkers_mixture", mixture, ROW_MAJOR_INPUT, directory, update);
+
+    ThermalTracker sliding_window(20, MAX_DISTANCE_THRESHOLD, MINIMUM_BLOB_SIZE, ACTIVATION_SIGMA, SLIDING_WINDOW_BACKGROUND);
+    golden_scene_test("Golden sliding window background test", "walkers_sliding_window", sliding_window, ROW_MAJOR_INPUT, directory, update);
+
+    float offsets[FRAME_HEIGHT][FRAME_WIDTH];
+    float gains[FRAME_HEIGHT][FRAME_WIDTH];
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            offsets[i][j] = 0.1 * j - 0.05 * i;
+            gains[i][j] = 1.0 + 0.01 * i;
+        }
+    }
+    ThermalTracker calibrated(20);
+    calibrated.set_pixel_calibration(offsets, gains);
+    golden_scene_test("Golden calibrated test", "walkers_calibrated", calibrated, ROW_MAJOR_INPUT, directory, update);
+
+    ThermalTracker upsampled(20);
+    upsampled.set_upsampling_factor(2);
+    golden_scene_test("Golden upsampled test", "walkers_upsampled", upsampled, ROW_MAJOR_INPUT, directory, update);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Feature tests
+
+void ThermalTrackerTest::degradation_cost_test(){
+    /**
+    * An overrun must make the following frames cheaper, not just change the degradation level.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    const int num_timed_frames = 200;
+
+    // Time the same walkers on the upsampled grid at full quality, then after every frame has overrun a 1us deadline
+    ThermalTracker upsampled_tracker(20);
+    upsampled_tracker.set_upsampling_factor(4);
+    upsampled_tracker.set_frame_deadline(0);
+    scene_seed = 12345;
+    int f = 0;
+    for (; f < 20; f++) {
+        make_walkers_frame(f, frame);
+        upsampled_tracker.process_frame(frame);
+    }
+
+    unsigned long full_time = 0;
+    for (int n = 0; n < num_timed_frames; n++, f++) {
+        make_walkers_frame(f, frame);
+        upsampled_tracker.process_frame(frame);
+        full_time += upsampled_tracker.get_last_frame_time();
+    }
+
+    upsampled_tracker.set_frame_deadline(1);
+    for (int n = 0; n < DEADLINE_MISSES_TO_DEGRADE * 3; n++, f++) {
+        make_walkers_frame(f, frame);
+        upsampled_tracker.process_frame(frame);
+    }
+    bool passing = upsampled_tracker.get_degradation_level() == COARSE_DETECTION;
+
+    // Degraded frames can dip under the recovery headroom and briefly step back up, so only the average is checked
+    unsigned long degraded_time = 0;
+    for (int n = 0; n < num_timed_frames; n++, f++) {
+        make_walkers_frame(f, frame);
+        upsampled_tracker.process_frame(frame);
+        degraded_time += upsampled_tracker.get_last_frame_time();
+    }
+    passing = passing && degraded_time * 2 < full_time;
+
+    // The mixture background is too quick to time here; check that it stops learning but still classifies
+    ThermalTracker mixture_tracker(20, MAX_DISTANCE_THRESHOLD, MINIMUM_BLOB_SIZE, ACTIVATION_SIGMA, MIXTURE_BACKGROUND);
+    mixture_tracker.set_frame_deadline(FRAME_DEADLINE);
+    scene_seed = 12345;
+    for (f = 0; f < 40; f++) {
+        make_walkers_frame(f, frame);
+        mixture_tracker.process_frame(frame);
+    }
+
+    for (int n = 0; n < DEADLINE_MISSES_TO_DEGRADE; n++) {
+        mixture_tracker.check_deadline(FRAME_DEADLINE + 1);
+    }
+    passing = passing && mixture_tracker.get_degradation_level() == SKIP_BACKGROUND_UPDATE;
+
+    static float components[FRAME_WIDTH * FRAME_HEIGHT][3][MIXTURE_NUM_GAUSSIANS];
+    memcpy(components, mixture_tracker.mixture_background->pixel_components, sizeof(components));
+    int max_active_pixels = 0;
+    for (; f < 60; f++) {
+        make_walkers_frame(f, frame);
+        mixture_tracker.process_frame(frame);
+        max_active_pixels = max(max_active_pixels, mixture_tracker.get_frame_stats().num_active_pixels);
+    }
+    passing = passing && mixture_tracker.get_degradation_level() == SKIP_BACKGROUND_UPDATE;
+    passing = passing && memcmp(components, mixture_tracker.mixture_background->pixel_components, sizeof(components)) == 0;
+    passing = passing && max_active_pixels > 0;
+
+    report("Degradation cost test", passing);
+}
+
+void ThermalTrackerTest::pyramid_equivalence_test(){
+    /**
+    * The pyramid must find the same blobs and count the same movements as full resolution detection.
+    * Its samples can only miss a blob narrower or shorter than PYRAMID_SAMPLE_SPACING, so frames with one are let off.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    const int factors[] = {2, 4};
+    bool passing = true;
+
+    for (int f = 0; f < 2; f++) {
+        ThermalTracker full_tracker(20);
+        ThermalTracker pyramid_tracker(20);
+        full_tracker.set_frame_deadline(0);
+        pyramid_tracker.set_frame_deadline(0);
+        passing = passing && pyramid_tracker.set_pyramid_factor(factors[f]);
+
+        int num_checked_frames = 0;
+        scene_seed = 12345;
+        for (int frame_number = 0; frame_number < GOLDEN_FRAMES; frame_number++) {
+            make_walkers_frame(frame_number, frame);
+            full_tracker.process_frame(frame);
+            pyramid_tracker.process_frame(frame);
+
+            bool sampled = true;
+            int num_blobs = full_tracker.get_num_blobs(full_tracker.frame_blobs);
+            for (int i = 0; i < num_blobs; i++) {
+                Blob& blob = full_tracker.frame_blobs[i];
+                sampled = sampled && blob.width >= PYRAMID_SAMPLE_SPACING && blob.height >= PYRAMID_SAMPLE_SPACING;
+            }
+
+            if (sampled) {
+                passing = passing && pyramid_tracker.get_num_blobs(pyramid_tracker.frame_blobs) == num_blobs;
+                num_checked_frames++;
+            }
+        }
+
+        // Nearly every frame should be comparable, or the check proves nothing
+        passing = passing && num_checked_frames > GOLDEN_FRAMES * 9 / 10;
+
+        long full_movements[NUM_DIRECTION_CATEGORIES];
+        long pyramid_movements[NUM_DIRECTION_CATEGORIES];
+        full_tracker.get_movements(full_movements);
+        pyramid_tracker.get_movements(pyramid_movements);
+        passing = passing && full_movements[LEFT] > 0 && full_movements[RIGHT] > 0;
+        passing = passing && memcmp(full_movements, pyramid_movements, sizeof(full_movements)) == 0;
+    }
+
+    report("Pyramid equivalence test", passing);
+}
+
+void ThermalTrackerTest::converter_equivalence_test(){
+    /**
+    * The precomputed MLX90621 conversion must agree with the datasheet reference over many sensors.
+    * The EEPROMs are random within the ranges real parts are calibrated to; the raw frames are random within what they read indoors.
+    */
+    uint8_t eeprom[MLX90621_EEPROM_SIZE];
+    int16_t ir_data[MLX90621_NUM_PIXELS];
+    float converted_frame[MLX90621_NUM_ROWS][MLX90621_NUM_COLS];
+    float reference_frame[MLX90621_NUM_ROWS][MLX90621_NUM_COLS];
+    const int num_sensors = 500;
+    const float tolerance = 0.01;
+    bool passing = true;
+
+    scene_seed = 90621;
+    for (int sensor = 0; sensor < num_sensors; sensor++) {
+        memset(eeprom, 0, sizeof(eeprom));
+        for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+            eeprom[CAL_A_I_START + i] = scene_noise() * 64;
+            eeprom[CAL_B_I_START + i] = scene_noise() * 16;
+            eeprom[CAL_DELTA_ALPHA_START + i] = 64 + scene_noise() * 192;
+        }
+
+        eeprom[CAL_ACOMMON_L] = 0xBA + scene_noise() * 40;  // -70 to -31
+        eeprom[CAL_ACOMMON_H] = 0xFF;
+        eeprom[CAL_KT_SCALE] = 0x8B;
+        eeprom[CAL_ACP_L] = 0xC4 + scene_noise() * 20;      // -60 to -41
+        eeprom[CAL_ACP_H] = 0xFF;
+        eeprom[CAL_BCP] = scene_noise() * 8;
+        eeprom[CAL_ALPHA_CP_L] = scene_noise() * 256;
+        eeprom[CAL_ALPHA_CP_H] = 0x0C + scene_noise() * 8;
+        eeprom[CAL_TGC] = scene_noise() * 16;
+        eeprom[CAL_VTH_H] = 0x64;
+        eeprom[CAL_KT1_H] = 0x55;
+        eeprom[CAL_KT2_H] = 0x58;
+        eeprom[CAL_A0_L] = scene_noise() * 256;
+        eeprom[CAL_A0_H] = 0x64 + scene_noise() * 12;
+        eeprom[CAL_A0_SCALE] = 40;
+        eeprom[CAL_DELTA_A_SCALE] = 46;
+        eeprom[CAL_EMIS_L] = scene_noise() * 256;
+        eeprom[CAL_EMIS_H] = 0x70 + scene_noise() * 16;
+        eeprom[CAL_KSTA_L] = scene_noise() * 256;
+
+        // Lower ADC resolutions read proportionally smaller raw values
+        int resolution = scene_noise() * 4;
+        float ambient_temperature = 15 + scene_noise() * 20;
+        for (int i = 0; i < MLX90621_NUM_PIXELS; i++) {
+            ir_data[i] = int(scene_noise() * 200 - 40) >> (3 - resolution);
+        }
+        int16_t compensation_pixel = int(scene_noise() * -40) >> (3 - resolution);
+
+        MLX90621Converter converter;
+        converter.load_calibration(eeprom, resolution);
+        converter.set_ambient_temperature(ambient_temperature);
+        converter.convert_frame(ir_data, compensation_pixel, converted_frame);
+        MLX90621Converter::convert_frame_reference(eeprom, resolution, ambient_temperature, ir_data, compensation_pixel, reference_frame);
+
+        // Both must give up on the same pixels if the compensated signal goes negative
+        for (int i = 0; i < MLX90621_NUM_ROWS; i++) {
+            for (int j = 0; j < MLX90621_NUM_COLS; j++) {
+                float converted = converted_frame[i][j];
+                float reference = reference_frame[i][j];
+                passing = passing && isnan(converted) == isnan(reference);
+                passing = passing && (isnan(reference) || absolute(converted - reference) <= tolerance);
+            }
+        }
+    }
+
+    report("Converter equivalence test", passing);
+}
+
+void ThermalTrackerTest::exclusion_test(){
+    /**
+    * Excluded pixels never become active, and a blob that stays put long enough is excluded without being counted.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    uint8_t mask[EXCLUSION_MASK_SIZE];
+    uint8_t saved_mask[EXCLUSION_MASK_SIZE];
+    long movements[NUM_DIRECTION_CATEGORIES];
+    bool passing = true;
+
+    // A heater in the top left corner and a person on the right; only the heater is excluded
+    memcpy(frame, zeros, sizeof(frame));
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            frame[i][j + 1] = 10;
+            frame[i][j + 11] = 10;
+        }
+    }
+
+    memset(mask, 0, sizeof(mask));
+    for (int i = 0; i < 3; i++) {
+        for (int j = 1; j < 4; j++) {
+            mask[(i * FRAME_WIDTH + j) / 8] |= 1 << ((i * FRAME_WIDTH + j) % 8);
+        }
+    }
+
+    ThermalTracker masked_tracker(5);
+    masked_tracker.set_exclusion_mask(mask);
+    make_built_tracker(masked_tracker);
+
+    masked_tracker.process_frame(frame);
+    masked_tracker.get_exclusion_mask(saved_mask);
+    CHECK(passing, masked_tracker.get_num_excluded_pixels() == 9);
+    CHECK(passing, memcmp(mask, saved_mask, sizeof(mask)) == 0);
+    CHECK(passing, masked_tracker.get_frame_stats().num_active_pixels == 9);
+    CHECK(passing, masked_tracker.get_num_blobs(masked_tracker.frame_blobs) == 1);
+    CHECK(passing, masked_tracker.frame_blobs[0].min[X] == 11);
+
+    // A heater that turns on and stays put is learnt, and its track is dropped rather than counted
+    ThermalTracker learning_tracker(5);
+    learning_tracker.set_exclusion_learning(10);
+    make_built_tracker(learning_tracker);
+
+    memcpy(frame, zeros, sizeof(frame));
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            frame[i][j + 1] = 10;
+        }
+    }
+
+    for (int f = 0; f < 15; f++) {
+        learning_tracker.process_frame(frame);
+    }
+    CHECK(passing, learning_tracker.get_num_excluded_pixels() == 9);
+    CHECK(passing, learning_tracker.get_frame_stats().num_active_pixels == 0);
+
+    for (int f = 0; f < 5; f++) {
+        learning_tracker.process_frame(zeros);
+    }
+    learning_tracker.get_movements(movements);
+    for (int direction = 0; direction < NUM_DIRECTION_CATEGORIES; direction++) {
+        CHECK(passing, movements[direction] == 0);
+    }
+
+    report("Exclusion test", passing);
+}
+
+long walk_across_line(int last_column){
+    /**
+    * Walk a person across an upsampled tracker with a counting line down sensor column 4, then out of view.
+    * @param last_column Sensor column the person's left edge walks to before they leave
+    * @return Number of LINE_FORWARD crossings, or -1 if any were counted backwards
+    */
+    ThermalTracker line_tracker(5);
+    line_tracker.set_upsampling_factor(2);
+    line_tracker.add_counting_line(4, -1, 4, FRAME_HEIGHT);
+    make_built_tracker(line_tracker);
+    walk_person(line_tracker, 0, last_column, 1);
+
+    if (line_tracker.get_line_count(0, LINE_BACKWARD) != 0) {
+        return -1;
+    }
+    return line_tracker.get_line_count(0, LINE_FORWARD);
+}
+
+void ThermalTrackerTest::counting_line_test(){
+    /**
+    * Crossings are counted in the direction they happen, once per crossing, in sensor pixels.
+    */
+    CountingLines lines;
+    float from[2];
+    float to[2];
+    bool passing = true;
+
+    // A line drawn down the view counts left to right as LINE_FORWARD
+    lines.add_line(8, 0, 8, 4);
+    from[X] = 6;
+    from[Y] = 2;
+    to[X] = 10;
+    to[Y] = 2;
+    CHECK(passing, lines.check_path(from, to) == 1);
+    CHECK(passing, lines.check_path(to, from) == 1);
+    CHECK(passing, lines.get_count(0, LINE_FORWARD) == 1);
+    CHECK(passing, lines.get_count(0, LINE_BACKWARD) == 1);
+
+    // Passing beyond the end of the line isn't a crossing
+    from[Y] = 6;
+    to[Y] = 6;
+    CHECK(passing, lines.check_path(from, to) == 0);
+
+    // Stopping on the line and carrying on is one crossing
+    float on_line[2];
+    on_line[X] = 8;
+    on_line[Y] = 2;
+    from[Y] = 2;
+    to[Y] = 2;
+    CHECK(passing, lines.check_path(from, on_line) == 1);
+    CHECK(passing, lines.check_path(on_line, on_line) == 0);
+    CHECK(passing, lines.check_path(on_line, to) == 0);
+    CHECK(passing, lines.get_count(0, LINE_FORWARD) == 2);
+    CHECK(passing, lines.get_count(0, LINE_BACKWARD) == 1);
+
+    // On an upsampled grid, the line is still at sensor column 4; walking up to column 3 must not reach it
+    CHECK(passing, walk_across_line(2) == 0);
+    CHECK(passing, walk_across_line(6) == 1);
+
+    report("Counting line test", passing);
+}
+
+void ThermalTrackerTest::early_commit_test(){
+    /**
+    * Early commit counts a movement on the frame its track passes the travel threshold, and not again when the track ends.
+    */
+    long movements[NUM_DIRECTION_CATEGORIES];
+    ThermalTracker early_tracker(5);
+    ThermalTracker late_tracker(5);
+    early_tracker.set_early_commit(true);
+    make_built_tracker(early_tracker);
+    make_built_tracker(late_tracker);
+    bool passing = true;
+    CHECK(passing, early_tracker.get_early_commit());
+    CHECK(passing, !late_tracker.get_early_commit());
+
+    // The person walks right one column per frame, so the track's travel is the column it has reached
+    for (int column = 0; column < FRAME_WIDTH - 1; column++) {
+        show_person(early_tracker, column);
+        show_person(late_tracker, column);
+
+        early_tracker.get_movements(movements);
+        CHECK(passing, movements[RIGHT] == (column > MINIMUM_TRAVEL_THRESHOLD));
+        late_tracker.get_movements(movements);
+        CHECK(passing, movements[RIGHT] == 0);
+    }
+
+    // Once the person has gone, both trackers have counted them once
+    empty_view(early_tracker);
+    empty_view(late_tracker);
+    early_tracker.get_movements(movements);
+    for (int direction = 0; direction < NUM_DIRECTION_CATEGORIES; direction++) {
+        CHECK(passing, movements[direction] == (direction == RIGHT));
+    }
+    late_tracker.get_movements(movements);
+    for (int direction = 0; direction < NUM_DIRECTION_CATEGORIES; direction++) {
+        CHECK(passing, movements[direction] == (direction == RIGHT));
+    }
+
+    report("Early commit test", passing);
+}
+
+void ThermalTrackerTest::occupancy_test(){
+    /**
+    * Entries and exits move the occupancy, which never goes below zero, and tracks too short to confirm are left out.
+    */
+    long movements[NUM_DIRECTION_CATEGORIES];
+    ThermalTracker room_tracker(5);
+    room_tracker.set_early_commit(true);
+    room_tracker.set_entry_direction(RIGHT);
+    make_built_tracker(room_tracker);
+    bool passing = true;
+    CHECK(passing, !room_tracker.has_occupancy_changed());
+    CHECK(passing, room_tracker.get_occupancy() == 0);
+
+    // Someone only counts as in view once their track is confirmed
+    for (int i = 1; i <= OCCUPANCY_CONFIRMATION_FRAMES; i++) {
+        show_person(room_tracker, 0);
+        CHECK(passing, room_tracker.get_num_people_in_view() == (i >= OCCUPANCY_CONFIRMATION_FRAMES));
+    }
+    room_tracker.process_frame(zeros);
+    CHECK(passing, room_tracker.get_num_people_in_view() == 0);
+
+    // An entry, then an exit; reading the occupancy clears its flag
+    walk_person(room_tracker, 0, FRAME_WIDTH - 2, 1);
+    CHECK(passing, room_tracker.has_occupancy_changed());
+    CHECK(passing, room_tracker.get_occupancy() == 1);
+    CHECK(passing, !room_tracker.has_occupancy_changed());
+    walk_person(room_tracker, FRAME_WIDTH - 2, 0, -1);
+    CHECK(passing, room_tracker.has_occupancy_changed());
+    CHECK(passing, room_tracker.get_occupancy() == 0);
+
+    // An exit from an empty room is still a movement, but the occupancy stays at zero
+    walk_person(room_tracker, FRAME_WIDTH - 2, 0, -1);
+    room_tracker.get_movements(movements);
+    CHECK(passing, movements[LEFT] == 2);
+    CHECK(passing, !room_tracker.has_occupancy_changed());
+    CHECK(passing, room_tracker.get_occupancy() == 0);
+
+    // A flicker that jumps across the view before it can be confirmed is counted as a movement, but isn't let in
+    walk_person(room_tracker, 0, 3 * (OCCUPANCY_CONFIRMATION_FRAMES - 2), 3);
+    room_tracker.get_movements(movements);
+    CHECK(passing, movements[RIGHT] == 2);
+    CHECK(passing, room_tracker.get_occupancy() == 0);
+
+    room_tracker.set_occupancy(-3);
+    CHECK(passing, room_tracker.get_occupancy() == 0);
+
+    report("Occupancy test", passing);
+}
+
+void ThermalTrackerTest::movement_histogram_test(){
+    /**
+    * Movements land in the bucket covering their time, the ring overwrites its oldest bucket, and rollups add up the
+    * recent buckets, including across a millis() wrap.
+    */
+    long counts[2];
+    MovementHistogram histogram(4, 1000, 2);
+    bool passing = true;
+
+    histogram.add(0, 500);
+    histogram.add(1, 900);
+    histogram.add(0, 1500);
+    histogram.add(2, 1500);
+    histogram.get_bucket(0, 1500, counts);
+    CHECK(passing, counts[0] == 1 && counts[1] == 0);
+    histogram.get_bucket(1, 1500, counts);
+    CHECK(passing, counts[0] == 1 && counts[1] == 1);
+    histogram.get_rollup(2, 1999, counts);
+    CHECK(passing, counts[0] == 2 && counts[1] == 1);
+
+    // Four buckets later the first one has been dropped, and its slot is reset when it is reused
+    histogram.advance(4500);
+    histogram.get_bucket(4, 4500, counts);
+    CHECK(passing, counts[0] == 0 && counts[1] == 0);
+    histogram.get_rollup(10, 4500, counts);
+    CHECK(passing, counts[0] == 1 && counts[1] == 0);
+    histogram.add(0, 500);
+    histogram.add(1, 4600);
+    histogram.get_bucket(0, 4600, counts);
+    CHECK(passing, counts[0] == 0 && counts[1] == 1);
+    histogram.get_rollup(4, 4600, counts);
+    CHECK(passing, counts[0] == 1 && counts[1] == 1);
+
+    // Buckets keep counting up as millis() wraps, and a late movement still lands in the bucket it happened in
+    MovementHistogram wrapping_histogram(4, 1000, 2);
+    unsigned long before_wrap = (unsigned long)-1 - 1500;
+    wrapping_histogram.add(0, before_wrap);
+    wrapping_histogram.advance(before_wrap + 2000);
+    wrapping_histogram.add(1, before_wrap + 2000);
+    wrapping_histogram.add(1, before_wrap + 100);
+    wrapping_histogram.get_bucket(0, before_wrap + 2000, counts);
+    CHECK(passing, counts[0] == 0 && counts[1] == 1);
+    wrapping_histogram.get_bucket(2, before_wrap + 2000, counts);
+    CHECK(passing, counts[0] == 1 && counts[1] == 1);
+    wrapping_histogram.get_rollup(4, before_wrap + 2000, counts);
+    CHECK(passing, counts[0] == 1 && counts[1] == 2);
+
+    report("Movement histogram test", passing);
+}
+
+void ThermalTrackerTest::background_snapshot_test(){
+    /**
+    * A saved background restores into a fresh tracker exactly, and snapshots that are corrupt or for another frame size are
+    * turned away without touching the tracker.
+    */
+    float frames[2][FRAME_HEIGHT][FRAME_WIDTH];
+    for (int i = 0; i < FRAME_HEIGHT; i++) {
+        for (int j = 0; j < FRAME_WIDTH; j++) {
+            frames[0][i][j] = 20 + i + 0.5 * j + 0.25;
+            frames[1][i][j] = 20 + i + 0.5 * j - 0.25;
+        }
+    }
+
+    // Built on a slightly noisy scene, so the deviations aren't all zero
+    ThermalTracker saving_tracker(5);
+    saving_tracker.set_frame_deadline(0);
+    for (int f = 0; !saving_tracker.finished_building_background(); f++) {
+        saving_tracker.process_frame(frames[f % 2]);
+    }
+
+    size_t snapshot_size = ThermalTracker::get_background_snapshot_size();
+    uint8_t* snapshot = new uint8_t[snapshot_size];
+    bool passing = true;
+    CHECK(passing, saving_tracker.save_background(snapshot, snapshot_size - 1) == 0);
+    CHECK(passing, saving_tracker.save_background(snapshot, snapshot_size) == snapshot_size);
+
+    // Corrupt, cut short, or for another frame size
+    ThermalTracker restoring_tracker(5);
+    restoring_tracker.set_frame_deadline(0);
+    CHECK(passing, !restoring_tracker.restore_background(snapshot, snapshot_size - 1));
+    snapshot[snapshot_size - 1] ^= 0x01;
+    CHECK(passing, !restoring_tracker.restore_background(snapshot, snapshot_size));
+    snapshot[snapshot_size - 1] ^= 0x01;
+    snapshot[3] = FRAME_WIDTH + 1;
+    CHECK(passing, !restoring_tracker.restore_background(snapshot, snapshot_size));
+    snapshot[3] = FRAME_WIDTH;
+    snapshot[4] = FRAME_HEIGHT * 2;
+    CHECK(passing, !restoring_tracker.restore_background(snapshot, snapshot_size));
+    snapshot[4] = FRAME_HEIGHT;
+    CHECK(passing, !restoring_tracker.finished_building_background());
+    CHECK(passing, !restoring_tracker.is_validating_background());
+
+    // The round trip is exact, and the restored background only needs checking against the scene before it is used
+    CHECK(passing, restoring_tracker.restore_background(snapshot, snapshot_size));
+    CHECK(passing, memcmp(restoring_tracker.pixel_averages, saving_tracker.pixel_averages, sizeof(saving_tracker.pixel_averages)) == 0);
+    CHECK(passing, memcmp(restoring_tracker.pixel_variance, saving_tracker.pixel_variance, sizeof(saving_tracker.pixel_variance)) == 0);
+    CHECK(passing, restoring_tracker.num_background_frames == saving_tracker.num_background_frames);
+    for (int f = 0; f < RESTORE_VALIDATION_FRAMES; f++) {
+        CHECK(passing, restoring_tracker.is_validating_background());
+        restoring_tracker.process_frame(frames[f % 2]);
+    }
+    CHECK(passing, !restoring_tracker.is_validating_background());
+    CHECK(passing, restoring_tracker.finished_building_background());
+
+    delete[] snapshot;
+    report("Background snapshot test", passing);
+}
+
+void ThermalTrackerTest::pruning_stats_test(){
+    /**
+    * Every tracked blob/blob pair is counted as either evaluated or pruned, and a tight position gate prunes the pairs
+    * between people without losing their tracks.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    memcpy(frame, zeros, sizeof(frame));
+    paint_person(frame, 0);
+    paint_person(frame, 5);
+    paint_person(frame, FRAME_WIDTH - 2);
+
+    ThermalTracker open_tracker(5);
+    ThermalTracker gated_tracker(5);
+    gated_tracker.set_position_gate(3);
+    make_built_tracker(open_tracker);
+    make_built_tracker(gated_tracker);
+
+    // Nothing to compare until there are tracked blobs, then three people standing still make nine pairs a frame
+    // The gate leaves each track with only its own blob, whether the others are in the neighbouring grid cells or further
+    bool passing = true;
+    for (int f = 0; f < 3; f++) {
+        open_tracker.process_frame(frame);
+        gated_tracker.process_frame(frame);
+        CHECK(passing, open_tracker.get_num_evaluated_pairs() == 9 * f);
+        CHECK(passing, open_tracker.get_num_pruned_pairs() == 0);
+        CHECK(passing, gated_tracker.get_num_evaluated_pairs() == 3 * f);
+        CHECK(passing, gated_tracker.get_num_pruned_pairs() == 6 * f);
+    }
+
+    int num_tracks = 0;
+    for (int i = 0; i < gated_tracker.max_blobs; i++) {
+        num_tracks += gated_tracker.tracked_blobs[i].is_active() && gated_tracker.tracked_blobs[i].get_age() == 3;
+    }
+    CHECK(passing, num_tracks == 3);
+
+    report("Pruning stats test", passing);
+}
+
+void ThermalTrackerTest::unmatchable_pair_test(){
+    /**
+    * Pairs left unmatchable by the position gate are never matched, even with a distance threshold above
+    * UNMATCHABLE_DISTANCE.
+    */
+    ThermalTracker loose_tracker(5, UNMATCHABLE_DISTANCE * 5);
+    loose_tracker.set_position_gate(2);
+    make_built_tracker(loose_tracker);
+
+    // The person jumps across the view, too far for the gate, so the old track ends and a new one starts
+    show_person(loose_tracker, 1);
+    show_person(loose_tracker, 1);
+    show_person(loose_tracker, FRAME_WIDTH - 3);
+    bool passing = true;
+    CHECK(passing, loose_tracker.get_num_pruned_pairs() == 1);
+    CHECK(passing, loose_tracker.get_num_evaluated_pairs() == 1);
+    CHECK(passing, loose_tracker.get_num_blobs(loose_tracker.tracked_blobs) == 1);
+
+    TrackedBlob& track = loose_tracker.tracked_blobs[0];
+    CHECK(passing, track.get_age() == 1);
+    CHECK(passing, track.get_travel(X) == 0);
+    CHECK(passing, track.get_position(X) == FRAME_WIDTH - 2.5);
+
+    report("Unmatchable pair test", passing);
+}
+
+void ThermalTrackerTest::degrade_mid_walk_test(){
+    /**
+    * Dropping to coarse detection and coming back while people are in view keeps their tracks, so nobody is counted twice.
+    */
+    long movements[NUM_DIRECTION_CATEGORIES];
+    ThermalTracker switching_tracker(5);
+    switching_tracker.set_upsampling_factor(2);
+    make_built_tracker(switching_tracker);
+    bool passing = true;
+
+    // Someone walks across while the grid changes under them twice
+    for (int column = 0; column < FRAME_WIDTH - 1; column++) {
+        if (column == 5) {
+            switching_tracker.set_degradation_level(COARSE_DETECTION);
+            CHECK(passing, switching_tracker.get_upsampling_factor() == 1);
+        }
+        if (column == 10) {
+            switching_tracker.set_degradation_level(FULL_QUALITY);
+            CHECK(passing, switching_tracker.get_upsampling_factor() == 2);
+        }
+        show_person(switching_tracker, column);
+        CHECK(passing, switching_tracker.tracked_blobs[0].get_age() == column + 1);
+    }
+    empty_view(switching_tracker);
+
+    // Someone stands still while it changes
+    for (int f = 0; f < 3 * REFRESH_RATE; f++) {
+        if (f == REFRESH_RATE || f == 2 * REFRESH_RATE) {
+            switching_tracker.set_degradation_level(f == REFRESH_RATE ? COARSE_DETECTION : FULL_QUALITY);
+        }
+        show_person(switching_tracker, 7);
+    }
+    empty_view(switching_tracker);
+
+    switching_tracker.get_movements(movements);
+    CHECK(passing, movements[RIGHT] == 1);
+    CHECK(passing, movements[LEFT] == 0);
+    CHECK(passing, movements[UP] == 0);
+    CHECK(passing, movements[DOWN] == 0);
+    CHECK(passing, movements[NO_DIRECTION] == 1);
+
+    report("Degrade mid-walk test", passing);
+}
+
+void ThermalTrackerTest::pipeline_lifecycle_test(){
+    /**
+    * Frames queued before the pipeline starts are dropped rather than waiting forever for a slot, and the running
+    * pipeline keeps the movement histogram's clock going like process_frame does.
+    */
+    float frame[FRAME_HEIGHT][FRAME_WIDTH];
+    memcpy(frame, zeros, sizeof(frame));
+    ThermalTracker pipelined_tracker(5);
+    pipelined_tracker.set_frame_deadline(0);
+    pipelined_tracker.set_movement_histogram(4, 1000);
+    PipelinedTracker pipeline(pipelined_tracker, 0);
+    bool passing = true;
+
+    for (int f = 0; f < 2 * PIPELINE_DEPTH; f++) {
+        pipeline.process_frame(frame);
+    }
+    CHECK(passing, pipelined_tracker.num_background_frames == 0);
+    CHECK(passing, !pipelined_tracker.movement_histogram->clock_started);
+
+    CHECK(passing, pipeline.start());
+    pipeline.process_frame(frame);
+    pipeline.flush();
+    CHECK(passing, pipelined_tracker.num_background_frames == 1);
+    CHECK(passing, pipelined_tracker.movement_histogram->clock_started);
+    pipeline.stop();
+
+    report("Pipeline lifecycle test", passing);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Main
+
+int main(int argc, char* argv[]){
+    const char* directory = DEFAULT_GOLDEN_DIRECTORY;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        }
+        else{
+            directory = argv[i];
+        }
+    }
+
+    if (update) {
+        ThermalTrackerTest::golden_tests(directory, true);
+        printf("Golden outputs written to %s\n", directory);
+        return 0;
+    }
+
+    ThermalTrackerTest::build_background_test();
+    ThermalTrackerTest::background_average_and_variance_test();
+    ThermalTrackerTest::active_pixel_test();
+    ThermalTrackerTest::pixel_adjacency_test();
+    ThermalTrackerTest::blob_detection_test();
+    ThermalTrackerTest::blob_add_pixel_test();
+    ThermalTrackerTest::distance_test();
+    ThermalTrackerTest::process_blob_test();
+    ThermalTrackerTest::get_num_blobs_test();
+    ThermalTrackerTest::distance_matrix_test();
+    ThermalTrackerTest::sort_tracked_blobs_test();
+    ThermalTrackerTest::track_test();
+    ThermalTrackerTest::scene_generator_test();
+    ThermalTrackerTest::degradation_test();
+    ThermalTrackerTest::upsampling_scale_test();
+    ThermalTrackerTest::degradation_cost_test();
+    ThermalTrackerTest::pyramid_equivalence_test();
+    ThermalTrackerTest::converter_equivalence_test();
+    ThermalTrackerTest::exclusion_test();
+    ThermalTrackerTest::counting_line_test();
+    ThermalTrackerTest::early_commit_test();
+    ThermalTrackerTest::occupancy_test();
+    ThermalTrackerTest::movement_histogram_test();
+    ThermalTrackerTest::background_snapshot_test();
+    ThermalTrackerTest::pruning_stats_test();
+    ThermalTrackerTest::unmatchable_pair_test();
+    ThermalTrackerTest::degrade_mid_walk_test();
+    ThermalTrackerTest::pipeline_lifecycle_test();
+    ThermalTrackerTest::golden_tests(directory, false);
+
+    printf("Tests finished. %d tests run; %d passed\n", num_tests, num_passed);
+    return num_passed == num_tests ? 0 : 1;
+}
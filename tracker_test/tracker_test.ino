@@ -11,12 +11,24 @@ int num_passed = 0;
 
 ThermalTracker tracker(5);
 
-void build_background_test();
-void active_pixel_test();
-void pixel_adjacency_test();
-void blob_detection_test();
-void blob_add_pixel_test();
-void track_test();
+// The tests reach into the tracker's internals, so they are members of the test class it befriends;
+// the same vectors also run on a desktop in host/host_test.cpp
+class ThermalTrackerTest{
+    public:
+        static void build_test_background();
+        static void build_background_test();
+        static void background_average_and_variance_test();
+        static void active_pixel_test();
+        static void pixel_adjacency_test();
+        static void blob_detection_test();
+        static void blob_add_pixel_test();
+        static void distance_test();
+        static void distance_matrix_test();
+        static void get_num_blobs_test();
+        static void sort_tracked_blobs_test();
+        static void process_blob_test();
+        static void track_test();
+};
 
 float zeros[NUM_ROWS][NUM_COLS] =  {{0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
                                     {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
@@ -74,18 +86,18 @@ float track_test_frame_4[NUM_ROWS][NUM_COLS] = {{0,0,0,0,0,0,0,0,0,0,0,5,5,5,5,5
 void setup(){
 
     Log.Init(LOGGER_LEVEL, SERIAL_BAUD);
-    build_background_test();
-    background_average_and_variance_test();
-    active_pixel_test();
-    pixel_adjacency_test();
-    blob_detection_test();
-    blob_add_pixel_test();
-    distance_test();
-    process_blob_test();
-    get_num_blobs_test();
-    distance_matrix_test();
-    sort_tracked_blobs_test();
-    track_test();
+    ThermalTrackerTest::build_background_test();
+    ThermalTrackerTest::background_average_and_variance_test();
+    ThermalTrackerTest::active_pixel_test();
+    ThermalTrackerTest::pixel_adjacency_test();
+    ThermalTrackerTest::blob_detection_test();
+    ThermalTrackerTest::blob_add_pixel_test();
+    ThermalTrackerTest::distance_test();
+    ThermalTrackerTest::process_blob_test();
+    ThermalTrackerTest::get_num_blobs_test();
+    ThermalTrackerTest::distance_matrix_test();
+    ThermalTrackerTest::sort_tracked_blobs_test();
+    ThermalTrackerTest::track_test();
 }
 
 void loop(){
@@ -97,14 +109,14 @@ void loop(){
 ////////////////////////////////////////////////////////////////////////////////
 // Tests
 
-void build_test_background(){
+void ThermalTrackerTest::build_test_background(){
     tracker.reset_background();
     while (!tracker.finished_building_background()){
         tracker.process_frame(zeros);
     }
 }
 
-void build_background_test(){
+void ThermalTrackerTest::build_background_test(){
     num_tests++;
 
     Log.Info("Background build test");
@@ -114,7 +126,7 @@ void build_background_test(){
     Log.Info("Background build test; Pass? true. %d/%d\n\n", num_passed, num_tests);
 }
 
-void background_average_and_variance_test(){
+void ThermalTrackerTest::background_average_and_variance_test(){
     float averages[NUM_ROWS][NUM_COLS];
     float variances[NUM_ROWS][NUM_COLS];
     num_tests++;
@@ -156,7 +168,7 @@ void background_average_and_variance_test(){
     Log.Info("Background average and variance test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void active_pixel_test(){
+void ThermalTrackerTest::active_pixel_test(){
     Log.Info("Active pixel test");
     num_tests++;
     bool passing = false;
@@ -177,7 +189,7 @@ void active_pixel_test(){
     Log.Info("Active pixel test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void pixel_adjacency_test(){
+void ThermalTrackerTest::pixel_adjacency_test(){
     Log.Info("Adjacency test");
     num_tests++;
     tracker.load_frame(test_frame);
@@ -198,7 +210,7 @@ void pixel_adjacency_test(){
     Log.Info("Adjacency test; Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void blob_detection_test(){
+void ThermalTrackerTest::blob_detection_test(){
     Log.Info("Blob detection test");
     Blob blobs[MAX_BLOBS];
     int num_blobs = 0;
@@ -211,7 +223,7 @@ void blob_detection_test(){
     Log.Debug("Number of blobs detected: %d", num_blobs);
     passing = num_blobs == 3;
 
-    tracker.remove_small_blobs(blobs, MINIMUM_BLOB_SIZE);
+    tracker.remove_small_blobs(blobs);
     num_blobs = tracker.get_num_blobs(blobs);
     Log.Debug("Number of blobs detected: %d", num_blobs);
     if(passing){
@@ -223,7 +235,8 @@ void blob_detection_test(){
     num_blobs = tracker.get_blobs(blobs);
     Log.Debug("Number of blobs detected: %d", num_blobs);
     if (passing) {
-        passing = num_blobs == 9;
+        // 9 blobs, but the pool only holds MAX_BLOBS
+        passing = num_blobs == MAX_BLOBS;
     }
 
     if (passing) {
@@ -233,7 +246,7 @@ void blob_detection_test(){
     Log.Info("Blob detection test; Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void blob_add_pixel_test(){
+void ThermalTrackerTest::blob_add_pixel_test(){
     Blob blob;
     Pixel pixel;
     num_tests++;
@@ -282,7 +295,7 @@ void blob_add_pixel_test(){
     Log.Info("Blob add pixel test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void distance_test(){
+void ThermalTrackerTest::distance_test(){
     TrackedBlob t_blob;
     Blob blob;
     Pixel pixel;
@@ -378,7 +391,7 @@ void distance_test(){
     Log.Info("Distance calculation test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void distance_matrix_test(){
+void ThermalTrackerTest::distance_matrix_test(){
     /**
     * 3 tracked blobs; 3 New blobs
     * 2 of the new blobs will match the tracked blobs closely.
@@ -387,7 +400,7 @@ void distance_matrix_test(){
     TrackedBlob tracked_blobs[MAX_BLOBS];
     Blob blobs[MAX_BLOBS];
     Pixel pixel;
-    float distance_matrix[MAX_BLOBS][MAX_BLOBS];
+    float distance_matrix[MAX_BLOBS * MAX_BLOBS];
     num_tests++;
     bool passing;
     Log.Info("Distance matrix test");
@@ -432,7 +445,7 @@ void distance_matrix_test(){
             Serial.print("[");
             for (int j = 0; j < MAX_BLOBS; j++) {
                 Serial.print("\t");
-                Serial.print(distance_matrix[i][j], 2);
+                Serial.print(distance_matrix[i * MAX_BLOBS + j], 2);
             }
             Serial.println("]");
         }
@@ -463,7 +476,7 @@ void distance_matrix_test(){
     Log.Info("Distance matrix test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void get_num_blobs_test(){
+void ThermalTrackerTest::get_num_blobs_test(){
     Blob blobs[MAX_BLOBS];
     TrackedBlob tracked_blobs[MAX_BLOBS];
     Pixel pixel;
@@ -495,7 +508,7 @@ void get_num_blobs_test(){
     Log.Info("Get num blobs test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void sort_tracked_blobs_test(){
+void ThermalTrackerTest::sort_tracked_blobs_test(){
     TrackedBlob tracked_blobs[MAX_BLOBS];
     Blob blob;
     Pixel pixel;
@@ -615,7 +628,7 @@ void sort_tracked_blobs_test(){
     Log.Info("Sort tracked blobs test: Passed? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void process_blob_test(){
+void ThermalTrackerTest::process_blob_test(){
     TrackedBlob t_blob;
     Blob blob;
     Pixel pixel;
@@ -684,7 +697,7 @@ void process_blob_test(){
     Log.Info("Tracked blob movement test: Pass? %T %d/%d\n\n", passing, num_passed, num_tests);
 }
 
-void track_test(){
+void ThermalTrackerTest::track_test(){
     TrackedBlob tracked_blobs[MAX_BLOBS];
     Blob blobs[MAX_BLOBS];
     long movements[5];